@@ -0,0 +1,234 @@
+#ifndef DENSE_POLYNOMIALS_H
+#define DENSE_POLYNOMIALS_H
+
+#include <vector>
+#include <type_traits>
+
+#include "polynomial_multiplication.h"
+#include "polynomial_division.h"
+
+/*
+	Coefficients of a block evaluated by Estrin's scheme at once, longer
+	polynomials are evaluated block by block with Horner's scheme in
+	x^ESTRIN_BLOCK. It is a power of two.
+*/
+const int ESTRIN_BLOCK = 64;
+
+/*
+	Points evaluated together by the batched evaluations, they go through
+	Horner's scheme at once with the loop over the points innermost.
+	EVALUATION_BLOCK bounds the buffers of the sparse evaluation and
+	EVALUATION_LANES is the number of partial results of the dense one.
+*/
+const int EVALUATION_BLOCK = 256;
+const int EVALUATION_LANES = 16;
+
+/**
+ * It computes base^exponent for a non negative integer exponent by
+ * repeated squaring, O(log exponent) products instead of a call to pow.
+ */
+template <typename V, typename U>
+V integerPower(V base, U exponent) {
+  V result = V(1);
+  while (exponent > 0) {
+    if (exponent % 2 != 0) result *= base;
+    exponent /= 2;
+    if (exponent > 0) base *= base;
+  }
+  return result;
+}
+
+/**
+ * DensePolynomial class
+ * Polynomial with non negative integer exponents stored as the array of
+ * all of its coefficients, coefficients[i] multiplies x^i.
+ *
+ * evaluate uses Horner's scheme, one multiplication and one addition per
+ * coefficient but each one waiting for the previous one.
+ * evaluateEstrin uses Estrin's scheme, it groups the coefficients in
+ * pairs, c0 + c1 x, and then the pairs of pairs with x^2, x^4... so the
+ * operations of a level are independent and the processor overlaps them;
+ * the dependency chain is log2(n) long instead of n.
+ */
+template <typename T>
+class DensePolynomial {
+ public:
+  DensePolynomial() {}
+  explicit DensePolynomial(const std::vector<T>& coefficients)
+      : coefficients (coefficients) { trim(); }
+  explicit DensePolynomial(std::vector<T>&& coefficients)
+      : coefficients (std::move(coefficients)) { trim(); }
+  DensePolynomial(std::initializer_list<T> coefficients)
+      : coefficients (coefficients) { trim(); }
+
+  int degree() const {
+    return coefficients.empty() ? 0 : coefficients.size() - 1;
+  }
+  int size() const { return coefficients.size(); }
+  bool isEmpty() const { return coefficients.empty(); }
+  const std::vector<T>& getCoefficients() const { return coefficients; }
+  const T& operator[](int exponent) const { return coefficients[exponent]; }
+
+  DensePolynomial& operator*=(const DensePolynomial& other) {
+    coefficients = multiplyCoefficients(coefficients, other.coefficients);
+    trim();
+    return *this;
+  }
+
+  template <typename V>
+  auto evaluate(const V& value) const -> decltype(T() * value);
+  template <typename V>
+  auto evaluateEstrin(const V& value) const -> decltype(T() * value);
+  template <typename V, typename R>
+  void evaluate(const V* first, const V* last, R* results) const;
+  std::vector<T> evaluateMultipoint(const std::vector<T>& points) const {
+    return evaluateMultipoint(points, std::is_floating_point<T>());
+  }
+ private:
+  std::vector<T> coefficients;
+
+  void trim() {
+    while (not coefficients.empty() and coefficients.back() == T()) {
+      coefficients.pop_back();
+    }
+  }
+  template <typename R>
+  static R estrinBlock(const T* coefficients, int count, const R* powers);
+  /*
+  	The subproduct tree is exact for exact types, but in floating point
+  	its remainders lose all accuracy past a few dozen points, so floating
+  	point polynomials are evaluated by the batched Horner's scheme.
+  */
+  std::vector<T> evaluateMultipoint(const std::vector<T>& points,
+                                    std::false_type) const {
+    return ::evaluateMultipoint(coefficients, points);
+  }
+  std::vector<T> evaluateMultipoint(const std::vector<T>& points,
+                                    std::true_type) const {
+    std::vector<T> results(points.size());
+    evaluate(points.data(), points.data() + points.size(), results.data());
+    return results;
+  }
+};
+
+template <typename T>
+template <typename V>
+auto DensePolynomial<T>::evaluate(const V& value) const
+    -> decltype(T() * value) {
+  decltype(T() * value) result = decltype(T() * value)();
+  for (int i = size() - 1; i >= 0; i--) {
+    result = result * value + coefficients[i];
+  }
+  return result;
+}
+
+/**
+ * It evaluates the polynomial at every value of [first, last) into
+ * results. Horner's scheme runs for EVALUATION_LANES points at once with
+ * the loop over them innermost, the compiler vectorizes it and keeps the
+ * partial results in registers, and there are enough independent chains 
+ * to hide the latency of the multiplications and additions.
+ */
+template <typename T>
+template <typename V, typename R>
+void DensePolynomial<T>::evaluate(const V* first, const V* last,
+                                  R* results) const {
+  const int count = last - first;
+  const int degree = size() - 1;
+  int p = 0;
+  for (; p + EVALUATION_LANES <= count; p += EVALUATION_LANES) {
+    R values[EVALUATION_LANES];
+    R partial[EVALUATION_LANES];
+    for (int lane = 0; lane < EVALUATION_LANES; lane++) {
+      values[lane] = R() + first[p + lane];
+      partial[lane] = R();
+    }
+    for (int i = degree; i >= 0; i--) {
+      const T coefficient = coefficients[i];
+      for (int lane = 0; lane < EVALUATION_LANES; lane++) {
+        partial[lane] = partial[lane] * values[lane] + coefficient;
+      }
+    }
+    for (int lane = 0; lane < EVALUATION_LANES; lane++) {
+      results[p + lane] = partial[lane];
+    }
+  }
+  for (; p < count; p++) {
+    results[p] = evaluate(first[p]);
+  }
+}
+
+/**
+ * It evaluates count <= ESTRIN_BLOCK coefficients, powers[k] holds
+ * x^(2^k). The first two levels are done at once for every four 
+ * coefficients, (c0 + c1 x) + (c2 + c3 x) x^2, and the rest of the tree 
+ * runs over a fixed buffer on the stack, so there is no allocation per 
+ * evaluation.
+ */
+template <typename T>
+template <typename R>
+R DensePolynomial<T>::estrinBlock(const T* coefficients, int count,
+                                  const R* powers) {
+  R partial[ESTRIN_BLOCK / 4];
+  int size = count / 4;
+  for (int i = 0; i < size; i++) {
+    const T* c = coefficients + 4 * i;
+    partial[i] = (c[3] * powers[0] + c[2]) * powers[1] + 
+                 (c[1] * powers[0] + c[0]);
+  }
+  const T* c = coefficients + 4 * size;
+  switch (count % 4) {
+    case 3: partial[size++] = c[2] * powers[1] + (c[1] * powers[0] + c[0]);
+            break;
+    case 2: partial[size++] = c[1] * powers[0] + c[0];
+            break;
+    case 1: partial[size++] = R() + c[0];
+            break;
+  }
+  for (int level = 2; size > 1; level++) {
+    const int half = size / 2;
+    for (int i = 0; i < half; i++) {
+      partial[i] = partial[2 * i + 1] * powers[level] + partial[2 * i];
+    }
+    if (size % 2 != 0) {
+      partial[half] = partial[size - 1];
+    }
+    size = (size + 1) / 2;
+  }
+  return partial[0];
+}
+
+template <typename T>
+template <typename V>
+auto DensePolynomial<T>::evaluateEstrin(const V& value) const
+    -> decltype(T() * value) {
+  typedef decltype(T() * value) R;
+  const int count = size();
+  if (count == 0) return R();
+  R powers[8];
+  powers[0] = R() + value;
+  int levels = 1;
+  while ((1 << levels) <= ESTRIN_BLOCK and 
+         ((1 << (levels - 1)) < count or levels < 2)) {
+    powers[levels] = powers[levels - 1] * powers[levels - 1];
+    levels++;
+  }
+  int first = (count - 1) / ESTRIN_BLOCK * ESTRIN_BLOCK;
+  R result = estrinBlock(&coefficients[first], count - first, powers);
+  while (first > 0) {
+    first -= ESTRIN_BLOCK;
+    result = result * powers[levels - 1] +
+             estrinBlock(&coefficients[first], ESTRIN_BLOCK, powers);
+  }
+  return result;
+}
+
+template <typename T>
+DensePolynomial<T> operator*(const DensePolynomial<T>& pol1,
+                             const DensePolynomial<T>& pol2) {
+  DensePolynomial<T> resulting_polynomial = pol1;
+  resulting_polynomial *= pol2;
+  return resulting_polynomial;
+}
+
+#endif // DENSE_POLYNOMIALS_H
@@ -0,0 +1,123 @@
+#ifndef MATRIX_POLYNOMIALS_H
+#define MATRIX_POLYNOMIALS_H
+
+#include "../library/matrices.h"
+#include "polynomials.h"
+
+#include <cmath>
+#include <algorithm>
+
+/*
+	Polynomials applied to matrices. 
+	evaluateElementwise evaluates the polynomial at every cell, row by row 
+	through the batched Polynomial::evaluate and in parallel.
+	Polynomial::evaluate(const Matrix&) gives the matrix polynomial p(A).
+*/
+
+template <typename T, typename U, typename V>
+auto evaluateElementwise(const Polynomial<T, U>& polynomial, 
+    const Matrix<V>& matrix) -> Matrix<decltype(T() * pow(V(), U()))> {
+  typedef decltype(T() * pow(V(), U())) R;
+  Matrix<R> resultingMatrix(matrix.getRows(), matrix.getColumns());
+  const int terms = std::max(1, polynomial.size());
+  resultingMatrix.applyFunctorByRows(
+    matrix_execution::par.withGrainSize(
+        std::max(1, PARALLEL_THRESHOLD / terms)), 
+    [&](int row, R* first, R* last) {
+      const V* values = matrix[row].data();
+      polynomial.evaluate(values, values + (last - first), first);
+    });
+  return resultingMatrix;
+}
+
+/**
+ * It adds coefficient * matrix to resultingMatrix, both of the same rank.
+ */
+template <typename T, typename R>
+void addScaledMatrix(const T& coefficient, const Matrix<R>& matrix, 
+                     Matrix<R>& resultingMatrix) {
+  const int rank = matrix.getRows();
+  for (int i = 0; i < rank; i++) {
+    const R* row = matrix[i].data();
+    R* resultingRow = &resultingMatrix(i, 0);
+    for (int j = 0; j < rank; j++) {
+      resultingRow[j] += coefficient * row[j];
+    }
+  }
+}
+
+/**
+ * It sets block to the sum of coefficients[first + i] A^i for i < count,
+ * powers[i] holds A^i for i >= 1, the first term goes to the diagonal.
+ */
+template <typename T, typename R>
+void fillPatersonStockmeyerBlock(const std::vector<T>& coefficients, 
+    int first, int count, const std::vector<Matrix<R>>& powers, 
+    Matrix<R>& block) {
+  const int rank = block.getRows();
+  for (int i = 0; i < rank; i++) {
+    R* row = &block(i, 0);
+    std::fill(row, row + rank, R());
+    row[i] = R() + coefficients[first];
+  }
+  for (int i = 1; i < count; i++) {
+    if (coefficients[first + i] != T()) {
+      addScaledMatrix(coefficients[first + i], powers[i], block);
+    }
+  }
+}
+
+/**
+ * Paterson-Stockmeyer scheme: with s about sqrt(d + 1) the polynomial is
+ * split into blocks of s coefficients, p(A) = sum of B_k(A) (A^s)^k, so 
+ * it takes A^2..A^s, s - 1 products, and Horner's scheme in A^s over the 
+ * blocks, d / s more products, about 2 sqrt(d) against d products. The 
+ * blocks themselves are only scaled sums of the powers.
+ * Every Horner step writes the next block into a spare buffer and then 
+ * accumulates the product of the partial result and A^s into it, so the 
+ * matrices are allocated once. It keeps s + 2 matrices alive.
+ * It needs integer exponents, none of them negative, and it returns an 
+ * empty matrix for a non square matrix or a negative exponent.
+ */
+template <typename T, typename U>
+template <typename V>
+auto Polynomial<T, U>::evaluate(const Matrix<V>& matrix) const 
+    -> Matrix<decltype(T() * V())> {
+  static_assert(std::is_integral<U>::value, 
+                "Matrix polynomials need integer exponents");
+  typedef decltype(T() * V()) R;
+  const int rank = matrix.getRows();
+  if (rank != matrix.getColumns()) return {};
+  if (data.empty()) return Matrix<R>(rank, rank);
+  if (data.back().exp < 0) return {};
+  const int degree = data[0].exp;
+  const std::vector<T> coefficients = denseCoefficients(*this);
+  const int step = 
+      std::max(1, static_cast<int>(std::ceil(std::sqrt(degree + 1.0))));
+  const int blocks = (degree + step) / step;
+  // A single block needs no A^s
+  const int highest = blocks > 1 ? step : degree;
+  INSTRUMENT_OPERATION("Polynomial::evaluate(Matrix)", 
+                       matrix.numberOfCells(), 
+                       2LL * matrix.numberOfCells() * rank * (highest + blocks),
+                       sizeof(R) * matrix.numberOfCells() * (highest + 2));
+  std::vector<Matrix<R>> powers(highest + 1);
+  if (highest >= 1) powers[1] = matrix;
+  for (int i = 2; i <= highest; i++) {
+    powers[i] = Matrix<R>(rank, rank);
+    accumulateProduct(powers[i - 1], powers[1], powers[i]);
+  }
+  const int lastFirst = (blocks - 1) * step;
+  Matrix<R> resultingMatrix(rank, rank);
+  fillPatersonStockmeyerBlock(coefficients, lastFirst, degree + 1 - lastFirst,
+                              powers, resultingMatrix);
+  Matrix<R> buffer(blocks > 1 ? rank : 0, rank);
+  for (int k = blocks - 2; k >= 0; k--) {
+    fillPatersonStockmeyerBlock(coefficients, k * step, step, powers, buffer);
+    accumulateProduct(resultingMatrix, powers[step], buffer);
+    std::swap(resultingMatrix, buffer);
+  }
+  return resultingMatrix;
+}
+
+#endif // MATRIX_POLYNOMIALS_H
@@ -0,0 +1,402 @@
+#ifndef POLYNOMIAL_DIVISION_H
+#define POLYNOMIAL_DIVISION_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include "polynomial_multiplication.h"
+
+/*
+	Division of dense coefficient arrays, a[i] multiplies x^i, and the
+	fast multipoint evaluation built on it.
+
+	divideCoefficients does long division, O(n m), while the quotient or
+	the divisor are shorter than NEWTON_DIVISION_THRESHOLD. Otherwise the
+	quotient comes from the reversed polynomials multiplied by the
+	reciprocal of the reversed divisor as a power series, computed by
+	Newton's iteration, so it costs a few calls to multiplyCoefficients.
+	That series grows like the powers of the largest root of the divisor,
+	so integer types, which would overflow, always take long division,
+	and a floating point quotient which does not give back the leading
+	coefficients of the dividend is computed again by long division.
+
+	Floating point remainders never come out exactly zero, so their 
+	coefficients at most DIVISION_TOLERANCE times the largest one of the 
+	dividend are taken as zeros. Any other type is compared with T(). 
+	Integer coefficients are divided exactly, see divideIntegerCoefficients, 
+	and gcdCoefficients gives the greatest common divisor of both kinds.
+
+	evaluateMultipoint evaluates at n points through the subproduct tree,
+	the polynomial is reduced modulo the product of (x - p) over the
+	points of every half, recursively, and what is left at the leaves of
+	MULTIPOINT_LEAF points is evaluated by Horner's scheme.
+*/
+const int NEWTON_DIVISION_THRESHOLD = 64;
+const int MULTIPOINT_LEAF = 32;
+const double DIVISION_TOLERANCE = 1e-10;
+
+/**
+ * The first n coefficients of 1 / a as a power series, a[0] must not be
+ * zero. Every step of b <- b (2 - a b) doubles the number of correct
+ * coefficients.
+ */
+template <typename T>
+std::vector<T> reciprocalSeries(const std::vector<T>& a, int n) {
+  std::vector<T> b(1, T(1) / a[0]);
+  for (int length = 1; length < n;) {
+    length = std::min(2 * length, n);
+    const std::vector<T> head(a.begin(),
+                              a.begin() + std::min<int>(a.size(), length));
+    std::vector<T> correction = multiplyCoefficients(head, b);
+    correction.resize(length);
+    for (T& coefficient : correction) {
+      coefficient = -coefficient;
+    }
+    correction[0] += T(2);
+    b = multiplyCoefficients(b, correction);
+    b.resize(length);
+  }
+  return b;
+}
+
+template <typename T>
+void longDivision(const std::vector<T>& a, const std::vector<T>& b,
+                  std::vector<T>& quotient, std::vector<T>& remainder) {
+  const int nb = b.size();
+  const int nq = a.size() - nb + 1;
+  remainder = a;
+  quotient.assign(nq, T());
+  const T leading = b[nb - 1];
+  for (int i = nq - 1; i >= 0; i--) {
+    const T q = remainder[i + nb - 1] / leading;
+    quotient[i] = q;
+    T* remainderRow = &remainder[i];
+    for (int j = 0; j < nb; j++) {
+      remainderRow[j] -= q * b[j];
+    }
+  }
+  remainder.resize(nb - 1);
+}
+
+template <typename T>
+bool reproducesDividend(const std::vector<T>&, const std::vector<T>&, int,
+                        std::false_type) {
+  return true;
+}
+
+/**
+ * Whether the coefficients of product from the first one on match the
+ * ones of a within DIVISION_TOLERANCE times the largest one of a.
+ */
+template <typename T>
+bool reproducesDividend(const std::vector<T>& a, const std::vector<T>& product,
+                        int first, std::true_type) {
+  double largest = 0.0;
+  for (const T& coefficient : a) {
+    largest = std::max<double>(largest, std::abs(coefficient));
+  }
+  for (int i = first; i < int(a.size()); i++) {
+    if (not (std::abs(a[i] - product[i]) <= DIVISION_TOLERANCE * largest)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * a = quotient * b + remainder, with remainder shorter than b. The last
+ * coefficient of b must not be zero. The remainder keeps b.size() - 1
+ * coefficients, the leading ones may be zero.
+ */
+template <typename T>
+void divideCoefficients(const std::vector<T>& a, const std::vector<T>& b,
+                        std::vector<T>& quotient, std::vector<T>& remainder) {
+  const int na = a.size();
+  const int nb = b.size();
+  if (na < nb) {
+    quotient.clear();
+    remainder = a;
+    return;
+  }
+  const int nq = na - nb + 1;
+  if (nq < NEWTON_DIVISION_THRESHOLD or nb < NEWTON_DIVISION_THRESHOLD or
+      std::is_integral<T>::value) {
+    longDivision(a, b, quotient, remainder);
+    return;
+  }
+  std::vector<T> reversed_a(a.rbegin(), a.rbegin() + nq);
+  std::vector<T> reversed_b(b.rbegin(), b.rbegin() + std::min(nb, nq));
+  quotient = multiplyCoefficients(reversed_a, reciprocalSeries(reversed_b, nq));
+  quotient.resize(nq);
+  std::reverse(quotient.begin(), quotient.end());
+  const std::vector<T> product = multiplyCoefficients(quotient, b);
+  if (not reproducesDividend(a, product, nb - 1,
+                             std::is_floating_point<T>())) {
+    longDivision(a, b, quotient, remainder);
+    return;
+  }
+  remainder.assign(a.begin(), a.begin() + nb - 1);
+  for (int i = 0; i < nb - 1; i++) {
+    remainder[i] -= product[i];
+  }
+}
+
+template <typename T>
+std::vector<T> remainderCoefficients(const std::vector<T>& a,
+                                     const std::vector<T>& b) {
+  std::vector<T> quotient, remainder;
+  divideCoefficients(a, b, quotient, remainder);
+  return remainder;
+}
+
+template <typename T>
+bool isNegligible(const T& coefficient, double, std::false_type) {
+  return coefficient == T();
+}
+
+template <typename T>
+bool isNegligible(const T& coefficient, double bound, std::true_type) {
+  return std::abs(coefficient) <= bound;
+}
+
+/**
+ * It removes the leading coefficients which are negligible, for floating
+ * point types the ones at most bound in absolute value.
+ */
+template <typename T>
+void trimCoefficients(std::vector<T>& coefficients, double bound = 0.0) {
+  const std::is_floating_point<T> floating;
+  while (not coefficients.empty() and 
+         isNegligible(coefficients.back(), bound, floating)) {
+    coefficients.pop_back();
+  }
+}
+
+template <typename T>
+double largestMagnitude(const std::vector<T>& coefficients, std::true_type) {
+  double largest = 0.0;
+  for (const T& coefficient : coefficients) {
+    largest = std::max<double>(largest, std::abs(coefficient));
+  }
+  return largest;
+}
+
+template <typename T>
+double largestMagnitude(const std::vector<T>&, std::false_type) {
+  return 0.0;
+}
+
+/**
+ * The bound below which the coefficients of a remainder of a are zeros.
+ */
+template <typename T>
+double remainderBound(const std::vector<T>& a, double tolerance) {
+  return tolerance * largestMagnitude(a, std::is_floating_point<T>());
+}
+
+/**
+ * Division in Z[x]: it fails, returning false, when a coefficient of the
+ * quotient is not an integer. Divisors whose leading coefficient is 1 or 
+ * -1 never fail.
+ */
+template <typename T>
+bool divideIntegerCoefficients(const std::vector<T>& a, 
+    const std::vector<T>& b, std::vector<T>& quotient, 
+    std::vector<T>& remainder) {
+  const int na = a.size();
+  const int nb = b.size();
+  const T leading = b[nb - 1];
+  if (na < nb or leading == T(1) or leading == T(-1)) {
+    divideCoefficients(a, b, quotient, remainder);
+    return true;
+  }
+  remainder = a;
+  quotient.assign(na - nb + 1, T());
+  for (int i = na - nb; i >= 0; i--) {
+    if (remainder[i + nb - 1] % leading != T()) return false;
+    const T q = remainder[i + nb - 1] / leading;
+    quotient[i] = q;
+    T* remainderRow = &remainder[i];
+    for (int j = 0; j < nb; j++) {
+      remainderRow[j] -= q * b[j];
+    }
+  }
+  remainder.resize(nb - 1);
+  return true;
+}
+
+template <typename T>
+T integerGcd(T a, T b) {
+  while (b != T()) {
+    const T r = a % b;
+    a = b;
+    b = r;
+  }
+  return a < T() ? -a : a;
+}
+
+/**
+ * It divides the coefficients by their greatest common divisor and 
+ * returns it.
+ */
+template <typename T>
+T removeContent(std::vector<T>& coefficients) {
+  T content = T();
+  for (const T& coefficient : coefficients) {
+    content = integerGcd(content, coefficient);
+  }
+  if (content > T(1)) {
+    for (T& coefficient : coefficients) {
+      coefficient /= content;
+    }
+  }
+  return content;
+}
+
+/**
+ * Euclid's algorithm over a field, the result is monic.
+ */
+template <typename T>
+std::vector<T> gcdCoefficients(std::vector<T> a, std::vector<T> b, 
+                               double tolerance, std::false_type) {
+  trimCoefficients(a);
+  trimCoefficients(b);
+  while (not b.empty()) {
+    std::vector<T> remainder = remainderCoefficients(a, b);
+    trimCoefficients(remainder, remainderBound(a, tolerance));
+    a.swap(b);
+    b.swap(remainder);
+  }
+  if (not a.empty()) {
+    const T leading = a.back();
+    for (T& coefficient : a) {
+      coefficient /= leading;
+    }
+  }
+  return a;
+}
+
+/**
+ * Primitive remainder sequence over the integers: the remainders come 
+ * from pseudo-division, lc(b) a - lc(a) x^k b until the degree drops, 
+ * and lose their content at every step so the coefficients stay small.
+ * The result has a positive leading coefficient and the greatest common 
+ * divisor of both contents.
+ */
+template <typename T>
+std::vector<T> gcdCoefficients(std::vector<T> a, std::vector<T> b, 
+                               double, std::true_type) {
+  trimCoefficients(a);
+  trimCoefficients(b);
+  if (a.empty()) a.swap(b);
+  if (a.empty()) return a;
+  const T content = b.empty() ? removeContent(a) 
+                              : integerGcd(removeContent(a), removeContent(b));
+  while (not b.empty()) {
+    const int nb = b.size();
+    const T leading = b.back();
+    while (a.size() >= b.size()) {
+      const T scale = a.back();
+      const int shift = a.size() - nb;
+      for (T& coefficient : a) {
+        coefficient *= leading;
+      }
+      for (int j = 0; j < nb; j++) {
+        a[shift + j] -= scale * b[j];
+      }
+      trimCoefficients(a);
+    }
+    removeContent(a);
+    a.swap(b);
+  }
+  if (a.back() < T()) {
+    for (T& coefficient : a) {
+      coefficient = -coefficient;
+    }
+  }
+  for (T& coefficient : a) {
+    coefficient *= content;
+  }
+  return a;
+}
+
+template <typename T>
+std::vector<T> gcdCoefficients(const std::vector<T>& a, 
+    const std::vector<T>& b, double tolerance = DIVISION_TOLERANCE) {
+  return gcdCoefficients(a, b, tolerance, std::is_integral<T>());
+}
+
+/**
+ * tree[node] is the product of (x - p) over points [first, last), its
+ * children are 2 node and 2 node + 1.
+ */
+template <typename T>
+void buildSubproductTree(const std::vector<T>& points, int first, int last,
+                         int node, std::vector<std::vector<T>>& tree) {
+  if (last - first <= MULTIPOINT_LEAF) {
+    std::vector<T>& product = tree[node];
+    product.assign(1, T(1));
+    for (int i = first; i < last; i++) {
+      product.push_back(T());
+      for (int j = product.size() - 1; j > 0; j--) {
+        product[j] = product[j - 1] - points[i] * product[j];
+      }
+      product[0] = -points[i] * product[0];
+    }
+    return;
+  }
+  const int middle = first + (last - first) / 2;
+  buildSubproductTree(points, first, middle, 2 * node, tree);
+  buildSubproductTree(points, middle, last, 2 * node + 1, tree);
+  tree[node] = multiplyCoefficients(tree[2 * node], tree[2 * node + 1]);
+}
+
+template <typename T>
+void reduceOnSubproductTree(const std::vector<T>& coefficients,
+    const std::vector<T>& points, int first, int last, int node,
+    const std::vector<std::vector<T>>& tree, T* results) {
+  const std::vector<T> remainder =
+      coefficients.size() < tree[node].size()
+          ? coefficients : remainderCoefficients(coefficients, tree[node]);
+  if (last - first <= MULTIPOINT_LEAF) {
+    for (int i = first; i < last; i++) {
+      T result = T();
+      for (int k = remainder.size() - 1; k >= 0; k--) {
+        result = result * points[i] + remainder[k];
+      }
+      results[i] = result;
+    }
+    return;
+  }
+  const int middle = first + (last - first) / 2;
+  reduceOnSubproductTree(remainder, points, first, middle, 2 * node, tree,
+                         results);
+  reduceOnSubproductTree(remainder, points, middle, last, 2 * node + 1, tree,
+                         results);
+}
+
+/**
+ * O(M(n) log n) for n points and a polynomial of degree about n, where
+ * M(n) is the cost of multiplyCoefficients, against O(n^2) by Horner.
+ * It is exact for integral types (the products of (x - p) are monic, so
+ * no division is inexact) while nothing overflows. In floating point
+ * the remainders lose accuracy as the tree grows, as with any fast
+ * multipoint method: with random points in [-1, 1] the error is already
+ * visible at 64 points and the result is useless at 128.
+ */
+template <typename T>
+std::vector<T> evaluateMultipoint(const std::vector<T>& coefficients,
+                                  const std::vector<T>& points) {
+  const int count = points.size();
+  std::vector<T> results(count);
+  if (count == 0 or coefficients.empty()) return results;
+  std::vector<std::vector<T>> tree(4 * (count / MULTIPOINT_LEAF + 1));
+  buildSubproductTree(points, 0, count, 1, tree);
+  reduceOnSubproductTree(coefficients, points, 0, count, 1, tree,
+                         results.data());
+  return results;
+}
+
+#endif // POLYNOMIAL_DIVISION_H
@@ -0,0 +1,378 @@
+#ifndef POLYNOMIAL_MULTIPLICATION_H
+#define POLYNOMIAL_MULTIPLICATION_H
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+/*
+	Products of dense coefficient arrays, a[i] multiplies x^i.
+	multiplyCoefficients picks the method by the length of the shorter
+	operand:
+
+	schoolbook   below KARATSUBA_THRESHOLD, O(n m).
+	Karatsuba    O(n^1.58), up to FFT_THRESHOLD for floating point types,
+	             up to NTT_THRESHOLD for integral types and always for the
+	             rest of types.
+	FFT          floating point types, O(n log n) in complex arithmetic of
+	             at least double precision. The result is rounded, its
+	             error is about epsilon * log2(n) * |a| * |b| and the
+	             coefficients below that bound are returned as zero.
+	NTT          integral types, number theoretic transforms modulo three
+	             primes joined by the Chinese remainder theorem (Garner),
+	             exact while every coefficient of the product fits in a
+	             long long.
+*/
+const int KARATSUBA_THRESHOLD = 64;
+const int FFT_THRESHOLD = 256;
+const int NTT_THRESHOLD = 4096;
+
+template <typename T>
+std::vector<T> multiplyCoefficients(const std::vector<T>& a,
+                                    const std::vector<T>& b);
+
+/**
+ * It adds a * b to result, which has at least na + nb - 1 cells.
+ */
+template <typename T>
+void schoolbookProduct(const T* a, int na, const T* b, int nb, T* result) {
+  for (int i = 0; i < na; i++) {
+    const T value = a[i];
+    T* resultRow = result + i;
+    for (int j = 0; j < nb; j++) {
+      resultRow[j] += value * b[j];
+    }
+  }
+}
+
+/**
+ * It adds a * b to result for two operands of the same length n,
+ * (a0 + a1 x^m)(b0 + b1 x^m) = a0 b0 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) x^m
+ *                              + a1 b1 x^2m
+ * so three half products are computed instead of four.
+ */
+template <typename T>
+void karatsubaProduct(const T* a, const T* b, int n, T* result) {
+  if (n < KARATSUBA_THRESHOLD) {
+    schoolbookProduct(a, n, b, n, result);
+    return;
+  }
+  const int m = n / 2;
+  const int high = n - m;
+  std::vector<T> low_product(2 * m - 1), high_product(2 * high - 1);
+  karatsubaProduct(a, b, m, low_product.data());
+  karatsubaProduct(a + m, b + m, high, high_product.data());
+  std::vector<T> sum_a(a + m, a + n), sum_b(b + m, b + n);
+  for (int i = 0; i < m; i++) {
+    sum_a[i] += a[i];
+    sum_b[i] += b[i];
+  }
+  std::vector<T> middle(2 * high - 1);
+  karatsubaProduct(sum_a.data(), sum_b.data(), high, middle.data());
+  for (int i = 0; i < 2 * m - 1; i++) {
+    result[i] += low_product[i];
+    middle[i] -= low_product[i];
+  }
+  for (int i = 0; i < 2 * high - 1; i++) {
+    result[i + 2 * m] += high_product[i];
+    middle[i] -= high_product[i];
+  }
+  for (int i = 0; i < 2 * high - 1; i++) {
+    result[i + m] += middle[i];
+  }
+}
+
+/**
+ * Karatsuba for operands of different lengths, the longer one is cut in
+ * pieces as long as the shorter one.
+ */
+template <typename T>
+std::vector<T> karatsubaMultiply(const std::vector<T>& a,
+                                 const std::vector<T>& b) {
+  const std::vector<T>& longer = a.size() >= b.size() ? a : b;
+  const std::vector<T>& shorter = a.size() >= b.size() ? b : a;
+  const int n = shorter.size();
+  const int total = longer.size();
+  std::vector<T> result(total + n - 1);
+  std::vector<T> piece(n);
+  for (int first = 0; first < total; first += n) {
+    const int length = std::min(n, total - first);
+    if (length == n) {
+      karatsubaProduct(&longer[first], shorter.data(), n, &result[first]);
+    } else {
+      std::copy(&longer[first], &longer[first] + length, piece.begin());
+      std::fill(piece.begin() + length, piece.end(), T());
+      std::vector<T> tail(2 * n - 1);
+      karatsubaProduct(piece.data(), shorter.data(), n, tail.data());
+      for (int i = 0; i < length + n - 1; i++) {
+        result[first + i] += tail[i];
+      }
+    }
+  }
+  return result;
+}
+
+/**
+ * In place iterative radix-2 FFT of a power of two length,
+ * sign = -1 forward and +1 backward (without the 1/n factor).
+ * The roots of unity are computed one by one with cos and sin instead
+ * of by repeated products, which would accumulate rounding errors.
+ */
+template <typename Real>
+void fastFourierTransform(std::vector<std::complex<Real>>& values, int sign) {
+  const int n = values.size();
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) std::swap(values[i], values[j]);
+  }
+  const Real PI = std::acos(Real(-1));
+  std::vector<std::complex<Real>> roots(n / 2);
+  for (int i = 0; i < n / 2; i++) {
+    const Real angle = sign * 2 * PI * i / n;
+    roots[i] = std::complex<Real>(std::cos(angle), std::sin(angle));
+  }
+  for (int length = 2; length <= n; length <<= 1) {
+    const int half = length / 2;
+    const int step = n / length;
+    for (int first = 0; first < n; first += length) {
+      for (int k = 0; k < half; k++) {
+        const std::complex<Real> odd = values[first + k + half] *
+                                       roots[k * step];
+        values[first + k + half] = values[first + k] - odd;
+        values[first + k] += odd;
+      }
+    }
+  }
+}
+
+/**
+ * Both operands go in a single complex transform, a in the real part and
+ * b in the imaginary one, and their spectra are separated from it:
+ * A(k) B(k) = (Z(k)^2 - conj(Z(n - k))^2) / 4i. Two transforms of
+ * length n instead of three.
+ */
+template <typename T>
+std::vector<T> fftMultiply(const std::vector<T>& a, const std::vector<T>& b) {
+  typedef typename std::common_type<T, double>::type Real;
+  typedef std::complex<Real> Complex;
+  const int result_size = a.size() + b.size() - 1;
+  int n = 1;
+  int log_n = 0;
+  while (n < result_size) {
+    n <<= 1;
+    log_n++;
+  }
+  std::vector<Complex> values(n);
+  Real norm_a = 0, norm_b = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    values[i].real(a[i]);
+    norm_a += Real(a[i]) * Real(a[i]);
+  }
+  for (size_t i = 0; i < b.size(); i++) {
+    values[i].imag(b[i]);
+    norm_b += Real(b[i]) * Real(b[i]);
+  }
+  fastFourierTransform(values, -1);
+  std::vector<Complex> product(n);
+  for (int k = 0; k < n; k++) {
+    const Complex z = values[k];
+    const Complex w = std::conj(values[(n - k) & (n - 1)]);
+    product[k] = (z * z - w * w) * Complex(0, Real(-0.25) / n);
+  }
+  fastFourierTransform(product, 1);
+  const Real noise = 8 * std::numeric_limits<Real>::epsilon() *
+                     std::max(1, log_n) * std::sqrt(norm_a * norm_b);
+  std::vector<T> result(result_size);
+  for (int i = 0; i < result_size; i++) {
+    const Real value = product[i].real();
+    result[i] = std::abs(value) <= noise ? T() : T(value);
+  }
+  return result;
+}
+
+/*
+	Arithmetic modulo the NTT primes, all of them p = c 2^k + 1 with 3 as
+	a primitive root and k >= 23, so transforms of up to 2^23 points.
+	The transforms take the prime as a template argument so the compiler
+	replaces the divisions of the remainders by multiplications.
+*/
+
+typedef unsigned long long ModularInt;
+
+const ModularInt NTT_PRIME_0 = 998244353;
+const ModularInt NTT_PRIME_1 = 167772161;
+const ModularInt NTT_PRIME_2 = 469762049;
+const int NTT_MAX_LOG = 23;
+
+inline ModularInt modularPower(ModularInt base, ModularInt exponent,
+                               ModularInt modulus) {
+  ModularInt result = 1;
+  base %= modulus;
+  while (exponent > 0) {
+    if (exponent & 1) result = result * base % modulus;
+    base = base * base % modulus;
+    exponent >>= 1;
+  }
+  return result;
+}
+
+inline ModularInt modularInverse(ModularInt value, ModularInt modulus) {
+  return modularPower(value, modulus - 2, modulus);
+}
+
+/**
+ * The same butterflies as fastFourierTransform, over integers modulo a
+ * prime, so the product of two transforms is exact.
+ */
+template <ModularInt modulus>
+void numberTheoreticTransform(std::vector<ModularInt>& values, bool inverse) {
+  const int n = values.size();
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) std::swap(values[i], values[j]);
+  }
+  std::vector<ModularInt> roots(std::max(1, n / 2));
+  ModularInt root = modularPower(3, (modulus - 1) / n, modulus);
+  if (inverse) root = modularInverse(root, modulus);
+  roots[0] = 1;
+  for (int i = 1; i < n / 2; i++) {
+    roots[i] = roots[i - 1] * root % modulus;
+  }
+  for (int length = 2; length <= n; length <<= 1) {
+    const int half = length / 2;
+    const int step = n / length;
+    for (int first = 0; first < n; first += length) {
+      for (int k = 0; k < half; k++) {
+        const ModularInt even = values[first + k];
+        const ModularInt odd = values[first + k + half] * roots[k * step] %
+                               modulus;
+        values[first + k] = even + odd < modulus ? even + odd
+                                                 : even + odd - modulus;
+        values[first + k + half] = even >= odd ? even - odd
+                                               : even + modulus - odd;
+      }
+    }
+  }
+  if (inverse) {
+    const ModularInt scale = modularInverse(n, modulus);
+    for (ModularInt& value : values) {
+      value = value * scale % modulus;
+    }
+  }
+}
+
+template <ModularInt modulus, typename T>
+std::vector<ModularInt> cyclicProductModulo(const std::vector<T>& a,
+    const std::vector<T>& b, int n) {
+  std::vector<ModularInt> values_a(n), values_b(n);
+  const long long signed_modulus = modulus;
+  for (size_t i = 0; i < a.size(); i++) {
+    const long long value = static_cast<long long>(a[i]) % signed_modulus;
+    values_a[i] = value < 0 ? value + signed_modulus : value;
+  }
+  for (size_t i = 0; i < b.size(); i++) {
+    const long long value = static_cast<long long>(b[i]) % signed_modulus;
+    values_b[i] = value < 0 ? value + signed_modulus : value;
+  }
+  numberTheoreticTransform<modulus>(values_a, false);
+  numberTheoreticTransform<modulus>(values_b, false);
+  for (int i = 0; i < n; i++) {
+    values_a[i] = values_a[i] * values_b[i] % modulus;
+  }
+  numberTheoreticTransform<modulus>(values_a, true);
+  return values_a;
+}
+
+/**
+ * The product is computed modulo the three primes and every coefficient
+ * is rebuilt with Garner's algorithm as x = r0 + p0 (k1 + p1 k2), in
+ * mixed radix, so no integer wider than 64 bits is needed. x is taken
+ * as negative when it is above (p0 p1 p2 - 1) / 2, which is decided
+ * comparing the mixed radix digits.
+ */
+template <typename T>
+std::vector<T> nttMultiply(const std::vector<T>& a, const std::vector<T>& b) {
+  const int result_size = a.size() + b.size() - 1;
+  int n = 1;
+  while (n < result_size) {
+    n <<= 1;
+  }
+  if (n > (1 << NTT_MAX_LOG)) return karatsubaMultiply(a, b);
+  const ModularInt p0 = NTT_PRIME_0, p1 = NTT_PRIME_1, p2 = NTT_PRIME_2;
+  const std::vector<ModularInt> r0 = cyclicProductModulo<NTT_PRIME_0>(a, b, n);
+  const std::vector<ModularInt> r1 = cyclicProductModulo<NTT_PRIME_1>(a, b, n);
+  const std::vector<ModularInt> r2 = cyclicProductModulo<NTT_PRIME_2>(a, b, n);
+  const ModularInt inverse_p0_p1 = modularInverse(p0 % p1, p1);
+  const ModularInt inverse_p0_p2 = modularInverse(p0 % p2, p2);
+  const ModularInt inverse_p1_p2 = modularInverse(p1 % p2, p2);
+  // Mixed radix digits of (p0 p1 p2 - 1) / 2
+  const ModularInt half2 = (p2 - 1) / 2;
+  const ModularInt half1 = ((p2 - 1) % 2 * p1 + (p1 - 1)) / 2;
+  const ModularInt half0 = (((p2 - 1) % 2 * p1 + (p1 - 1)) % 2 * p0 +
+                            (p0 - 1)) / 2;
+  const ModularInt p0_p1 = p0 * p1;
+  const ModularInt all_primes = p0_p1 * p2; // modulo 2^64
+  std::vector<T> result(result_size);
+  for (int i = 0; i < result_size; i++) {
+    const ModularInt x0 = r0[i];
+    const ModularInt k1 = (r1[i] + p1 - x0 % p1) % p1 * inverse_p0_p1 % p1;
+    const ModularInt partial = (x0 + p0 * k1) % p2;
+    const ModularInt k2 = (r2[i] + p2 - partial) % p2 * inverse_p0_p2 % p2 *
+                          inverse_p1_p2 % p2;
+    ModularInt value = x0 + p0 * k1 + p0_p1 * k2;
+    const bool negative = k2 != half2 ? k2 > half2
+                        : k1 != half1 ? k1 > half1 : x0 > half0;
+    if (negative) value -= all_primes;
+    result[i] = static_cast<T>(static_cast<long long>(value));
+  }
+  return result;
+}
+
+template <typename T>
+std::vector<T> multiplyLongCoefficients(const std::vector<T>& a,
+    const std::vector<T>& b, std::true_type, std::false_type) {
+  return fftMultiply(a, b);
+}
+
+template <typename T>
+std::vector<T> multiplyLongCoefficients(const std::vector<T>& a,
+    const std::vector<T>& b, std::false_type, std::true_type) {
+  return nttMultiply(a, b);
+}
+
+template <typename T>
+std::vector<T> multiplyLongCoefficients(const std::vector<T>& a,
+    const std::vector<T>& b, std::false_type, std::false_type) {
+  return karatsubaMultiply(a, b);
+}
+
+template <typename T>
+std::vector<T> multiplyCoefficients(const std::vector<T>& a,
+                                    const std::vector<T>& b) {
+  if (a.empty() or b.empty()) return {};
+  const int shorter = std::min(a.size(), b.size());
+  if (shorter < KARATSUBA_THRESHOLD) {
+    std::vector<T> result(a.size() + b.size() - 1);
+    schoolbookProduct(a.data(), a.size(), b.data(), b.size(), result.data());
+    return result;
+  }
+  const bool floating = std::is_floating_point<T>::value;
+  if (shorter < (floating ? FFT_THRESHOLD : NTT_THRESHOLD)) {
+    return karatsubaMultiply(a, b);
+  }
+  return multiplyLongCoefficients(a, b, std::is_floating_point<T>(),
+                                  std::is_integral<T>());
+}
+
+#endif // POLYNOMIAL_MULTIPLICATION_H
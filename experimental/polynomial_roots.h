@@ -0,0 +1,206 @@
+#ifndef POLYNOMIAL_ROOTS_H
+#define POLYNOMIAL_ROOTS_H
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+
+#include "../library/parallel.h"
+
+/*
+	Roots of dense coefficient arrays, a[i] multiplies x^i, by the
+	Aberth-Ehrlich iteration. All the roots are refined at once, each one
+	by the Newton correction of p corrected by the repulsion of the other
+	roots, N / (1 - N sum 1 / (z_i - z_j)) with N = p(z_i) / p'(z_i), so
+	there is no deflation and every root keeps the accuracy of the
+	original coefficients. It converges cubically to simple roots.
+
+	A step computes every correction from the roots of the previous step,
+	so the roots are split across the thread pool, and the sum over the
+	other roots runs over separate arrays of real and imaginary parts,
+	which the compiler vectorizes.
+
+	A root stops moving once its correction is below accuracy times its
+	magnitude, or once |p(z)| is at the level of the rounding errors of
+	its evaluation and the corrections have stopped shrinking, since past
+	that point they are driven by those errors.
+*/
+const double ROOT_ACCURACY = 1e-12;
+const int ROOT_MAX_ITERATIONS = 200;
+
+/**
+ * It computes p(z) / p'(z) by Horner's scheme in real arithmetic and
+ * tells whether |p(z)| is below the rounding error of the evaluation.
+ * For |z| > 1 it evaluates the reversed polynomial at 1 / z instead,
+ * p(z) / p'(z) = z r(y) / (n r(y) - y r'(y)) with y = 1 / z, so the
+ * powers of z never overflow.
+ */
+template <typename T>
+bool newtonRatio(const std::vector<T>& a, T re, T im, T& ratioRe,
+                 T& ratioIm) {
+  const int degree = a.size() - 1;
+  const T magnitude = std::sqrt(re * re + im * im);
+  const bool reversed = magnitude > T(1);
+  T x = re, y = im;
+  if (reversed) {
+    const T norm = re * re + im * im;
+    x = re / norm;
+    y = -im / norm;
+  }
+  const T absolute = reversed ? T(1) / magnitude : magnitude;
+  T pRe = T(), pIm = T(), dRe = T(), dIm = T(), bound = T();
+  for (int k = 0; k <= degree; k++) {
+    const T c = reversed ? a[k] : a[degree - k];
+    const T nextDRe = dRe * x - dIm * y + pRe;
+    const T nextDIm = dRe * y + dIm * x + pIm;
+    dRe = nextDRe;
+    dIm = nextDIm;
+    const T nextPRe = pRe * x - pIm * y + c;
+    const T nextPIm = pRe * y + pIm * x;
+    pRe = nextPRe;
+    pIm = nextPIm;
+    bound = bound * absolute + std::abs(c);
+  }
+  T numRe = pRe, numIm = pIm, denRe = dRe, denIm = dIm;
+  if (reversed) {
+    // z r / (n r - y r')
+    numRe = re * pRe - im * pIm;
+    numIm = re * pIm + im * pRe;
+    denRe = degree * pRe - (x * dRe - y * dIm);
+    denIm = degree * pIm - (x * dIm + y * dRe);
+  }
+  const T denominator = denRe * denRe + denIm * denIm;
+  if (denominator == T()) {
+    ratioRe = ratioIm = T();
+  } else {
+    ratioRe = (numRe * denRe + numIm * denIm) / denominator;
+    ratioIm = (numIm * denRe - numRe * denIm) / denominator;
+  }
+  const T epsilon = std::numeric_limits<T>::epsilon();
+  return std::sqrt(pRe * pRe + pIm * pIm) <= epsilon * bound;
+}
+
+/**
+ * The initial approximations, from the upper convex hull of the points
+ * (i, log |a[i]|), the Newton polygon. An edge from i to j stands for
+ * j - i roots of magnitude about |a[i] / a[j]|^(1 / (j - i)), which are
+ * placed on a circle of that radius, with an offset angle so that no two
+ * of them are conjugate. Roots spread over many orders of magnitude get
+ * a circle each instead of all starting at the same radius, from which
+ * several approximations may end on the same root.
+ */
+template <typename T>
+void initialApproximations(const std::vector<T>& a, std::vector<T>& re,
+                           std::vector<T>& im) {
+  const int degree = a.size() - 1;
+  std::vector<int> hull;
+  std::vector<T> logarithms(degree + 1);
+  for (int i = 0; i <= degree; i++) {
+    if (a[i] == T()) continue;
+    logarithms[i] = std::log(std::abs(a[i]));
+    while (hull.size() >= 2) {
+      const int o = hull[hull.size() - 2], p = hull.back();
+      if ((p - o) * (logarithms[i] - logarithms[o]) <
+          (logarithms[p] - logarithms[o]) * (i - o)) {
+        break;
+      }
+      hull.pop_back();
+    }
+    hull.push_back(i);
+  }
+  const T pi = std::acos(T(-1));
+  // Zero coefficients below the first one give roots at zero
+  const T smallest = hull.size() > 1 ? std::exp((logarithms[hull[0]] -
+      logarithms[hull[1]]) / (hull[1] - hull[0])) : T(1);
+  for (int i = 0; i < hull[0]; i++) {
+    const T angle = 2 * pi * i / hull[0] + T(0.4);
+    re[i] = smallest / 2 * std::cos(angle);
+    im[i] = smallest / 2 * std::sin(angle);
+  }
+  for (size_t edge = 0; edge + 1 < hull.size(); edge++) {
+    const int first = hull[edge], count = hull[edge + 1] - first;
+    T radius = std::exp((logarithms[first] - logarithms[first + count]) /
+                        count);
+    if (not (radius > T()) or std::isinf(radius)) radius = T(1);
+    for (int k = 0; k < count; k++) {
+      const T angle = 2 * pi * k / count + 2 * pi * first / degree + T(0.4);
+      re[first + k] = radius * std::cos(angle);
+      im[first + k] = radius * std::sin(angle);
+    }
+  }
+}
+
+/**
+ * The roots of a polynomial of degree at least one, a.back() must not
+ * be zero. If some root has not converged after ROOT_MAX_ITERATIONS 
+ * steps the last approximations are returned.
+ */
+template <typename T>
+std::vector<std::complex<T>> aberthRoots(const std::vector<T>& a,
+                                         double accuracy = ROOT_ACCURACY) {
+  const int degree = a.size() - 1;
+  std::vector<T> re(degree), im(degree), nextRe(degree), nextIm(degree);
+  initialApproximations(a, re, im);
+  std::vector<char> converged(degree, false);
+  std::vector<T> lastStep(degree, std::numeric_limits<T>::infinity());
+  const int grain = std::max(1, PARALLEL_THRESHOLD / std::max(1, degree));
+  for (int iteration = 0; iteration < ROOT_MAX_ITERATIONS; iteration++) {
+    std::atomic<int> moving(0);
+    parallelFor(0, degree, grain, [&](int first, int last) {
+      int active = 0;
+      for (int i = first; i < last; i++) {
+        nextRe[i] = re[i];
+        nextIm[i] = im[i];
+        if (converged[i]) continue;
+        T ratioRe, ratioIm;
+        const bool noisy = newtonRatio(a, re[i], im[i], ratioRe, ratioIm);
+        const T zRe = re[i], zIm = im[i];
+        T sumRe = T(), sumIm = T();
+        for (int j = 0; j < degree; j++) {
+          const T differenceRe = zRe - re[j];
+          const T differenceIm = zIm - im[j];
+          const T norm = differenceRe * differenceRe +
+                         differenceIm * differenceIm;
+          const T inverse = j == i ? T() : T(1) / norm;
+          sumRe += differenceRe * inverse;
+          sumIm -= differenceIm * inverse;
+        }
+        // w = N / (1 - N S)
+        const T denRe = T(1) - (ratioRe * sumRe - ratioIm * sumIm);
+        const T denIm = -(ratioRe * sumIm + ratioIm * sumRe);
+        const T denominator = denRe * denRe + denIm * denIm;
+        const T wRe = (ratioRe * denRe + ratioIm * denIm) / denominator;
+        const T wIm = (ratioIm * denRe - ratioRe * denIm) / denominator;
+        nextRe[i] = zRe - wRe;
+        nextIm[i] = zIm - wIm;
+        const T step = std::sqrt(wRe * wRe + wIm * wIm);
+        const T magnitude = std::sqrt(zRe * zRe + zIm * zIm);
+        if (not (step == step)) {
+          nextRe[i] = zRe;
+          nextIm[i] = zIm;
+          converged[i] = true;
+        } else if (step <= accuracy * magnitude or 
+                   (noisy and step >= lastStep[i])) {
+          converged[i] = true;
+        } else {
+          active++;
+        }
+        lastStep[i] = step;
+      }
+      moving += active;
+    });
+    re.swap(nextRe);
+    im.swap(nextIm);
+    if (moving == 0) break;
+  }
+  std::vector<std::complex<T>> roots(degree);
+  for (int i = 0; i < degree; i++) {
+    roots[i] = std::complex<T>(re[i], im[i]);
+  }
+  return roots;
+}
+
+#endif // POLYNOMIAL_ROOTS_H
@@ -7,6 +7,8 @@
 #define POLYNOMIALS_CPP
  
 #include <algorithm> 
+#include <queue>
+#include <utility>
  
 template <typename T, typename U>
 std::ostream& operator<<(std::ostream& outputStream, 
@@ -28,12 +30,14 @@ template <typename T, typename U>
 Polynomial<T, U>::Polynomial(const std::vector<Monomial<T, U>>& mons)
     : data (mons) {
   group(data);
+  chooseRepresentation();
 }
 
 template <typename T, typename U>
 Polynomial<T, U>::Polynomial(std::initializer_list<Monomial<T, U>> mons)
     : data (mons) {
   group(data);
+  chooseRepresentation();
 }
 
 template <typename T, typename U>
@@ -43,13 +47,73 @@ Polynomial<T, U> Polynomial<T, U>::operator-() const {
   for (const Monomial<T, U>& mon : data) {
     resulting_pol.data.push_back(-mon);
   }
+  resulting_pol.chooseRepresentation();
   return resulting_pol;
 }
 
 template <typename T, typename U>
-template <typename V> auto Polynomial<T, U>::evaluate(const V& value) 
-    -> decltype(T() * pow(value, U())) const {
-  decltype(T() * pow(value, U())) result;
+void Polynomial<T, U>::chooseRepresentation() {
+  dense = DensePolynomial<T>();
+  chooseRepresentation(std::is_integral<U>());
+}
+
+template <typename T, typename U>
+void Polynomial<T, U>::chooseRepresentation(std::true_type) {
+  if (data.empty() or data.back().exp < 0) return;
+  const double terms = data[0].exp + 1.0;
+  if (data.size() < DENSE_FILL_RATIO * terms) return;
+  std::vector<T> coefficients(data[0].exp + 1);
+  for (const Monomial<T, U>& monomial : data) {
+    coefficients[monomial.exp] += monomial.coef;
+  }
+  dense = DensePolynomial<T>(std::move(coefficients));
+}
+
+template <typename T, typename U>
+template <typename V> auto Polynomial<T, U>::evaluate(const V& value) const
+    -> decltype(T() * pow(value, U())) {
+  if (not dense.isEmpty()) {
+    // In the type of the result, so integer arguments do not overflow
+    typedef decltype(T() * pow(value, U())) R;
+    const R x = R() + value;
+    return dense.degree() < ESTRIN_DEGREE ? dense.evaluate(x) 
+                                          : dense.evaluateEstrin(x);
+  }
+  return evaluateSparse(value, std::is_integral<U>());
+}
+
+/**
+ * Horner's scheme over the gaps between the exponents, 
+ * c1 x^9 + c2 x^4 + c3 x = ((c1 x^5 + c2) x^3 + c3) x
+ * where every power is computed by repeated squaring.
+ */
+template <typename T, typename U>
+template <typename V> auto Polynomial<T, U>::evaluateSparse(const V& value, 
+    std::true_type) const -> decltype(T() * pow(value, U())) {
+  decltype(T() * pow(value, U())) result = decltype(T() * pow(value, U()))();
+  if (data.empty()) return result;
+  // The powers are taken in the type of the result, as the batched 
+  // evaluation does, so integer arguments do not overflow
+  const decltype(T() * pow(value, U())) x = result + value;
+  result += data[0].coef;
+  const int data_size = data.size();
+  for (int i = 1; i < data_size; i++) {
+    result = result * integerPower(x, data[i - 1].exp - data[i].exp) + 
+             data[i].coef;
+  }
+  const U last_exp = data[data_size - 1].exp;
+  if (last_exp > 0) {
+    result *= integerPower(x, last_exp);
+  } else if (last_exp < 0) {
+    result /= integerPower(x, -last_exp);
+  }
+  return result;
+}
+
+template <typename T, typename U>
+template <typename V> auto Polynomial<T, U>::evaluateSparse(const V& value, 
+    std::false_type) const -> decltype(T() * pow(value, U())) {
+  decltype(T() * pow(value, U())) result = decltype(T() * pow(value, U()))();
   for (const Monomial<T, U>& monomial : data) {
     result += monomial.coef * pow(value, monomial.exp);
   }
@@ -57,28 +121,207 @@ template <typename V> auto Polynomial<T, U>::evaluate(const V& value)
 }
 
 template <typename T, typename U>
-void Polynomial<T, U>::group(std::vector<Monomial<T, U>>& data) {
-  if (not data.empty()) {
-    std::sort(data.begin(), data.end());
-    int currentExponent = data[0].exp;
-    std::vector<Monomial<T, U>> resulting_polynomial;
-    int dataSize = data.size();
-    for (int i = 0; i < dataSize; currentExponent--) {
-      double coef = 0.0;
-      while(data[i].exp == currentExponent) {
-        if (i == dataSize)
-            break;
-        coef += data[i].coef;
-        i++;
+template <typename V, typename R> 
+void Polynomial<T, U>::evaluate(const V* first, const V* last, 
+                                R* results) const {
+  INSTRUMENT_OPERATION("Polynomial::evaluate", last - first, 
+                       2LL * (last - first) * size(), 
+                       (sizeof(V) + sizeof(R)) * (last - first));
+  if (not dense.isEmpty()) {
+    dense.evaluate(first, last, results);
+    return;
+  }
+  const int count = last - first;
+  for (int block = 0; block < count; block += EVALUATION_BLOCK) {
+    evaluateSparseBlock(first + block, 
+                        std::min(EVALUATION_BLOCK, count - block), 
+                        results + block, std::is_integral<U>());
+  }
+}
+
+/**
+ * The same scheme as evaluateSparse for count <= EVALUATION_BLOCK points
+ * at once. Every gap between exponents is the same for all the points, 
+ * so its power is computed by repeated squaring in lockstep over them.
+ */
+template <typename T, typename U>
+template <typename V, typename R> 
+void Polynomial<T, U>::evaluateSparseBlock(const V* values, int count, 
+    R* results, std::true_type) const {
+  R base[EVALUATION_BLOCK];
+  R power[EVALUATION_BLOCK];
+  for (int p = 0; p < count; p++) {
+    results[p] = data.empty() ? R() : R() + data[0].coef;
+  }
+  const int data_size = data.size();
+  for (int i = 1; i <= data_size; i++) {
+    const bool last_term = i == data_size;
+    U exp = last_term ? data[i - 1].exp : data[i - 1].exp - data[i].exp;
+    const bool divide = exp < 0;
+    if (divide) exp = -exp;
+    if (last_term and exp == 0) continue;
+    for (int p = 0; p < count; p++) {
+      base[p] = R() + values[p];
+      power[p] = R(1);
+    }
+    while (exp > 0) {
+      if (exp % 2 != 0) {
+        for (int p = 0; p < count; p++) {
+          power[p] *= base[p];
+        }
       }
-      if (coef != T()) {
-        resulting_polynomial.push_back(Monomial<T, U>(coef, currentExponent));
+      exp /= 2;
+      if (exp > 0) {
+        for (int p = 0; p < count; p++) {
+          base[p] *= base[p];
+        }
+      }
+    }
+    if (not last_term) {
+      const T coef = data[i].coef;
+      for (int p = 0; p < count; p++) {
+        results[p] = results[p] * power[p] + coef;
+      }
+    } else if (divide) {
+      for (int p = 0; p < count; p++) {
+        results[p] /= power[p];
+      }
+    } else {
+      for (int p = 0; p < count; p++) {
+        results[p] *= power[p];
       }
     }
-    data = resulting_polynomial;
   }
 }
 
+template <typename T, typename U>
+template <typename V, typename R> 
+void Polynomial<T, U>::evaluateSparseBlock(const V* values, int count, 
+    R* results, std::false_type) const {
+  for (int p = 0; p < count; p++) {
+    results[p] = evaluateSparse(values[p], std::false_type());
+  }
+}
+
+/**
+ * Chunks of the values are evaluated in parallel, each chunk with about
+ * PARALLEL_THRESHOLD operations.
+ */
+template <typename T, typename U>
+template <typename V> 
+auto Polynomial<T, U>::evaluate(const std::vector<V>& values) const 
+    -> std::vector<decltype(T() * pow(V(), U()))> {
+  std::vector<decltype(T() * pow(V(), U()))> results(values.size());
+  const int terms = dense.isEmpty() ? size() : dense.size();
+  const int grain = std::max(EVALUATION_BLOCK, 
+                             PARALLEL_THRESHOLD / std::max(1, terms));
+  parallelFor(0, values.size(), grain, [&](int first, int last) {
+    evaluate(values.data() + first, values.data() + last, 
+             results.data() + first);
+  });
+  return results;
+}
+
+/**
+ * coefficients[i] multiplies x^i. Negative exponents have no place there,
+ * so it returns an empty vector when there is any.
+ */
+template <typename T, typename U>
+std::vector<T> denseCoefficients(const Polynomial<T, U>& polynomial) {
+  const auto& data = polynomial.getData();
+  if (data.empty() or data.back().exp < 0) return {};
+  std::vector<T> coefficients(data[0].exp + 1);
+  for (const Monomial<T, U>& monomial : data) {
+    coefficients[monomial.exp] = monomial.coef;
+  }
+  return coefficients;
+}
+
+template <typename T, typename U>
+Polynomial<T, U> polynomialFromCoefficients(
+    const std::vector<T>& coefficients) {
+  std::vector<Monomial<T, U>> mons;
+  for (int i = coefficients.size() - 1; i >= 0; i--) {
+    if (coefficients[i] != T()) {
+      mons.push_back(Monomial<T, U>(coefficients[i], i));
+    }
+  }
+  return Polynomial<T, U>(mons);
+}
+
+/**
+ * It needs integer exponents. See DensePolynomial::evaluateMultipoint,
+ * polynomials with negative exponents go through the batched evaluation.
+ */
+template <typename T, typename U>
+std::vector<T> Polynomial<T, U>::evaluateMultipoint(
+    const std::vector<T>& points) const {
+  static_assert(std::is_integral<U>::value, 
+                "evaluateMultipoint needs integer exponents");
+  INSTRUMENT_OPERATION("Polynomial::evaluateMultipoint", points.size(), 
+                       2LL * points.size() * size(), 
+                       2 * sizeof(T) * points.size());
+  if (not dense.isEmpty()) {
+    return dense.evaluateMultipoint(points);
+  }
+  if (not data.empty() and data.back().exp < 0) {
+    std::vector<T> results(points.size());
+    evaluate(points.data(), points.data() + points.size(), results.data());
+    return results;
+  }
+  return DensePolynomial<T>(denseCoefficients(*this))
+      .evaluateMultipoint(points);
+}
+
+/**
+ * The lowest exponent is factored out first, x^low q(x), so a positive 
+ * one gives that many exact zero roots and the iteration only sees q.
+ */
+template <typename T, typename U>
+std::vector<std::complex<T>> Polynomial<T, U>::roots(double accuracy) const {
+  static_assert(std::is_floating_point<T>::value, 
+                "roots needs floating point coefficients");
+  static_assert(std::is_integral<U>::value, "roots needs integer exponents");
+  INSTRUMENT_OPERATION("Polynomial::roots", size(), 0, 0);
+  std::vector<std::complex<T>> resulting_roots;
+  if (data.empty()) return resulting_roots;
+  const U low_exp = data.back().exp;
+  std::vector<T> coefficients(data[0].exp - low_exp + 1);
+  for (const Monomial<T, U>& monomial : data) {
+    coefficients[monomial.exp - low_exp] = monomial.coef;
+  }
+  if (coefficients.size() > 1) {
+    resulting_roots = aberthRoots(coefficients, accuracy);
+  }
+  for (U i = 0; i < low_exp; i++) {
+    resulting_roots.push_back(std::complex<T>());
+  }
+  return resulting_roots;
+}
+
+/**
+ * It sorts the monomials by decreasing exponent and adds up the ones with
+ * the same exponent in a single pass, dropping the zeros. 
+ * O(n log n) whatever the exponents are.
+ */
+template <typename T, typename U>
+void Polynomial<T, U>::group(std::vector<Monomial<T, U>>& data) {
+  std::sort(data.begin(), data.end());
+  const int data_size = data.size();
+  int kept = 0;
+  for (int i = 0; i < data_size;) {
+    const U exp = data[i].exp;
+    T coef = T();
+    for (; i < data_size and data[i].exp == exp; i++) {
+      coef += data[i].coef;
+    }
+    if (coef != T()) {
+      data[kept++] = Monomial<T, U>(coef, exp);
+    }
+  }
+  data.erase(data.begin() + kept, data.end());
+}
+
 // this->data exponents: 4 3 1
 // input monomial exponent : 2
 // Result: this->data exponents: 4 3 2 1   
@@ -107,28 +350,133 @@ Polynomial<T, U>& Polynomial<T, U>::operator<<(const Monomial<T, U>& monomial) {
   } else {
     data.push_back(monomial);
   }
+  chooseRepresentation();
+  return *this;
 } 
 
+/**
+ * Both term lists are already sorted, so they are merged in O(n + m).
+ */
 template <typename T, typename U>
 Polynomial<T, U>& Polynomial<T, U>::operator+=(const Polynomial<T, U>& other) {
-  data.insert(data.end(), other.begin(), other.end());
-  group(data);
+  INSTRUMENT_OPERATION("Polynomial::operator+=", size() + other.size(), 
+                       size() + other.size(), 
+                       2 * sizeof(Monomial<T, U>) * (size() + other.size()));
+  std::vector<Monomial<T, U>> resulting_data;
+  resulting_data.reserve(data.size() + other.data.size());
+  auto it1 = data.begin();
+  auto it2 = other.data.begin();
+  while (it1 != data.end() and it2 != other.data.end()) {
+    if (it1->exp == it2->exp) {
+      const T coef = it1->coef + it2->coef;
+      if (coef != T()) {
+        resulting_data.push_back(Monomial<T, U>(coef, it1->exp));
+      }
+      ++it1;
+      ++it2;
+    } else if (it2->exp < it1->exp) {
+      resulting_data.push_back(*it1++);
+    } else {
+      resulting_data.push_back(*it2++);
+    }
+  }
+  resulting_data.insert(resulting_data.end(), it1, data.end());
+  resulting_data.insert(resulting_data.end(), it2, other.data.end());
+  data.swap(resulting_data);
+  chooseRepresentation();
   return *this;
 }
 
+/**
+ * Johnson's algorithm: a heap holds, for every term of the shorter 
+ * polynomial, its next product with a term of the longer one, so the 
+ * products come out by decreasing exponent and the ones with the same 
+ * exponent are added as they come. The result is grouped already, 
+ * O(n m log min(n, m)) time and O(min(n, m)) memory besides the result,
+ * whatever the gaps between the exponents are.
+ */
 template <typename T, typename U>
-Polynomial<T, U>& Polynomial<T, U>::operator*=(const Polynomial<T, U>& other) {
-  const int msize = size();
-  const int pol2_size = other.size();
-  std::vector<Monomial<T, U>> resulting_data(msize * pol2_size);
-  for (int i = 0, k = 0; i < msize; i++) {
-    for (int j = 0; j < pol2_size; j++, k++) {
-      resulting_data[k] = Monomial<T, U>(data[i].coef * other.data[j].coef, 
-                                        data[i].exp + other.data[j].exp);
+std::vector<Monomial<T, U>> multiplySparseTerms(
+    const std::vector<Monomial<T, U>>& terms1, 
+    const std::vector<Monomial<T, U>>& terms2) {
+  const bool first_shorter = terms1.size() <= terms2.size();
+  const std::vector<Monomial<T, U>>& shorter = first_shorter ? terms1 : terms2;
+  const std::vector<Monomial<T, U>>& longer = first_shorter ? terms2 : terms1;
+  std::vector<Monomial<T, U>> resulting_data;
+  if (shorter.empty()) return resulting_data;
+  const int shorter_size = shorter.size();
+  const int longer_size = longer.size();
+  std::vector<int> next(shorter_size, 0);
+  std::priority_queue<std::pair<U, int>> heap;
+  for (int i = 0; i < shorter_size; i++) {
+    heap.push(std::make_pair(shorter[i].exp + longer[0].exp, i));
+  }
+  while (not heap.empty()) {
+    const U exp = heap.top().first;
+    T coef = T();
+    while (not heap.empty() and heap.top().first == exp) {
+      const int i = heap.top().second;
+      heap.pop();
+      coef += shorter[i].coef * longer[next[i]].coef;
+      if (++next[i] < longer_size) {
+        heap.push(std::make_pair(shorter[i].exp + longer[next[i]].exp, i));
+      }
+    }
+    if (coef != T()) {
+      resulting_data.push_back(Monomial<T, U>(coef, exp));
+    }
+  }
+  return resulting_data;
+}
+
+/**
+ * With integer exponents and enough terms the product is done over the
+ * dense arrays of coefficients (see polynomial_multiplication.h) instead
+ * of by the n * m products of monomials. It happens when n * m is at
+ * least the number of exponents spanned by both polynomials.
+ */
+template <typename T, typename U>
+bool Polynomial<T, U>::multiplyDensely(const Polynomial<T, U>& other, 
+    std::true_type) {
+  if (data.empty() or other.data.empty()) return false;
+  const U low_exp = data.back().exp;
+  const U other_low_exp = other.data.back().exp;
+  const double span = double(data[0].exp - low_exp) + 1.0;
+  const double other_span = double(other.data[0].exp - other_low_exp) + 1.0;
+  if (double(data.size()) * other.data.size() < span + other_span) {
+    return false;
+  }
+  std::vector<T> coefficients(data[0].exp - low_exp + 1);
+  for (const Monomial<T, U>& monomial : data) {
+    coefficients[monomial.exp - low_exp] = monomial.coef;
+  }
+  std::vector<T> other_coefficients(other.data[0].exp - other_low_exp + 1);
+  for (const Monomial<T, U>& monomial : other.data) {
+    other_coefficients[monomial.exp - other_low_exp] = monomial.coef;
+  }
+  const std::vector<T> product = multiplyCoefficients(coefficients, 
+                                                      other_coefficients);
+  data.clear();
+  for (int i = product.size() - 1; i >= 0; i--) {
+    if (product[i] != T()) {
+      data.push_back(Monomial<T, U>(product[i], low_exp + other_low_exp + i));
     }
   }
-  group(resulting_data);
-  data = resulting_data;
+  chooseRepresentation();
+  return true;
+}
+
+template <typename T, typename U>
+Polynomial<T, U>& Polynomial<T, U>::operator*=(const Polynomial<T, U>& other) {
+  INSTRUMENT_OPERATION("Polynomial::operator*=", 1LL * size() * other.size(), 
+                       2LL * size() * other.size(), 
+                       sizeof(Monomial<T, U>) * (size() + other.size()));
+  if (multiplyDensely(other, std::is_integral<U>())) {
+    return *this;
+  }
+  data = multiplySparseTerms(data, other.data);
+  chooseRepresentation();
+  return *this;
 }
 
 template <typename T, typename U>
@@ -138,6 +486,7 @@ Polynomial<T, U>& Polynomial<T, U>::operator*=(const Monomial<T, U>& monomial) {
     data[i].coef *= monomial.coef;
     data[i].exp += monomial.exp;
   }
+  chooseRepresentation();
   return *this;
 }
 
@@ -191,13 +540,104 @@ Polynomial<T, U> operator*(const Monomial<T, U>& monomial,
   return resulting_polynomial;                                  
 }
 
+/**
+ * Repeated squaring, O(log power) products. A power below one gives the
+ * constant polynomial 1.
+ */
 template <typename T, typename U>
 Polynomial<T, U> pow(const Polynomial<T, U>& polynomial, int power) {
-  Polynomial<T, U> resulting_polynomial = polynomial;
-  for (int i = 1; i < power; i++){
-      resulting_polynomial *= polynomial;
+  INSTRUMENT_OPERATION("pow", polynomial.size(), 0, 0);
+  Polynomial<T, U> resulting_polynomial = Monomial<T, U>(T(1));
+  Polynomial<T, U> square = polynomial;
+  bool first = true;
+  while (power > 0) {
+    if (power % 2 != 0) {
+      if (first) {
+        resulting_polynomial = square;
+        first = false;
+      } else {
+        resulting_polynomial *= square;
+      }
+    }
+    power /= 2;
+    if (power > 0) square *= square;
   }
   return resulting_polynomial;
 }
 
+template <typename T>
+bool divideDenseCoefficients(const std::vector<T>& a, const std::vector<T>& b,
+    std::vector<T>& quotient, std::vector<T>& remainder, double, 
+    std::true_type) {
+  return divideIntegerCoefficients(a, b, quotient, remainder);
+}
+
+template <typename T>
+bool divideDenseCoefficients(const std::vector<T>& a, const std::vector<T>& b,
+    std::vector<T>& quotient, std::vector<T>& remainder, double tolerance, 
+    std::false_type) {
+  divideCoefficients(a, b, quotient, remainder);
+  trimCoefficients(remainder, remainderBound(a, tolerance));
+  return true;
+}
+
+/**
+ * Long division while the operands are short and Newton's reciprocal
+ * with the fast products above NEWTON_DIVISION_THRESHOLD coefficients, 
+ * against the O(n m) monomial by monomial division.
+ */
+template <typename T, typename U>
+bool divmod(const Polynomial<T, U>& dividend, const Polynomial<T, U>& divisor,
+            Polynomial<T, U>& quotient, Polynomial<T, U>& remainder,
+            double tolerance) {
+  static_assert(std::is_integral<U>::value, 
+                "Polynomial division needs integer exponents");
+  INSTRUMENT_OPERATION("divmod", dividend.size() + divisor.size(), 
+                       2LL * dividend.size() * divisor.size(), 
+                       sizeof(T) * (dividend.size() + divisor.size()));
+  if (divisor.size() == 0) return false;
+  if (divisor.getData().back().exp < 0) return false;
+  if (dividend.size() > 0 and dividend.getData().back().exp < 0) return false;
+  std::vector<T> quotient_coefficients, remainder_coefficients;
+  if (not divideDenseCoefficients(denseCoefficients(dividend), 
+                                  denseCoefficients(divisor), 
+                                  quotient_coefficients, 
+                                  remainder_coefficients, tolerance, 
+                                  std::is_integral<T>())) {
+    return false;
+  }
+  quotient = polynomialFromCoefficients<T, U>(quotient_coefficients);
+  remainder = polynomialFromCoefficients<T, U>(remainder_coefficients);
+  return true;
+}
+
+template <typename T, typename U>
+Polynomial<T, U> mod(const Polynomial<T, U>& dividend, 
+                     const Polynomial<T, U>& divisor, double tolerance) {
+  Polynomial<T, U> quotient, remainder;
+  divmod(dividend, divisor, quotient, remainder, tolerance);
+  return remainder;
+}
+
+/**
+ * Monic over a field, primitive with a positive leading coefficient 
+ * (times the gcd of the contents) over the integers.
+ */
+template <typename T, typename U>
+Polynomial<T, U> gcd(const Polynomial<T, U>& pol1, 
+                     const Polynomial<T, U>& pol2, double tolerance) {
+  static_assert(std::is_integral<U>::value, 
+                "Polynomial gcd needs integer exponents");
+  INSTRUMENT_OPERATION("gcd", pol1.size() + pol2.size(), 
+                       2LL * pol1.size() * pol2.size(), 
+                       sizeof(T) * (pol1.size() + pol2.size()));
+  if ((pol1.size() > 0 and pol1.getData().back().exp < 0) or 
+      (pol2.size() > 0 and pol2.getData().back().exp < 0)) {
+    return {};
+  }
+  return polynomialFromCoefficients<T, U>(
+      gcdCoefficients(denseCoefficients(pol1), denseCoefficients(pol2), 
+                      tolerance));
+}
+
 #endif // POLYNOMIALS_CPP
\ No newline at end of file
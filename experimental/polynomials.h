@@ -4,6 +4,13 @@
 #include <vector>
 #include <ostream>
 #include <cmath>
+#include <type_traits>
+#include <complex>
+
+#include "dense_polynomials.h"
+#include "polynomial_roots.h"
+#include "../library/parallel.h"
+#include "../library/instrumentation.h"
 
 /**
  * Monomial struct
@@ -28,7 +35,7 @@ struct Monomial {
     return *this;
   }
   Monomial& operator*=(const Monomial& other) {
-    coef *= other.ceof;
+    coef *= other.coef;
     exp += other.exp;
     return *this;
   }
@@ -56,6 +63,17 @@ struct Monomial {
 
 #include "monomial_operators.h"
 
+template <typename T> class Matrix;
+
+/*
+	A polynomial with integer exponents, none of them negative, keeps a
+	DensePolynomial copy of its coefficients when at least this fraction 
+	of them is not zero, and it is evaluated through it. Polynomials with 
+	at least ESTRIN_DEGREE are evaluated by Estrin's scheme.
+*/
+const double DENSE_FILL_RATIO = 0.25;
+const int ESTRIN_DEGREE = 8;
+
 /**
  * Polynomial class 
  * Model of polynomials
@@ -64,9 +82,13 @@ template <typename T, typename U>
 class Polynomial {
  public:
   Polynomial() {}
-  Polynomial(const Monomial<T, U>& monomial) : data (1, monomial) {}
-  Polynomial(const Polynomial& other) : data (other.data) {}
-  Polynomial(Polynomial&& other) : data (std::move(other.data)) {}
+  Polynomial(const Monomial<T, U>& monomial) : data (1, monomial) {
+    chooseRepresentation();
+  }
+  Polynomial(const Polynomial& other) 
+      : data (other.data), dense (other.dense) {}
+  Polynomial(Polynomial&& other) 
+      : data (std::move(other.data)), dense (std::move(other.dense)) {}
   Polynomial(const std::vector<Monomial<T, U>>& mons);
   Polynomial(std::initializer_list<Monomial<T, U>> mons);
   U degree() const { return data.empty() ? U() : data[0].exp; }
@@ -75,6 +97,7 @@ class Polynomial {
   Polynomial& operator=(const Polynomial& other) { 
     if (this != &other) {
       data = other.data;
+      dense = other.dense;
     }
     return *this;
   }
@@ -82,6 +105,7 @@ class Polynomial {
   Polynomial& operator=(Polynomial&& other) { 
     if (this != &other) {
       data = std::move(other.data); 
+      dense = std::move(other.dense);
     }
     return *this;
   }
@@ -98,7 +122,33 @@ class Polynomial {
   }
   
   template <typename V>
-  auto evaluate(const V& value) -> decltype(T() * pow(value, U())) const;
+  auto evaluate(const V& value) const -> decltype(T() * pow(value, U()));
+  /*
+  	Batched evaluations, at every value of [first, last) into results or
+  	at every value of a vector, in parallel (see parallel.h).
+  	evaluateMultipoint uses the subproduct tree instead, for integer 
+  	exponents, many points and exact coefficient types, see 
+  	polynomial_division.h.
+  */
+  template <typename V, typename R>
+  void evaluate(const V* first, const V* last, R* results) const;
+  template <typename V>
+  auto evaluate(const std::vector<V>& values) const 
+      -> std::vector<decltype(T() * pow(V(), U()))>;
+  std::vector<T> evaluateMultipoint(const std::vector<T>& points) const;
+  /*
+  	p(A) for a square matrix A, by the Paterson-Stockmeyer scheme. It is 
+  	defined in matrix_polynomials.h, which must be included to use it.
+  */
+  template <typename V>
+  auto evaluate(const Matrix<V>& matrix) const -> Matrix<decltype(T() * V())>;
+  /*
+  	All the complex roots with their multiplicities, by the Aberth-Ehrlich
+  	iteration (see polynomial_roots.h), for floating point coefficients
+  	and integer exponents. accuracy is the relative error targeted.
+  */
+  std::vector<std::complex<T>> roots(double accuracy = ROOT_ACCURACY) const;
+  bool isDense() const { return not dense.isEmpty(); }
   
   const std::vector<Monomial<T, U>>& getData() const { return data; }
   typename std::vector<Monomial<T, U>>::const_iterator begin() const { 
@@ -111,11 +161,52 @@ class Polynomial {
   static void group(std::vector<Monomial<T, U>>& data);
  private:
   std::vector<Monomial<T, U>> data;
+  DensePolynomial<T> dense;
+  
+  void chooseRepresentation();
+  void chooseRepresentation(std::true_type);
+  void chooseRepresentation(std::false_type) {}
+  bool multiplyDensely(const Polynomial& other, std::true_type);
+  bool multiplyDensely(const Polynomial&, std::false_type) { return false; }
+  template <typename V>
+  auto evaluateSparse(const V& value, std::true_type) const 
+      -> decltype(T() * pow(value, U()));
+  template <typename V>
+  auto evaluateSparse(const V& value, std::false_type) const 
+      -> decltype(T() * pow(value, U()));
+  template <typename V, typename R>
+  void evaluateSparseBlock(const V* values, int count, R* results, 
+                           std::true_type) const;
+  template <typename V, typename R>
+  void evaluateSparseBlock(const V* values, int count, R* results, 
+                           std::false_type) const;
 };
 
 template <typename T, typename U>
 Polynomial<T, U> pow(const Polynomial<T, U>& polynomial, int power);
 
+/*
+	Division of polynomials with integer exponents, none of them negative,
+	over their dense coefficients (see polynomial_division.h). divmod 
+	returns false when the division is not possible: a zero divisor, 
+	negative exponents or, for integer coefficients, a quotient which is 
+	not in Z[x]; mod and gcd return the zero polynomial then.
+	For floating point coefficients the tolerance is relative to the 
+	largest coefficient of the dividend.
+*/
+template <typename T, typename U>
+bool divmod(const Polynomial<T, U>& dividend, const Polynomial<T, U>& divisor,
+            Polynomial<T, U>& quotient, Polynomial<T, U>& remainder,
+            double tolerance = DIVISION_TOLERANCE);
+template <typename T, typename U>
+Polynomial<T, U> mod(const Polynomial<T, U>& dividend, 
+                     const Polynomial<T, U>& divisor,
+                     double tolerance = DIVISION_TOLERANCE);
+template <typename T, typename U>
+Polynomial<T, U> gcd(const Polynomial<T, U>& pol1, 
+                     const Polynomial<T, U>& pol2,
+                     double tolerance = DIVISION_TOLERANCE);
+
 #include "polynomials.cpp"
 
 #endif // POLYNOMIALS_H
\ No newline at end of file
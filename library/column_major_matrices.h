@@ -0,0 +1,333 @@
+/*
+  @file column_major_matrices.h Matrices stored column by column
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef COLUMN_MAJOR_MATRICES_H
+#define COLUMN_MAJOR_MATRICES_H
+
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+
+/*
+	Order of the cells of a matrix in memory. Matrix keeps the cells of 
+	every row together, ColumnMajorMatrix the cells of every column, as 
+	Fortran and most LAPACK style sources do.
+	
+	A ColumnMajorMatrix holds its columns as the rows of a Matrix, that is
+	the transpose of the matrix in row-major order, so it is read as a 
+	TransposedMatrix and goes through every function and operator taking
+	one, which read it in its own order instead of converting it:
+	
+	  column major * column major   C^T = B^T A^T, a row-major product of 
+	                                the storages, column major result
+	  row major * column major      rows of A times columns of B, both 
+	                                contiguous, row-major result
+	  column major * row major      the kernel of TransposedMatrix * 
+	                                Matrix, row-major result
+	
+	Elementwise operations between two column major matrices run on the
+	storages and give a column major result, mixed ones give a row-major
+	one read by tiles.
+	Transposing relabels the layout for free: the transpose of a column 
+	major matrix is its storage as a Matrix, and ColumnMajorMatrix::
+	fromColumns(std::move(m)) is the transpose of a Matrix m.
+*/
+enum class Layout { RowMajor, ColumnMajor };
+
+template <typename T>
+class ColumnMajorMatrix;
+
+/**
+ * The matrix type of a layout, for code generic over it.
+ */
+template <typename T, Layout L>
+using LayoutMatrix = typename std::conditional<L == Layout::RowMajor, 
+    Matrix<T>, ColumnMajorMatrix<T>>::type;
+
+/**
+ * ColumnMajorMatrix class
+ * Matrix stored column by column, see above. column(j) gives the cells
+ * of a column, contiguous in memory.
+ */
+template <typename T>
+class ColumnMajorMatrix {
+ public:
+  ColumnMajorMatrix() {}
+  ColumnMajorMatrix(int rows, int columns, const T& value = T())
+      : storage (columns, rows, value) {}
+  // data holds rows * columns cells in column order, (i, j) at i + j rows
+  ColumnMajorMatrix(int rows, int columns, const T* data);
+  ColumnMajorMatrix(std::initializer_list<std::initializer_list<T>> il)
+      : storage (Matrix<T>(il).transpose()) {}
+  explicit ColumnMajorMatrix(const Matrix<T>& matrix) 
+      : storage (matrix.transpose()) {}
+  
+  // The rows of columns become the columns of the result, O(1)
+  static ColumnMajorMatrix fromColumns(Matrix<T>&& columns) {
+    ColumnMajorMatrix matrix;
+    matrix.storage = std::move(columns);
+    return matrix;
+  }
+  
+  int getRows() const { return storage.getColumns(); }
+  int getColumns() const { return storage.getRows(); }
+  int numberOfCells() const { return storage.numberOfCells(); }
+  bool isEmpty() const { return getRows() == 0; }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return getRows() == other.getRows() and getColumns() == other.getColumns();
+  }
+  Layout getLayout() const { return Layout::ColumnMajor; }
+  unsigned long long getSerial() const { return storage.getSerial(); }
+  unsigned long getVersion() const { return storage.getVersion(); }
+  
+  const T& operator()(int row, int column) const { 
+    return storage(column, row); 
+  }
+  T& operator()(int row, int column) { return storage(column, row); }
+  const std::vector<T>& column(int index) const { return storage[index]; }
+  
+  /*
+  	The same matrix as a lazy transpose of its storage, for the functions
+  	taking one, and its transpose, which is the storage itself.
+  */
+  TransposedMatrix<T> view() const { return storage.transposedView(); }
+  const Matrix<T>& transpose() const & { return storage; }
+  Matrix<T> transpose() && { return std::move(storage); }
+  Matrix<T> toMatrix() const { return Matrix<T>(view()); }
+  // It writes the cells in column order, as the constructor reads them
+  void copyTo(T* data) const;
+  
+  bool insertRow(int row, const T& value = T()) {
+    return storage.insertColumn(row, value);
+  }
+  bool insertColumn(int column, const T& value = T()) {
+    return storage.insertRow(column, value);
+  }
+  bool deleteRow(int row) { return storage.deleteColumn(row); }
+  bool deleteColumn(int column) { return storage.deleteRow(column); }
+  template <typename Functor>
+  void applyFunctor(const Functor& functor) { storage.applyFunctor(functor); }
+  template <typename Policy, typename Functor>
+  typename std::enable_if<
+      matrix_execution::isExecutionPolicy<Policy>::value>::type 
+  applyFunctor(const Policy& policy, const Functor& functor) {
+    storage.applyFunctor(policy, functor);
+  }
+  void clear() { storage.clear(); }
+  
+  ColumnMajorMatrix operator+() const { return *this; }
+  ColumnMajorMatrix operator-() const { return fromColumns(-storage); }
+  
+  template <typename K>
+  ColumnMajorMatrix& operator*=(const K& other) {
+    storage *= other;
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator/=(const K& other) {
+    storage /= other;
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator+=(const K& other) {
+    storage += other;
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator-=(const K& other) {
+    storage -= other;
+    return *this;
+  }
+  /*
+  	The same with matrices: another column major matrix combines storage
+  	with storage, a row-major one is read as its transpose.
+  */
+  template <typename K>
+  ColumnMajorMatrix& operator*=(const ColumnMajorMatrix<K>& other) {
+    storage *= other.transpose();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator/=(const ColumnMajorMatrix<K>& other) {
+    storage /= other.transpose();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator+=(const ColumnMajorMatrix<K>& other) {
+    storage += other.transpose();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator-=(const ColumnMajorMatrix<K>& other) {
+    storage -= other.transpose();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator*=(const Matrix<K>& other) {
+    storage *= other.transposedView();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator/=(const Matrix<K>& other) {
+    storage /= other.transposedView();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator+=(const Matrix<K>& other) {
+    storage += other.transposedView();
+    return *this;
+  }
+  template <typename K>
+  ColumnMajorMatrix& operator-=(const Matrix<K>& other) {
+    storage -= other.transposedView();
+    return *this;
+  }
+ private:
+  // Column j of the matrix is row j of storage
+  Matrix<T> storage;
+};
+
+template <typename T>
+ColumnMajorMatrix<T>::ColumnMajorMatrix(int rows, int columns, 
+    const T* data) : storage (columns, rows) {
+  for (int j = 0; j < columns; j++) {
+    const T* column = data + static_cast<size_t>(j) * rows;
+    std::copy(column, column + rows, &storage(j, 0));
+  }
+}
+
+template <typename T>
+void ColumnMajorMatrix<T>::copyTo(T* data) const {
+  const int rows = getRows();
+  for (int j = 0; j < getColumns(); j++) {
+    std::copy(storage[j].begin(), storage[j].end(), 
+              data + static_cast<size_t>(j) * rows);
+  }
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& outputStream, 
+    const ColumnMajorMatrix<T>& matrix) {
+  return outputStream << matrix.view();
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const ColumnMajorMatrix<T>& matrix1, 
+    const ColumnMajorMatrix<K>& matrix2) 
+    -> ColumnMajorMatrix<decltype(T() * K())> {
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  return ColumnMajorMatrix<decltype(T() * K())>::fromColumns(
+      multiplyMatrices(matrix2.transpose(), matrix1.transpose()));
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix1, 
+    const ColumnMajorMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyMatrices(matrix1, matrix2.view());
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const ColumnMajorMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyMatrices(matrix1.view(), matrix2);
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const ColumnMajorMatrix<T>& matrix1, 
+    const ColumnMajorMatrix<K>& matrix2, const Functor& functor) 
+    -> ColumnMajorMatrix<decltype(functor(T(), K()))> {
+  return ColumnMajorMatrix<decltype(functor(T(), K()))>::fromColumns(
+      applyFunctorToMatrices(matrix1.transpose(), matrix2.transpose(), 
+                             functor));
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const ColumnMajorMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  return applyFunctorToMatrices(matrix1.view(), matrix2, functor);
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const Matrix<T>& matrix1, 
+    const ColumnMajorMatrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  return applyFunctorToMatrices(matrix1, matrix2.view(), functor);
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const ColumnMajorMatrix<T>& matrix, 
+    const K& value, const Functor& functor) 
+    -> ColumnMajorMatrix<decltype(functor(T(), K()))> {
+  return ColumnMajorMatrix<decltype(functor(T(), K()))>::fromColumns(
+      applyFunctorToMatrixAndScalar(matrix.transpose(), value, functor));
+}
+
+#define COLUMN_MAJOR_MATRIX_OPERATOR(OP)                                    \
+template <typename T, typename K>                                           \
+inline auto operator OP(const ColumnMajorMatrix<T>& matrix1,                \
+    const ColumnMajorMatrix<K>& matrix2)                                    \
+    -> ColumnMajorMatrix<decltype(T() OP K())> {                            \
+  return ColumnMajorMatrix<decltype(T() OP K())>::fromColumns(              \
+      matrix1.transpose() OP matrix2.transpose());                          \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const ColumnMajorMatrix<T>& matrix1,                \
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {             \
+  return matrix1.view() OP matrix2;                                         \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const Matrix<T>& matrix1,                           \
+    const ColumnMajorMatrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {  \
+  return matrix1 OP matrix2.view();                                         \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const ColumnMajorMatrix<T>& matrix, const K& value) \
+    -> ColumnMajorMatrix<decltype(T() OP K())> {                            \
+  return ColumnMajorMatrix<decltype(T() OP K())>::fromColumns(              \
+      matrix.transpose() OP value);                                         \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const K& value, const ColumnMajorMatrix<T>& matrix) \
+    -> ColumnMajorMatrix<decltype(K() OP T())> {                            \
+  return ColumnMajorMatrix<decltype(K() OP T())>::fromColumns(              \
+      value OP matrix.transpose());                                         \
+}
+
+COLUMN_MAJOR_MATRIX_OPERATOR(*)
+COLUMN_MAJOR_MATRIX_OPERATOR(/)
+COLUMN_MAJOR_MATRIX_OPERATOR(+)
+COLUMN_MAJOR_MATRIX_OPERATOR(-)
+
+#undef COLUMN_MAJOR_MATRIX_OPERATOR
+
+#endif // COLUMN_MAJOR_MATRICES_H
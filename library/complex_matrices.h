@@ -0,0 +1,155 @@
+/*
+  @file complex_matrices.h Matrix multiplication kernels for complex matrices
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef COMPLEX_MATRICES_H
+#define COMPLEX_MATRICES_H
+
+#include <complex>
+
+/*
+	Complex products are computed over split real and imaginary planes,
+	so the work is done by the real kernel of multiplyMatrices instead of
+	std::complex's operator*, which the compiler is not able to vectorize.
+	
+	Standard: 4 real products.
+	  re = Ar * Br - Ai * Bi
+	  im = Ar * Bi + Ai * Br
+	ThreeM: 3 real products, at the price of some extra additions
+	and a little less accuracy in the imaginary part.
+	  t1 = Ar * Br, t2 = Ai * Bi, t3 = (Ar + Ai) * (Br + Bi)
+	  re = t1 - t2
+	  im = t3 - t1 - t2
+*/
+
+enum class ComplexMultiplication { Standard, ThreeM };
+
+/**
+ * Below this number of cells in the result splitting the operands
+ * costs more than it saves, so the plain complex kernel is used.
+ */
+const int COMPLEX_SPLIT_THRESHOLD = 16 * 16;
+
+template <typename T>
+void splitComplexMatrix(const Matrix<std::complex<T>>& matrix,
+    Matrix<T>& realPart, Matrix<T>& imaginaryPart) {
+  const int rows = matrix.getRows();
+  const int columns = matrix.getColumns();
+  realPart = Matrix<T>(rows, columns);
+  imaginaryPart = Matrix<T>(rows, columns);
+  if (columns == 0) return;
+  for (int i = 0; i < rows; i++) {
+    const std::complex<T>* row = matrix[i].data();
+    T* realRow = &realPart(i, 0);
+    T* imaginaryRow = &imaginaryPart(i, 0);
+    for (int j = 0; j < columns; j++) {
+      realRow[j] = row[j].real();
+      imaginaryRow[j] = row[j].imag();
+    }
+  }
+}
+
+template <typename T>
+Matrix<std::complex<T>> joinComplexMatrix(const Matrix<T>& realPart, 
+    const Matrix<T>& imaginaryPart) {
+  const int rows = realPart.getRows();
+  const int columns = realPart.getColumns();
+  Matrix<std::complex<T>> resultingMatrix(rows, columns);
+  if (columns == 0) return resultingMatrix;
+  for (int i = 0; i < rows; i++) {
+    const T* realRow = realPart[i].data();
+    const T* imaginaryRow = imaginaryPart[i].data();
+    std::complex<T>* resultingRow = &resultingMatrix(i, 0);
+    for (int j = 0; j < columns; j++) {
+      resultingRow[j] = std::complex<T>(realRow[j], imaginaryRow[j]);
+    }
+  }
+  return resultingMatrix;
+}
+
+template <typename T>
+Matrix<std::complex<T>> multiplyComplexMatrices(
+    const Matrix<std::complex<T>>& matrix1, 
+    const Matrix<std::complex<T>>& matrix2,
+    ComplexMultiplication method = ComplexMultiplication::Standard) {
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  const int rows = matrix1.getRows();
+  const int columns = matrix2.getColumns();
+  if (rows * columns < COMPLEX_SPLIT_THRESHOLD) {
+    Matrix<std::complex<T>> resultingMatrix(rows, columns);
+    accumulateProduct(matrix1, matrix2, resultingMatrix);
+    return resultingMatrix;
+  }
+  Matrix<T> real1, imaginary1, real2, imaginary2;
+  splitComplexMatrix(matrix1, real1, imaginary1);
+  splitComplexMatrix(matrix2, real2, imaginary2);
+  if (method == ComplexMultiplication::ThreeM) {
+    Matrix<T> t3 = multiplyMatrices(real1 + imaginary1, real2 + imaginary2);
+    Matrix<T> t1 = multiplyMatrices(real1, real2);
+    Matrix<T> t2 = multiplyMatrices(imaginary1, imaginary2);
+    t3 -= t1;
+    t3 -= t2;
+    t1 -= t2;
+    return joinComplexMatrix(t1, t3);
+  }
+  Matrix<T> realPart = multiplyMatrices(real1, real2);
+  Matrix<T> imaginaryPart = multiplyMatrices(real1, imaginary2);
+  realPart -= multiplyMatrices(imaginary1, imaginary2);
+  accumulateProduct(imaginary1, real2, imaginaryPart);
+  return joinComplexMatrix(realPart, imaginaryPart);
+}
+
+template <typename T>
+Matrix<std::complex<T>> multiplyMatrices(
+    const Matrix<std::complex<T>>& matrix1, 
+    const Matrix<std::complex<T>>& matrix2) {
+  return multiplyComplexMatrices(matrix1, matrix2);
+}
+
+/**
+ * Mixed complex and real products only need two real products.
+ */
+template <typename T>
+Matrix<std::complex<T>> multiplyMatrices(
+    const Matrix<std::complex<T>>& matrix1, const Matrix<T>& matrix2) {
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  Matrix<T> real1, imaginary1;
+  splitComplexMatrix(matrix1, real1, imaginary1);
+  return joinComplexMatrix(multiplyMatrices(real1, matrix2), 
+                           multiplyMatrices(imaginary1, matrix2));
+}
+
+template <typename T>
+Matrix<std::complex<T>> multiplyMatrices(
+    const Matrix<T>& matrix1, const Matrix<std::complex<T>>& matrix2) {
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  Matrix<T> real2, imaginary2;
+  splitComplexMatrix(matrix2, real2, imaginary2);
+  return joinComplexMatrix(multiplyMatrices(matrix1, real2), 
+                           multiplyMatrices(matrix1, imaginary2));
+}
+
+#endif // COMPLEX_MATRICES_H
@@ -0,0 +1,723 @@
+/*
+  @file decompositions.h Eigenvalue and singular value decompositions
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef DECOMPOSITIONS_H
+#define DECOMPOSITIONS_H
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <functional>
+#include <atomic>
+
+/*
+	Spectral decompositions of real matrices.
+	
+	symmetricEigendecomposition(A, count) gives A = V diag(values) V^T 
+	for a symmetric A, of which only the lower triangle is read:
+	  1. Householder tridiagonalization, Q^T A Q = T, by panels of 
+	     HOUSEHOLDER_PANEL columns. The reflectors of a panel are applied
+	     to the rest of the matrix at once, as a rank 2 * panel update 
+	     through the row product kernel of multiplyMatrices, instead of
+	     one rank 2 update per column.
+	  2. The eigenvalues of T by the implicit QL iteration.
+	  3. The eigenvectors of T, all of them by QL too, rotating rows of a
+	     matrix that holds one vector per row, or only the `count` largest
+	     ones by inverse iteration, O(n) each, reorthogonalized inside 
+	     clusters of close eigenvalues.
+	  4. The back transformation by Q, the reflectors taken in blocks so
+	     that each block stays in cache while it goes through the rows.
+	The trailing updates, the products by the trailing matrix and the 
+	back transformation run in the thread pool (see parallel.h).
+	
+	singularValueDecomposition(A, count) gives A = U diag(values) V^T by 
+	the one-sided Jacobi method: pairs of columns are rotated until all of
+	them are orthogonal, then the values are their norms. The columns are 
+	kept as contiguous rows and the pairs of each round of a round-robin 
+	ordering are disjoint, so a round runs in parallel. It is accurate 
+	for singular values down to epsilon times the largest one, but for a
+	covariance matrix the eigendecomposition is much cheaper.
+	
+	The values are sorted in decreasing order, the vectors are columns, and 
+	a count below zero asks for all of them. As in the rest of the library
+	a failure (a non square matrix for the eigendecomposition, no 
+	convergence) gives empty results.
+*/
+
+const int HOUSEHOLDER_PANEL = 32;
+const int QL_MAX_ITERATIONS = 60;
+const int JACOBI_MAX_SWEEPS = 40;
+
+template <typename T>
+struct Eigensystem {
+  std::vector<T> values;
+  Matrix<T> vectors;
+};
+
+template <typename T>
+struct SingularSystem {
+  Matrix<T> u;
+  std::vector<T> values;
+  Matrix<T> v;
+};
+
+/**
+ * It turns x into beta e1 with H = I - tau v v^T, v[0] = 1, and returns 
+ * tau. v overwrites x, x[0] is set to 1.
+ */
+template <typename T>
+T householderReflector(T* x, int size, T& beta) {
+  T norm = T();
+  for (int i = 1; i < size; i++) {
+    norm += x[i] * x[i];
+  }
+  const T alpha = x[0];
+  if (norm == T()) {
+    beta = alpha;
+    x[0] = T(1);
+    return T();
+  }
+  norm = std::sqrt(alpha * alpha + norm);
+  beta = alpha > T() ? -norm : norm;
+  const T scale = T(1) / (alpha - beta);
+  for (int i = 1; i < size; i++) {
+    x[i] *= scale;
+  }
+  x[0] = T(1);
+  return (beta - alpha) / beta;
+}
+
+template <typename T>
+T dotProduct(const T* x, const T* y, int size) {
+  T sum = T();
+  for (int i = 0; i < size; i++) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+/**
+ * It reduces the symmetric work matrix to the tridiagonal matrix with 
+ * diagonal d and subdiagonal e, e[i] joins i and i + 1. The reflector 
+ * of column i is left in the row i from the column i + 1 on, with its 
+ * tau in taus[i].
+ * For a panel of columns, vectorsT and updatesT hold as rows the 
+ * reflectors v and the vectors w = tau (A v - tau / 2 (w^T v) v) of its
+ * columns, so that the trailing matrix is A - V W^T - W V^T. A column is
+ * brought up to date from them when the panel reaches it, and the rest 
+ * of the matrix only after the whole panel.
+ */
+template <typename T>
+void tridiagonalize(Matrix<T>& work, std::vector<T>& d, std::vector<T>& e, 
+                    std::vector<T>& taus) {
+  const int rank = work.getRows();
+  d.assign(rank, T());
+  e.assign(rank, T());
+  taus.assign(rank, T());
+  if (rank == 0) return;
+  const int panel = std::min(HOUSEHOLDER_PANEL, std::max(1, rank - 1));
+  Matrix<T> vectorsT(panel, rank);
+  Matrix<T> updatesT(panel, rank);
+  // Written through their rows, which marks each matrix modified once
+  const std::vector<T*> workRows = rowPointers(work);
+  const std::vector<T*> vectorRows = rowPointers(vectorsT);
+  const std::vector<T*> updateRows = rowPointers(updatesT);
+  std::vector<T> products(2 * panel);
+  for (int k = 0; k < rank - 1; k += panel) {
+    const int width = std::min(panel, rank - 1 - k);
+    for (int j = 0; j < width; j++) {
+      const int column = k + j;
+      const int trailing = rank - column - 1;
+      T* row = workRows[column];
+      for (int p = 0; p < j; p++) {
+        const T* v = vectorRows[p];
+        const T* w = updateRows[p];
+        const T vc = v[column], wc = w[column];
+        for (int r = column; r < rank; r++) {
+          row[r] -= v[r] * wc + w[r] * vc;
+        }
+      }
+      d[column] = row[column];
+      T* v = vectorRows[j];
+      T* w = updateRows[j];
+      std::fill(v, v + rank, T());
+      std::fill(w, w + rank, T());
+      const T tau = householderReflector(row + column + 1, trailing, 
+                                         e[column]);
+      taus[column] = tau;
+      std::copy(row + column + 1, row + rank, v + column + 1);
+      if (tau == T()) continue;
+      // w = A v over the trailing rows, minus the pending updates
+      parallelFor(column + 1, rank, rowsPerChunk(trailing), 
+        [&](int first, int last) {
+          for (int r = first; r < last; r++) {
+            w[r] = dotProduct(workRows[r] + column + 1, v + column + 1, 
+                              trailing);
+          }
+        });
+      for (int p = 0; p < j; p++) {
+        products[2 * p] = dotProduct(updateRows[p] + column + 1, 
+                                     v + column + 1, trailing);
+        products[2 * p + 1] = dotProduct(vectorRows[p] + column + 1, 
+                                         v + column + 1, trailing);
+      }
+      for (int p = 0; p < j; p++) {
+        const T* vp = vectorRows[p];
+        const T* wp = updateRows[p];
+        for (int r = column + 1; r < rank; r++) {
+          w[r] -= vp[r] * products[2 * p] + wp[r] * products[2 * p + 1];
+        }
+      }
+      T alpha = T();
+      for (int r = column + 1; r < rank; r++) {
+        w[r] *= tau;
+        alpha += w[r] * v[r];
+      }
+      alpha *= -tau / 2;
+      for (int r = column + 1; r < rank; r++) {
+        w[r] += alpha * v[r];
+      }
+    }
+    // A -= V W^T + W V^T over the trailing rows and columns
+    const int begin = k + width;
+    parallelFor(begin, rank, rowsPerChunk(2 * width * (rank - begin)), 
+      [&](int first, int last) {
+        std::vector<T> coefficients(width);
+        for (int r = first; r < last; r++) {
+          T* row = workRows[r];
+          for (int p = 0; p < width; p++) {
+            coefficients[p] = -vectorRows[p][r];
+          }
+          accumulateRowProduct(coefficients.data(), updatesT, 0, width, 
+                               begin, rank, row);
+          for (int p = 0; p < width; p++) {
+            coefficients[p] = -updateRows[p][r];
+          }
+          accumulateRowProduct(coefficients.data(), vectorsT, 0, width, 
+                               begin, rank, row);
+        }
+      });
+  }
+  d[rank - 1] = workRows[rank - 1][rank - 1];
+  e[rank - 1] = T();
+}
+
+/**
+ * Implicit QL iteration with Wilkinson shifts on the tridiagonal matrix,
+ * d ends up holding its eigenvalues. When vectorsT is not null its rows 
+ * are rotated along, so starting from the identity its row i ends up 
+ * being the eigenvector of d[i]. It returns false if some eigenvalue 
+ * does not converge.
+ * The matrix splits where e[m] is negligible next to its neighbours on 
+ * the diagonal, or next to the norm of the whole matrix, since around 
+ * eigenvalues near zero the diagonal may be as small as the rounding 
+ * errors and the relative test alone would never hold.
+ */
+template <typename T>
+bool tridiagonalQL(std::vector<T>& d, std::vector<T>& e, 
+                   Matrix<T>* vectorsT) {
+  const int rank = d.size();
+  const T epsilon = std::numeric_limits<T>::epsilon();
+  const int columns = vectorsT ? vectorsT->getColumns() : 0;
+  const std::vector<T*> rows = vectorsT ? rowPointers(*vectorsT) 
+                                        : std::vector<T*>();
+  T norm = T();
+  for (int i = 0; i < rank; i++) {
+    norm = std::max(norm, std::abs(d[i]) + std::abs(e[i]) + 
+                          (i > 0 ? std::abs(e[i - 1]) : T()));
+  }
+  const T negligible = epsilon * norm;
+  for (int l = 0; l < rank; l++) {
+    int iterations = 0;
+    int m;
+    do {
+      for (m = l; m < rank - 1; m++) {
+        const T size = std::abs(d[m]) + std::abs(d[m + 1]);
+        if (std::abs(e[m]) <= epsilon * size or 
+            std::abs(e[m]) <= negligible) {
+          break;
+        }
+      }
+      if (m == l) break;
+      if (iterations++ == QL_MAX_ITERATIONS) return false;
+      T g = (d[l + 1] - d[l]) / (2 * e[l]);
+      T r = std::hypot(g, T(1));
+      g = d[m] - d[l] + e[l] / (g + (g >= T() ? r : -r));
+      T s = T(1), c = T(1), p = T();
+      int i;
+      for (i = m - 1; i >= l; i--) {
+        T f = s * e[i];
+        const T b = c * e[i];
+        r = std::hypot(f, g);
+        e[i + 1] = r;
+        if (r == T()) {
+          d[i + 1] -= p;
+          e[m] = T();
+          break;
+        }
+        s = f / r;
+        c = g / r;
+        g = d[i + 1] - p;
+        r = (d[i] - g) * s + 2 * c * b;
+        p = s * r;
+        d[i + 1] = g + p;
+        g = c * r - b;
+        if (vectorsT) {
+          T* rowI = rows[i];
+          T* rowNext = rows[i + 1];
+          for (int k = 0; k < columns; k++) {
+            f = rowNext[k];
+            rowNext[k] = s * rowI[k] + c * f;
+            rowI[k] = c * rowI[k] - s * f;
+          }
+        }
+      }
+      if (r == T() and i >= l) continue;
+      d[l] -= p;
+      e[l] = g;
+      e[m] = T();
+    } while (m != l);
+  }
+  return true;
+}
+
+/**
+ * Eigenvector of the tridiagonal matrix for its eigenvalue lambda, by 
+ * inverse iteration: (T - lambda I) x = b solved by Gaussian elimination
+ * with partial pivoting, which keeps two superdiagonals, and tiny pivots
+ * replaced by epsilon times the norm. Before every solve x is made
+ * orthogonal to the vectors in cluster.
+ */
+template <typename T>
+void tridiagonalInverseIteration(const std::vector<T>& d, 
+    const std::vector<T>& e, T lambda, T norm, 
+    const std::vector<const T*>& cluster, int seed, T* x) {
+  const int rank = d.size();
+  const T tiny = std::numeric_limits<T>::epsilon() * (norm > T() ? norm : T(1));
+  std::vector<T> u0(rank), u1(rank), u2(rank), multipliers(rank);
+  std::vector<char> swapped(rank, false);
+  T diagonal = d[0] - lambda;
+  T super = rank > 1 ? e[0] : T();
+  for (int i = 0; i < rank - 1; i++) {
+    const T sub = e[i];
+    const T nextDiagonal = d[i + 1] - lambda;
+    const T nextSuper = i + 1 < rank - 1 ? e[i + 1] : T();
+    if (std::abs(diagonal) >= std::abs(sub)) {
+      if (diagonal == T()) diagonal = tiny;
+      multipliers[i] = sub / diagonal;
+      u0[i] = diagonal;
+      u1[i] = super;
+      u2[i] = T();
+      diagonal = nextDiagonal - multipliers[i] * super;
+      super = nextSuper;
+    } else {
+      swapped[i] = true;
+      multipliers[i] = diagonal / sub;
+      u0[i] = sub;
+      u1[i] = nextDiagonal;
+      u2[i] = nextSuper;
+      diagonal = super - multipliers[i] * nextDiagonal;
+      super = -multipliers[i] * nextSuper;
+    }
+  }
+  u0[rank - 1] = std::abs(diagonal) < tiny ? tiny : diagonal;
+  for (int i = 0; i < rank - 1; i++) {
+    if (std::abs(u0[i]) < tiny) u0[i] = u0[i] < T() ? -tiny : tiny;
+  }
+  // A deterministic start with no structure
+  unsigned state = 2463534242u + 7919u * seed;
+  for (int i = 0; i < rank; i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    x[i] = T(state % 2001) / 1000 - T(1);
+  }
+  for (int iteration = 0; iteration < 4; iteration++) {
+    for (const T* other : cluster) {
+      const T projection = dotProduct(other, x, rank);
+      for (int i = 0; i < rank; i++) {
+        x[i] -= projection * other[i];
+      }
+    }
+    for (int i = 0; i < rank - 1; i++) {
+      if (swapped[i]) std::swap(x[i], x[i + 1]);
+      x[i + 1] -= multipliers[i] * x[i];
+    }
+    for (int i = rank - 1; i >= 0; i--) {
+      T value = x[i];
+      if (i + 1 < rank) value -= u1[i] * x[i + 1];
+      if (i + 2 < rank) value -= u2[i] * x[i + 2];
+      x[i] = value / u0[i];
+    }
+    T length = std::sqrt(dotProduct(x, x, rank));
+    if (not (length > T())) length = T(1);
+    for (int i = 0; i < rank; i++) {
+      x[i] /= length;
+    }
+  }
+  for (const T* other : cluster) {
+    const T projection = dotProduct(other, x, rank);
+    for (int i = 0; i < rank; i++) {
+      x[i] -= projection * other[i];
+    }
+  }
+  const T length = std::sqrt(dotProduct(x, x, rank));
+  if (length > T()) {
+    for (int i = 0; i < rank; i++) {
+      x[i] /= length;
+    }
+  }
+}
+
+/**
+ * Every row z of vectorsT becomes z H_(n-2) ... H_0, that is the rows 
+ * become the eigenvectors of the original matrix. The reflectors are 
+ * taken HOUSEHOLDER_PANEL at a time, from the last one, and every chunk
+ * of rows goes through a whole block before the next block.
+ */
+template <typename T>
+void applyReflectorsToRows(const Matrix<T>& reflectors, 
+    const std::vector<T>& taus, Matrix<T>& vectorsT) {
+  const int rank = reflectors.getRows();
+  const int rows = vectorsT.getRows();
+  for (int blockEnd = rank - 1; blockEnd > 0; blockEnd -= HOUSEHOLDER_PANEL) {
+    const int blockBegin = std::max(0, blockEnd - HOUSEHOLDER_PANEL);
+    parallelFor(0, rows, rowsPerChunk(HOUSEHOLDER_PANEL * rank), 
+      [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+          T* z = &vectorsT(i, 0);
+          for (int column = blockEnd - 1; column >= blockBegin; column--) {
+            const T tau = taus[column];
+            if (tau == T()) continue;
+            const T* v = reflectors[column].data() + column + 1;
+            T* zTail = z + column + 1;
+            const int size = rank - column - 1;
+            const T projection = tau * dotProduct(zTail, v, size);
+            for (int r = 0; r < size; r++) {
+              zTail[r] -= projection * v[r];
+            }
+          }
+        }
+      });
+  }
+}
+
+/**
+ * The indices of values in decreasing order of value.
+ */
+template <typename T>
+std::vector<int> decreasingOrder(const std::vector<T>& values) {
+  std::vector<int> order(values.size());
+  for (int i = 0; i < static_cast<int>(order.size()); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), 
+            [&values](int a, int b) { return values[a] > values[b]; });
+  return order;
+}
+
+/**
+ * It copies the lower triangle of matrix into work, mirrored, and 
+ * tridiagonalizes it.
+ */
+template <typename T>
+bool tridiagonalizeSymmetric(const Matrix<T>& matrix, Matrix<T>& work, 
+    std::vector<T>& values, std::vector<T>& e, std::vector<T>& taus) {
+  static_assert(std::is_floating_point<T>::value, 
+                "The decompositions need floating point cells");
+  if (matrix.getRows() != matrix.getColumns() or matrix.isEmpty()) {
+    return false;
+  }
+  work = matrix;
+  mirrorLowerTriangle(work);
+  tridiagonalize(work, values, e, taus);
+  return true;
+}
+
+/**
+ * The eigenvalues of a symmetric matrix in decreasing order, O(4/3 n^3) 
+ * for the tridiagonalization and O(n^2) afterwards.
+ */
+template <typename T>
+std::vector<T> symmetricEigenvalues(const Matrix<T>& matrix) {
+  INSTRUMENT_OPERATION("symmetricEigenvalues", matrix.numberOfCells(), 
+      4LL * matrix.numberOfCells() * matrix.getRows() / 3, 
+      sizeof(T) * matrix.numberOfCells() * matrix.getRows() / 2);
+  Matrix<T> work;
+  std::vector<T> values, e, taus;
+  if (not tridiagonalizeSymmetric(matrix, work, values, e, taus) or 
+      not tridiagonalQL(values, e, static_cast<Matrix<T>*>(nullptr))) {
+    return {};
+  }
+  std::sort(values.begin(), values.end(), std::greater<T>());
+  return values;
+}
+
+/**
+ * The count largest eigenvalues of a symmetric matrix and their 
+ * eigenvectors, all of them if count is negative. With few vectors they 
+ * come from inverse iteration on the tridiagonal matrix, which costs 
+ * O(n) each instead of the O(n^2) per vector of the QL rotations, and 
+ * the back transformation only runs over them.
+ */
+template <typename T>
+Eigensystem<T> symmetricEigendecomposition(const Matrix<T>& matrix, 
+                                           int count = -1) {
+  INSTRUMENT_OPERATION("symmetricEigendecomposition", matrix.numberOfCells(), 
+      4LL * matrix.numberOfCells() * matrix.getRows() / 3 
+      + 2LL * matrix.numberOfCells() * (count < 0 ? matrix.getRows() : count), 
+      sizeof(T) * matrix.numberOfCells() * matrix.getRows() / 2);
+  Eigensystem<T> eigensystem;
+  Matrix<T> work;
+  std::vector<T> d, e, taus;
+  if (not tridiagonalizeSymmetric(matrix, work, d, e, taus)) {
+    return eigensystem;
+  }
+  const int rank = d.size();
+  if (count < 0 or count > rank) count = rank;
+  Matrix<T> vectorsT;
+  std::vector<T> values(count);
+  if (2 * count > rank) {
+    Matrix<T> rotated = Matrix<T>::identity(rank, T(1));
+    if (not tridiagonalQL(d, e, &rotated)) return eigensystem;
+    const std::vector<int> order = decreasingOrder(d);
+    vectorsT = Matrix<T>(count, rank);
+    for (int i = 0; i < count; i++) {
+      values[i] = d[order[i]];
+      const T* row = &rotated(order[i], 0);
+      std::copy(row, row + rank, &vectorsT(i, 0));
+    }
+  } else {
+    std::vector<T> diagonal = d, subdiagonal = e;
+    if (not tridiagonalQL(diagonal, subdiagonal, 
+                          static_cast<Matrix<T>*>(nullptr))) {
+      return eigensystem;
+    }
+    std::sort(diagonal.begin(), diagonal.end(), std::greater<T>());
+    T norm = T();
+    for (int i = 0; i < rank; i++) {
+      norm = std::max(norm, std::abs(d[i]) + std::abs(e[i]) + 
+                            (i > 0 ? std::abs(e[i - 1]) : T()));
+    }
+    vectorsT = Matrix<T>(count, rank);
+    std::vector<const T*> cluster;
+    for (int i = 0; i < count; i++) {
+      values[i] = diagonal[i];
+      if (i == 0 or diagonal[i - 1] - diagonal[i] > T(1e-3) * norm) {
+        cluster.clear();
+      }
+      tridiagonalInverseIteration(d, e, diagonal[i], norm, cluster, i, 
+                                  &vectorsT(i, 0));
+      cluster.push_back(&vectorsT(i, 0));
+    }
+  }
+  applyReflectorsToRows(work, taus, vectorsT);
+  eigensystem.values = std::move(values);
+  eigensystem.vectors = Matrix<T>(TransposedMatrix<T>(vectorsT));
+  return eigensystem;
+}
+
+template <typename T>
+std::vector<T> symmetricEigenvalues(const SymmetricMatrix<T>& symmetric) {
+  return symmetricEigenvalues(symmetric.toMatrix());
+}
+
+template <typename T>
+Eigensystem<T> symmetricEigendecomposition(
+    const SymmetricMatrix<T>& symmetric, int count = -1) {
+  return symmetricEigendecomposition(symmetric.toMatrix(), count);
+}
+
+/**
+ * One-sided Jacobi on the rows of columnsT, the columns of the matrix. 
+ * Each sweep pairs every row with every other one once, in rounds of 
+ * disjoint pairs (the round-robin of a tournament), and rotates the pair 
+ * so that both rows become orthogonal; rotatedT, when not null, takes 
+ * the same rotations. The squared norms of the rows are computed at the
+ * start of a sweep and then updated by the rotations, which leaves one
+ * dot product per pair. It returns false if the rows are still not 
+ * orthogonal after JACOBI_MAX_SWEEPS sweeps.
+ * Two rows count as orthogonal once their cosine is below sqrt(length)
+ * epsilon, the rounding error of their dot product, and a row whose norm
+ * is below epsilon times the largest one is already zero, so it is not
+ * rotated any more.
+ */
+template <typename T>
+bool jacobiOrthogonalize(Matrix<T>& columnsT, Matrix<T>* rotatedT) {
+  const int count = columnsT.getRows();
+  const int length = columnsT.getColumns();
+  const T epsilon = std::numeric_limits<T>::epsilon();
+  const T tolerance = std::sqrt(T(std::max(1, length))) * epsilon;
+  const int players = count + count % 2;
+  std::vector<int> seats(players);
+  std::vector<T> norms(count);
+  const int pairs = players / 2;
+  for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+    for (int i = 0; i < players; i++) {
+      seats[i] = i;
+    }
+    T largest = T();
+    for (int i = 0; i < count; i++) {
+      norms[i] = dotProduct(&columnsT(i, 0), &columnsT(i, 0), length);
+      largest = std::max(largest, norms[i]);
+    }
+    // The norms are squared
+    const T negligible = epsilon * epsilon * largest;
+    std::atomic<int> rotations(0);
+    for (int round = 0; round < players - 1; round++) {
+      parallelFor(0, pairs, rowsPerChunk(3 * length), 
+        [&](int first, int last) {
+          int rotated = 0;
+          for (int pair = first; pair < last; pair++) {
+            int p = seats[pair];
+            int q = seats[players - 1 - pair];
+            if (p >= count or q >= count) continue;
+            if (p > q) std::swap(p, q);
+            T* x = &columnsT(p, 0);
+            T* y = &columnsT(q, 0);
+            const T alpha = norms[p];
+            const T beta = norms[q];
+            const T gamma = dotProduct(x, y, length);
+            if (std::min(alpha, beta) <= negligible or 
+                std::abs(gamma) <= tolerance * std::sqrt(alpha * beta) or 
+                gamma == T()) {
+              continue;
+            }
+            rotated++;
+            const T zeta = (beta - alpha) / (2 * gamma);
+            const T t = (zeta >= T() ? T(1) : T(-1)) / 
+                        (std::abs(zeta) + std::hypot(T(1), zeta));
+            const T c = T(1) / std::sqrt(1 + t * t);
+            const T s = c * t;
+            norms[p] = alpha - t * gamma;
+            norms[q] = beta + t * gamma;
+            for (int k = 0; k < length; k++) {
+              const T xk = x[k];
+              x[k] = c * xk - s * y[k];
+              y[k] = s * xk + c * y[k];
+            }
+            if (rotatedT) {
+              T* u = &(*rotatedT)(p, 0);
+              T* w = &(*rotatedT)(q, 0);
+              const int size = rotatedT->getColumns();
+              for (int k = 0; k < size; k++) {
+                const T uk = u[k];
+                u[k] = c * uk - s * w[k];
+                w[k] = s * uk + c * w[k];
+              }
+            }
+          }
+          rotations += rotated;
+        });
+      std::rotate(seats.begin() + 1, seats.end() - 1, seats.end());
+    }
+    if (rotations == 0) return true;
+  }
+  return false;
+}
+
+/**
+ * The singular values in decreasing order.
+ */
+template <typename T>
+std::vector<T> singularValues(const Matrix<T>& matrix) {
+  INSTRUMENT_OPERATION("singularValues", matrix.numberOfCells(), 0, 
+                       2 * sizeof(T) * matrix.numberOfCells());
+  static_assert(std::is_floating_point<T>::value, 
+                "The decompositions need floating point cells");
+  const bool wide = matrix.getRows() < matrix.getColumns();
+  // The rows of columnsT are the columns of the taller one of A and A^T
+  Matrix<T> columnsT = wide ? matrix : matrix.transpose();
+  if (not jacobiOrthogonalize(columnsT, static_cast<Matrix<T>*>(nullptr))) {
+    return {};
+  }
+  std::vector<T> values(columnsT.getRows());
+  for (int i = 0; i < columnsT.getRows(); i++) {
+    values[i] = std::sqrt(dotProduct(&columnsT(i, 0), &columnsT(i, 0), 
+                                     columnsT.getColumns()));
+  }
+  std::sort(values.begin(), values.end(), std::greater<T>());
+  return values;
+}
+
+/**
+ * A = U diag(values) V^T with the count largest singular values, all of 
+ * them if count is negative, U and V with orthonormal columns. The 
+ * columns of U for singular values below epsilon times the largest one,
+ * which are zero to working precision, are left zero.
+ */
+template <typename T>
+SingularSystem<T> singularValueDecomposition(const Matrix<T>& matrix, 
+                                             int count = -1) {
+  INSTRUMENT_OPERATION("singularValueDecomposition", matrix.numberOfCells(), 0,
+                       3 * sizeof(T) * matrix.numberOfCells());
+  static_assert(std::is_floating_point<T>::value, 
+                "The decompositions need floating point cells");
+  SingularSystem<T> system;
+  if (matrix.isEmpty()) return system;
+  const bool wide = matrix.getRows() < matrix.getColumns();
+  Matrix<T> columnsT = wide ? matrix : matrix.transpose();
+  const int size = columnsT.getRows();
+  Matrix<T> rotatedT = Matrix<T>::identity(size, T(1));
+  if (not jacobiOrthogonalize(columnsT, &rotatedT)) return system;
+  if (count < 0 or count > size) count = size;
+  const int length = columnsT.getColumns();
+  std::vector<T> norms(size);
+  for (int i = 0; i < size; i++) {
+    norms[i] = std::sqrt(dotProduct(&columnsT(i, 0), &columnsT(i, 0), 
+                                    length));
+  }
+  const std::vector<int> order = decreasingOrder(norms);
+  const T negligible = std::numeric_limits<T>::epsilon() * 
+                       (size > 0 ? norms[order[0]] : T());
+  // Row i of leftT and rightT are the columns i of U and V of the taller one
+  Matrix<T> leftT(count, length), rightT(count, size);
+  system.values.resize(count);
+  for (int i = 0; i < count; i++) {
+    const int source = order[i];
+    const T norm = norms[source];
+    system.values[i] = norm;
+    const T* column = &columnsT(source, 0);
+    T* left = &leftT(i, 0);
+    if (norm > negligible) {
+      for (int k = 0; k < length; k++) {
+        left[k] = column[k] / norm;
+      }
+    }
+    const T* rotatedRow = &rotatedT(source, 0);
+    std::copy(rotatedRow, rotatedRow + size, &rightT(i, 0));
+  }
+  // For a wide A, A^T = U' S V'^T so A = V' S U'^T
+  system.u = Matrix<T>(TransposedMatrix<T>(wide ? rightT : leftT));
+  system.v = Matrix<T>(TransposedMatrix<T>(wide ? leftT : rightT));
+  return system;
+}
+
+#endif // DECOMPOSITIONS_H
@@ -0,0 +1,518 @@
+/*
+  @file elementwise_functions.h Vectorized elementwise math functions for matrices
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef ELEMENTWISE_FUNCTIONS_H
+#define ELEMENTWISE_FUNCTIONS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "parallel.h"
+
+/*
+	The following functions apply the corresponding math function to each
+	element of a matrix. The out-of-place form returns a new matrix and the 
+	"InPlace" form overwrites the given one. Large matrices are processed
+	by rows in parallel.
+	
+	For float and double matrices the functions are branch-free polynomial
+	approximations, which the compiler vectorizes, with these maximum 
+	errors measured against a long double reference:
+	  exp, log ....................... 1 ULP
+	  sigmoid, tanh .................. 3 ULP
+	  sin, cos ....................... 1.5 ULP for |x| < 1e6, larger values
+	                                   fall back to std::sin / std::cos
+	  tan ............................ 3.5 ULP in the same range
+	  sqrt ........................... correctly rounded (std::sqrt)
+	  elementwisePow ................. exp(y * log(x)), 1 ULP for float,
+	                                   computed in double precision; for
+	                                   double the rounding errors of the 
+	                                   logarithm and the product grow 
+	                                   with y, about 2 |y * log(x)| 
+	                                   + 1 ULP (19 ULP for 84.43^2.5, 
+	                                   over 1000 near overflow), so use 
+	                                   std::pow through applyFunctor when
+	                                   that matters. Non-positive and 
+	                                   infinite bases use std::pow
+	For any other element type (e.g. std::complex) the std:: functions 
+	are called for each element.
+	
+	GCC only turns the selections of these functions into vector blends 
+	with -fno-trapping-math, and sqrt needs -fno-math-errno too. The results
+	do not depend on those flags, but -ffast-math must not be used since the
+	special values are detected with comparisons against NaN and infinity.
+	
+	The matrix power will take the name pow, so the elementwise one 
+	is called elementwisePow.
+*/
+
+namespace vectorized {
+
+template <typename F>
+inline F horner(F, F coefficient) {
+  return coefficient;
+}
+
+template <typename F, typename... Coefficients>
+inline F horner(F x, F coefficient, Coefficients... rest) {
+  return coefficient + x * horner(x, F(rest)...);
+}
+
+template <typename F> struct Traits;
+
+template <> struct Traits<double> {
+  typedef std::int64_t Bits;
+  static const int MANTISSA_BITS = 52;
+  static const int BIAS = 1023;
+  static double roundingMagic() { return 6755399441055744.0; } // 1.5 * 2^52
+  static double maxExponent() { return 709.782712893384; }
+  static double minExponent() { return -745.1332191019412; }
+  // k * ln(2) is subtracted in two parts, the first one being exact
+  static double ln2High() { return 6.93147180369123816490e-01; }
+  static double ln2Low() { return 1.90821492927058770002e-10; }
+  /*
+    Taylor polynomial of expm1 over |r| <= ln(2) / 2.
+  */
+  static double expm1Polynomial(double r) {
+    return r + r * r * horner(r, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 
+        1.0 / 720, 1.0 / 5040, 1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 
+        1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800.0);
+  }
+  /*
+    2 * atanh(s) / s - 2 for |s| <= 3 - 2 * sqrt(2), as a function of s^2.
+  */
+  static double atanhPolynomial(double z) {
+    return z * horner(z, 2.0 / 3, 2.0 / 5, 2.0 / 7, 2.0 / 9, 2.0 / 11, 
+        2.0 / 13, 2.0 / 15, 2.0 / 17, 2.0 / 19, 2.0 / 21, 2.0 / 23);
+  }
+};
+
+template <> struct Traits<float> {
+  typedef std::int32_t Bits;
+  static const int MANTISSA_BITS = 23;
+  static const int BIAS = 127;
+  static float roundingMagic() { return 12582912.0f; } // 1.5 * 2^23
+  static float maxExponent() { return 88.72283935546875f; }
+  static float minExponent() { return -103.97208f; }
+  static float ln2High() { return 0.693145751953125f; }
+  static float ln2Low() { return 1.428606765330187045e-06f; }
+  static float expm1Polynomial(float r) {
+    return r + r * r * horner(r, 1.0f / 2, 1.0f / 6, 1.0f / 24, 1.0f / 120, 
+        1.0f / 720, 1.0f / 5040, 1.0f / 40320);
+  }
+  static float atanhPolynomial(float z) {
+    return z * horner(z, 2.0f / 3, 2.0f / 5, 2.0f / 7, 2.0f / 9, 2.0f / 11);
+  }
+};
+
+template <typename F>
+inline typename Traits<F>::Bits toBits(F value) {
+  typename Traits<F>::Bits bits;
+  std::memcpy(&bits, &value, sizeof(value));
+  return bits;
+}
+
+template <typename F>
+inline F fromBits(typename Traits<F>::Bits bits) {
+  F value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/**
+ * It splits x into k * ln(2) + r with |r| <= ln(2) / 2, returns r
+ * and gives 2^k as scale * scaleHalf, so that k reaches the subnormals. 
+ * x must be already clamped to the range of the exponential.
+ */
+template <typename F>
+inline F reduceExponent(F x, F& scale, F& scaleHalf) {
+  typedef Traits<F> FloatTraits;
+  typedef typename FloatTraits::Bits Bits;
+  const F magic = FloatTraits::roundingMagic();
+  const F shifted = x * F(1.4426950408889634) + magic;
+  const F k = shifted - magic;
+  // The low bits of shifted hold k, so 2^k is built straight from them
+  const Bits kBits = toBits(shifted) - toBits(magic);
+  const Bits half = kBits >> 1;
+  scaleHalf = fromBits<F>(
+      (half + FloatTraits::BIAS) << FloatTraits::MANTISSA_BITS);
+  scale = fromBits<F>(
+      (kBits - half + FloatTraits::BIAS) << FloatTraits::MANTISSA_BITS);
+  return (x - k * FloatTraits::ln2High()) - k * FloatTraits::ln2Low();
+}
+
+template <typename F>
+inline F exp(F x) {
+  typedef Traits<F> FloatTraits;
+  const F clamped = std::min(std::max(x, FloatTraits::minExponent()), 
+                             FloatTraits::maxExponent());
+  F scale, scaleHalf;
+  const F r = reduceExponent(clamped, scale, scaleHalf);
+  // Every condition is evaluated unconditionally so that the selections 
+  // below are branch-free
+  const bool overflow = x > FloatTraits::maxExponent();
+  const bool underflow = x < FloatTraits::minExponent();
+  const bool notANumber = x != x;
+  F result = (FloatTraits::expm1Polynomial(r) + F(1)) * scaleHalf * scale;
+  result = underflow ? F(0) : result;
+  result = overflow ? std::numeric_limits<F>::infinity() : result;
+  return notANumber ? x : result;
+}
+
+template <typename F>
+inline F expm1(F x) {
+  typedef Traits<F> FloatTraits;
+  const F clamped = std::min(std::max(x, F(-60)), FloatTraits::maxExponent());
+  F scale, scaleHalf;
+  const F r = reduceExponent(clamped, scale, scaleHalf);
+  const F fullScale = scale * scaleHalf;
+  const bool overflow = x > FloatTraits::maxExponent();
+  const bool notANumber = x != x;
+  F result = FloatTraits::expm1Polynomial(r) * fullScale + (fullScale - F(1));
+  result = overflow ? std::numeric_limits<F>::infinity() : result;
+  return notANumber ? x : result;
+}
+
+template <typename F>
+inline F log(F x) {
+  typedef Traits<F> FloatTraits;
+  typedef typename FloatTraits::Bits Bits;
+  const Bits one = Bits(FloatTraits::BIAS) << FloatTraits::MANTISSA_BITS;
+  const Bits mantissaMask = (Bits(1) << FloatTraits::MANTISSA_BITS) - 1;
+  // Subnormals are scaled into the normal range first
+  const bool subnormal = x < std::numeric_limits<F>::min();
+  const F scaled = subnormal ? x * F(18014398509481984.0) : x; // 2^54
+  const Bits bits = toBits(scaled);
+  F mantissa = fromBits<F>((bits & mantissaMask) | one);
+  // The exponent is taken with a logical shift and kept in 32 bits, since 
+  // SSE2 has neither 64 bit arithmetic shifts nor 64 bit conversions
+  F e = F(std::int32_t(
+      static_cast<typename std::make_unsigned<Bits>::type>(bits) >> 
+          FloatTraits::MANTISSA_BITS)) - F(FloatTraits::BIAS);
+  e -= subnormal ? F(54) : F(0);
+  // The mantissa is moved into [sqrt(2) / 2, sqrt(2)) so that |s| is minimal
+  const bool big = mantissa > F(1.4142135623730951);
+  mantissa = big ? mantissa * F(0.5) : mantissa;
+  e += big ? F(1) : F(0);
+  const F f = mantissa - F(1);
+  const F s = f / (F(2) + f);
+  const F halfSquare = F(0.5) * f * f;
+  const F tail = s * (halfSquare + FloatTraits::atanhPolynomial(s * s));
+  const F infinity = std::numeric_limits<F>::infinity();
+  const bool zero = x == F(0);
+  const bool notANumber = not (x >= F(0));
+  const bool overflow = x == infinity;
+  F result = e * FloatTraits::ln2High() + 
+      (f - (halfSquare - (tail + e * FloatTraits::ln2Low())));
+  result = zero ? -infinity : result;
+  result = overflow ? infinity : result;
+  return notANumber ? std::numeric_limits<F>::quiet_NaN() : result;
+}
+
+template <typename F>
+inline F sigmoid(F x) {
+  const bool positive = x >= F(0);
+  const F e = exp(-std::abs(x));
+  const F s = F(1) / (F(1) + e);
+  return positive ? s : e * s;
+}
+
+template <typename F>
+inline F tanh(F x) {
+  const F u = expm1(F(-2) * std::abs(x));
+  return std::copysign(-u / (F(2) + u), x);
+}
+
+const double SINE_LIMIT = 1e6;
+
+/**
+ * It reduces x into [-pi/4, pi/4] by multiples of pi/2 (three part 
+ * Cody-Waite, exact for |x| < SINE_LIMIT) and gives the sine and the 
+ * cosine of the reduced argument and the quadrant.
+ */
+inline void sineCosine(double x, double& sine, double& cosine, 
+    std::int64_t& quadrant) {
+  const double magic = Traits<double>::roundingMagic();
+  const double shifted = x * 0.63661977236758134308 + magic;
+  const double k = shifted - magic;
+  quadrant = toBits(shifted) - toBits(magic);
+  // r + tail is the reduced argument, tail holding the rounding of r
+  const double high = x - k * 1.57079632673412561417e+00;
+  const double middle = k * 6.07710050630396597660e-11;
+  const double low = k * 2.02226624879595063154e-21;
+  const double partial = high - middle;
+  const double r = partial - low;
+  const double tail = ((high - partial) - middle) + ((partial - r) - low);
+  const double z = r * r;
+  sine = r + (tail + r * z * horner(z, -1.0 / 6, 1.0 / 120, -1.0 / 5040, 
+      1.0 / 362880, -1.0 / 39916800, 1.0 / 6227020800.0, 
+      -1.0 / 1307674368000.0, 1.0 / 355687428096000.0));
+  cosine = 1.0 - 0.5 * z + (z * z * horner(z, 1.0 / 24, -1.0 / 720, 
+      1.0 / 40320, -1.0 / 3628800, 1.0 / 479001600, 
+      -1.0 / 87178291200.0, 1.0 / 20922789888000.0, 
+      -1.0 / 6402373705728000.0) - r * tail);
+}
+
+/*
+	The quadrant selects between the sine and the cosine and flips the 
+	sign with integer masks: SSE2 has no 64 bit comparisons, so a select
+	on the quadrant would stop the vectorization.
+*/
+
+inline double selectBits(std::int64_t mask, double ifSet, double ifUnset) {
+  return fromBits<double>((toBits(ifSet) & mask) | (toBits(ifUnset) & ~mask));
+}
+
+inline double flipSign(double value, std::int64_t flip) {
+  return fromBits<double>(toBits(value) ^ ((flip & 2) << 62));
+}
+
+inline double sin(double x) {
+  double sine, cosine;
+  std::int64_t quadrant;
+  sineCosine(x, sine, cosine, quadrant);
+  return flipSign(selectBits(-(quadrant & 1), cosine, sine), quadrant);
+}
+
+inline double cos(double x) {
+  double sine, cosine;
+  std::int64_t quadrant;
+  sineCosine(x, sine, cosine, quadrant);
+  return flipSign(selectBits(-(quadrant & 1), sine, cosine), quadrant + 1);
+}
+
+inline double tan(double x) {
+  double sine, cosine;
+  std::int64_t quadrant;
+  sineCosine(x, sine, cosine, quadrant);
+  const std::int64_t odd = -(quadrant & 1);
+  return -selectBits(odd, cosine, -sine) / selectBits(odd, sine, cosine);
+}
+
+/*
+	Element functors. Float and double elements go through the functions 
+	above, float sines and cosines are computed in double precision, and
+	any other type goes through the std:: function.
+*/
+
+#define ELEMENT_FUNCTION(NAME, FLOAT_EXPRESSION, DOUBLE_EXPRESSION, GENERIC)\
+struct NAME {                                                               \
+  float operator()(float x) const { return FLOAT_EXPRESSION; }              \
+  double operator()(double x) const { return DOUBLE_EXPRESSION; }           \
+  template <typename T>                                                     \
+  T operator()(const T& x) const { return GENERIC; }                        \
+};
+
+ELEMENT_FUNCTION(Exp, exp(x), exp(x), std::exp(x))
+ELEMENT_FUNCTION(Log, log(x), log(x), std::log(x))
+ELEMENT_FUNCTION(Sqrt, std::sqrt(x), std::sqrt(x), std::sqrt(x))
+ELEMENT_FUNCTION(Tanh, tanh(x), tanh(x), std::tanh(x))
+ELEMENT_FUNCTION(Sigmoid, sigmoid(x), sigmoid(x), 
+                 T(1) / (T(1) + std::exp(-x)))
+ELEMENT_FUNCTION(Sin, float(sin(double(x))), sin(x), std::sin(x))
+ELEMENT_FUNCTION(Cos, float(cos(double(x))), cos(x), std::cos(x))
+ELEMENT_FUNCTION(Tan, float(tan(double(x))), tan(x), std::tan(x))
+ELEMENT_FUNCTION(StdSin, std::sin(x), std::sin(x), std::sin(x))
+ELEMENT_FUNCTION(StdCos, std::cos(x), std::cos(x), std::cos(x))
+ELEMENT_FUNCTION(StdTan, std::tan(x), std::tan(x), std::tan(x))
+
+#undef ELEMENT_FUNCTION
+
+template <typename T>
+struct Pow {
+  T exponent;
+  float operator()(float x) const { 
+    return float(exp(double(exponent) * log(double(x)))); 
+  }
+  double operator()(double x) const { 
+    return exp(double(exponent) * log(x)); 
+  }
+  template <typename K>
+  K operator()(const K& x) const { return std::pow(x, exponent); }
+};
+
+template <typename T>
+struct StdPow {
+  T exponent;
+  template <typename K>
+  K operator()(const K& x) const { return std::pow(x, exponent); }
+};
+
+/*
+	Domains where the approximations above are valid.
+*/
+
+struct SineDomain {
+  template <typename T>
+  bool operator()(const T& x) const { return std::abs(x) < SINE_LIMIT; }
+};
+
+struct PowDomain {
+  bool operator()(float x) const { 
+    return x > 0.0f and x < std::numeric_limits<float>::infinity(); 
+  }
+  bool operator()(double x) const { 
+    return x > 0.0 and x < std::numeric_limits<double>::infinity(); 
+  }
+  template <typename T>
+  bool operator()(const T&) const { return true; }
+};
+
+/**
+ * It applies the element functor to a whole row. The loop has no 
+ * branches nor calls once the functor is inlined, so it is vectorized.
+ */
+template <typename Function>
+struct RowKernel {
+  Function function;
+  template <typename T>
+  void operator()(const T* source, T* destination, int size) const {
+    for (int i = 0; i < size; i++) {
+      destination[i] = function(source[i]);
+    }
+  }
+};
+
+/**
+ * Same as RowKernel but the row is processed by blocks, and the blocks 
+ * with any element outside of the domain of the function are computed 
+ * by the fallback instead.
+ */
+template <typename Function, typename Fallback, typename Domain>
+struct GuardedRowKernel {
+  Function function;
+  Fallback fallback;
+  template <typename T>
+  void operator()(const T* source, T* destination, int size) const {
+    const int BLOCK = 256;
+    const Domain inDomain = Domain();
+    for (int first = 0; first < size; first += BLOCK) {
+      const int last = std::min(first + BLOCK, size);
+      bool inRange = true;
+      for (int i = first; i < last; i++) {
+        inRange &= inDomain(source[i]);
+      }
+      if (inRange) {
+        for (int i = first; i < last; i++) {
+          destination[i] = function(source[i]);
+        }
+      } else {
+        for (int i = first; i < last; i++) {
+          destination[i] = fallback(source[i]);
+        }
+      }
+    }
+  }
+};
+
+template <typename Function>
+RowKernel<Function> rowKernel(const Function& function) {
+  return RowKernel<Function>{function};
+}
+
+template <typename Function, typename Fallback>
+GuardedRowKernel<Function, Fallback, SineDomain> trigonometricKernel(
+    const Function& function, const Fallback& fallback) {
+  return GuardedRowKernel<Function, Fallback, SineDomain>{function, fallback};
+}
+
+/**
+ * Non-positive and infinite bases are computed by std::pow.
+ */
+template <typename T>
+GuardedRowKernel<Pow<T>, StdPow<T>, PowDomain> powKernel(const T& exponent) {
+  return GuardedRowKernel<Pow<T>, StdPow<T>, PowDomain>{
+    Pow<T>{exponent}, StdPow<T>{exponent}
+  };
+}
+
+/**
+ * It applies the kernel to each row of source writing into destination,
+ * which must have the same dimensions, in parallel for large matrices.
+ */
+template <typename T, typename Kernel>
+void applyKernel(const Matrix<T>& source, Matrix<T>& destination, 
+    const Kernel& kernel) {
+  const int columns = source.getColumns();
+  if (columns == 0) return;
+  parallelFor(0, source.getRows(), rowsPerChunk(columns), 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        kernel(source[i].data(), &destination(i, 0), columns);
+      }
+  });
+}
+
+} // namespace vectorized
+
+#define ELEMENTWISE_FUNCTION(NAME, KERNEL)                                  \
+template <typename T>                                                       \
+Matrix<T> NAME(const Matrix<T>& matrix) {                                   \
+  Matrix<T> resultingMatrix(matrix.getRows(), matrix.getColumns());         \
+  vectorized::applyKernel(matrix, resultingMatrix, vectorized::KERNEL);     \
+  return resultingMatrix;                                                   \
+}                                                                           \
+                                                                            \
+template <typename T>                                                       \
+Matrix<T>& NAME##InPlace(Matrix<T>& matrix) {                               \
+  vectorized::applyKernel(matrix, matrix, vectorized::KERNEL);              \
+  return matrix;                                                            \
+}
+
+ELEMENTWISE_FUNCTION(exp, rowKernel(vectorized::Exp()))
+ELEMENTWISE_FUNCTION(log, rowKernel(vectorized::Log()))
+ELEMENTWISE_FUNCTION(sqrt, rowKernel(vectorized::Sqrt()))
+ELEMENTWISE_FUNCTION(tanh, rowKernel(vectorized::Tanh()))
+ELEMENTWISE_FUNCTION(sigmoid, rowKernel(vectorized::Sigmoid()))
+ELEMENTWISE_FUNCTION(sin, trigonometricKernel(vectorized::Sin(), 
+                                              vectorized::StdSin()))
+ELEMENTWISE_FUNCTION(cos, trigonometricKernel(vectorized::Cos(), 
+                                              vectorized::StdCos()))
+ELEMENTWISE_FUNCTION(tan, trigonometricKernel(vectorized::Tan(), 
+                                              vectorized::StdTan()))
+
+#undef ELEMENTWISE_FUNCTION
+
+template <typename T>
+Matrix<T> elementwisePow(const Matrix<T>& matrix, const T& exponent) {
+  Matrix<T> resultingMatrix(matrix.getRows(), matrix.getColumns());
+  vectorized::applyKernel(matrix, resultingMatrix, 
+                          vectorized::powKernel(exponent));
+  return resultingMatrix;
+}
+
+template <typename T>
+Matrix<T>& elementwisePowInPlace(Matrix<T>& matrix, const T& exponent) {
+  vectorized::applyKernel(matrix, matrix, vectorized::powKernel(exponent));
+  return matrix;
+}
+
+#endif // ELEMENTWISE_FUNCTIONS_H
@@ -0,0 +1,571 @@
+/*
+  @file factorization_updates.h Low rank updates of factorizations and inverses
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef FACTORIZATION_UPDATES_H
+#define FACTORIZATION_UPDATES_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/*
+	Factorizations which follow small changes of their matrix in O(n^2)
+	instead of being computed again in O(n^3):
+	
+	  CholeskyFactorization  R^T R = A with R upper triangular. Rank one 
+	                         and rank k updates A +- x x^T, and inserting 
+	                         or deleting a row and column of A.
+	  QRFactorization        the R of X = Q R for observations X, one per
+	                         row, without Q. insertRow and deleteRow edit
+	                         X and R together, and leastSquares solves 
+	                         min ||X b - y|| from R.
+	  shermanMorrisonUpdate  the inverse of A + u v^T from the one of A,
+	  woodburyUpdate         and of A + U V^T for n x k matrices U and V.
+	
+	A row of X added to a QR factorization is rotated into R by Givens 
+	rotations, which is also how A + x x^T is done. Removing x x^T uses 
+	the method of LINPACK's dchdd, which first solves R^T p = x: the 
+	result is positive definite only if |p| < 1, so a failing downdate is
+	detected before anything changes. As in the rest of the library the 
+	functions return false (or an empty result) when they fail and leave
+	their operands as they were.
+*/
+
+/**
+ * It rotates x, whose cell i goes with row offset + i of factor, into the
+ * rows [offset, n) of the upper triangular factor: R^T R + x x^T.
+ * x is overwritten.
+ */
+template <typename T>
+void rotateIntoFactor(TriangularMatrix<T>& factor, int offset, T* x) {
+  const int rank = factor.getRows();
+  for (int k = offset; k < rank; k++) {
+    T* row = factor.packedRow(k);
+    const T a = row[0];
+    const T b = x[k - offset];
+    if (b == T()) continue;
+    const T r = std::hypot(a, b);
+    const T c = a / r;
+    const T s = b / r;
+    row[0] = r;
+    T* rest = x + (k - offset);
+    for (int j = 1; j < rank - k; j++) {
+      const T t = row[j];
+      row[j] = c * t + s * rest[j];
+      rest[j] = c * rest[j] - s * t;
+    }
+  }
+}
+
+/**
+ * R^T R - x x^T on the rows [offset, n) of factor. It returns false, 
+ * with factor unchanged, when the result would not be positive definite.
+ */
+template <typename T>
+bool downdateFactor(TriangularMatrix<T>& factor, int offset, const T* x) {
+  const int rank = factor.getRows();
+  const int size = rank - offset;
+  // R^T p = x, R^T is lower triangular and its columns are rows of R
+  std::vector<T> p(x, x + size);
+  for (int i = 0; i < size; i++) {
+    const T* row = factor.packedRow(offset + i);
+    if (row[0] == T()) return false;
+    p[i] /= row[0];
+    for (int j = 1; j < size - i; j++) {
+      p[i + j] -= row[j] * p[i];
+    }
+  }
+  const T norm = dotProduct(p.data(), p.data(), size);
+  if (not (norm < T(1) - std::numeric_limits<T>::epsilon())) return false;
+  std::vector<T> c(size), s(size);
+  T alpha = std::sqrt(T(1) - norm);
+  for (int i = size - 1; i >= 0; i--) {
+    const T scale = alpha + std::abs(p[i]);
+    const T a = alpha / scale;
+    const T b = p[i] / scale;
+    const T length = std::hypot(a, b);
+    c[i] = a / length;
+    s[i] = b / length;
+    alpha = scale * length;
+  }
+  // Column j of R goes through the rotations j, j-1 ... 0 with xx[j]
+  std::vector<T> xx(size, T());
+  for (int i = size - 1; i >= 0; i--) {
+    T* row = factor.packedRow(offset + i);
+    for (int j = 0; j < size - i; j++) {
+      const T t = c[i] * xx[i + j] + s[i] * row[j];
+      row[j] = c[i] * row[j] - s[i] * xx[i + j];
+      xx[i + j] = t;
+    }
+  }
+  return true;
+}
+
+/**
+ * It solves R^T R X = B in place, B has as many rows as R. Both sweeps 
+ * walk rows of R and of B.
+ */
+template <typename T>
+void solveWithFactor(const TriangularMatrix<T>& factor, Matrix<T>& b) {
+  const int rank = factor.getRows();
+  const int columns = b.getColumns();
+  for (int i = 0; i < rank; i++) {
+    const T* row = factor.packedRow(i);
+    T* solved = &b(i, 0);
+    for (int c = 0; c < columns; c++) {
+      solved[c] /= row[0];
+    }
+    for (int j = 1; j < rank - i; j++) {
+      T* pending = &b(i + j, 0);
+      for (int c = 0; c < columns; c++) {
+        pending[c] -= row[j] * solved[c];
+      }
+    }
+  }
+  for (int i = rank - 1; i >= 0; i--) {
+    const T* row = factor.packedRow(i);
+    T* solved = &b(i, 0);
+    for (int j = 1; j < rank - i; j++) {
+      const T* known = &b(i + j, 0);
+      for (int c = 0; c < columns; c++) {
+        solved[c] -= row[j] * known[c];
+      }
+    }
+    for (int c = 0; c < columns; c++) {
+      solved[c] /= row[0];
+    }
+  }
+}
+
+/**
+ * CholeskyFactorization class
+ * R^T R = A for a symmetric positive definite A, with R upper triangular
+ * (R = L^T for the L of choleskyDecomposition). It is empty when A is 
+ * not positive definite.
+ */
+template <typename T>
+class CholeskyFactorization {
+  static_assert(std::is_floating_point<T>::value, 
+                "The factorizations need floating point cells");
+ public:
+  CholeskyFactorization() {}
+  explicit CholeskyFactorization(const SymmetricMatrix<T>& symmetric);
+  
+  int getRows() const { return factor.getRows(); }
+  bool isEmpty() const { return factor.isEmpty(); }
+  const TriangularMatrix<T>& getFactor() const { return factor; }
+  
+  bool update(const std::vector<T>& x);
+  bool downdate(const std::vector<T>& x);
+  // The rows of vectors are the x of rank one updates or downdates
+  bool update(const Matrix<T>& vectors);
+  bool downdate(const Matrix<T>& vectors);
+  bool insertRowAndColumn(int index, const std::vector<T>& values);
+  bool deleteRowAndColumn(int index);
+  
+  Matrix<T> solve(const Matrix<T>& matrix) const;
+ private:
+  TriangularMatrix<T> factor;
+};
+
+template <typename T>
+CholeskyFactorization<T>::CholeskyFactorization(
+    const SymmetricMatrix<T>& symmetric) {
+  const TriangularMatrix<T> lower = choleskyDecomposition(symmetric);
+  const int rank = lower.getRows();
+  if (rank != symmetric.getRows()) return;
+  factor = TriangularMatrix<T>(rank, Triangle::Upper);
+  for (int i = 0; i < rank; i++) {
+    const T* row = lower.packedRow(i);
+    for (int j = 0; j <= i; j++) {
+      factor(j, i) = row[j];
+    }
+  }
+}
+
+/**
+ * A + x x^T, O(n^2).
+ */
+template <typename T>
+bool CholeskyFactorization<T>::update(const std::vector<T>& x) {
+  if (static_cast<int>(x.size()) != getRows() or isEmpty()) return false;
+  std::vector<T> work(x);
+  rotateIntoFactor(factor, 0, work.data());
+  return true;
+}
+
+/**
+ * A - x x^T, O(n^2). It fails if the result is not positive definite.
+ */
+template <typename T>
+bool CholeskyFactorization<T>::downdate(const std::vector<T>& x) {
+  if (static_cast<int>(x.size()) != getRows() or isEmpty()) return false;
+  return downdateFactor(factor, 0, x.data());
+}
+
+/**
+ * A + V^T V, O(k n^2).
+ */
+template <typename T>
+bool CholeskyFactorization<T>::update(const Matrix<T>& vectors) {
+  if (vectors.getColumns() != getRows() or isEmpty()) return false;
+  for (int i = 0; i < vectors.getRows(); i++) {
+    std::vector<T> work(vectors[i]);
+    rotateIntoFactor(factor, 0, work.data());
+  }
+  return true;
+}
+
+/**
+ * A - V^T V, O(k n^2). It is done on a copy when k > 1, so a failure in 
+ * the middle leaves the factorization as it was.
+ */
+template <typename T>
+bool CholeskyFactorization<T>::downdate(const Matrix<T>& vectors) {
+  if (vectors.getColumns() != getRows() or isEmpty()) return false;
+  if (vectors.getRows() == 1) return downdateFactor(factor, 0, &vectors(0, 0));
+  TriangularMatrix<T> work = factor;
+  for (int i = 0; i < vectors.getRows(); i++) {
+    if (not downdateFactor(work, 0, vectors[i].data())) return false;
+  }
+  factor = std::move(work);
+  return true;
+}
+
+/**
+ * A grows with a row and column at index, values holds its n + 1 cells,
+ * values[index] on the diagonal. With A = [A11 a1 A13; . alpha a3; . . 
+ * A33] the new factor keeps R11, r1 = R11^-T a1, rho = sqrt(alpha - 
+ * r1^T r1), r3 = (a3 - R13^T r1) / rho, and R33 is downdated by r3.
+ * O(n^2).
+ */
+template <typename T>
+bool CholeskyFactorization<T>::insertRowAndColumn(int index, 
+    const std::vector<T>& values) {
+  const int rank = getRows();
+  if (index < 0 or index > rank or 
+      static_cast<int>(values.size()) != rank + 1) {
+    return false;
+  }
+  std::vector<T> r1(values.begin(), values.begin() + index);
+  for (int i = 0; i < index; i++) {
+    const T* row = factor.packedRow(i);
+    r1[i] /= row[0];
+    for (int j = 1; j < index - i; j++) {
+      r1[i + j] -= row[j] * r1[i];
+    }
+  }
+  const T squared = values[index] - dotProduct(r1.data(), r1.data(), index);
+  if (not (squared > T())) return false;
+  const T rho = std::sqrt(squared);
+  std::vector<T> r3(values.begin() + index + 1, values.end());
+  for (int i = 0; i < index; i++) {
+    const T* row = factor.packedRow(i) + (index - i);
+    for (int j = 0; j < rank - index; j++) {
+      r3[j] -= row[j] * r1[i];
+    }
+  }
+  for (T& value : r3) value /= rho;
+  TriangularMatrix<T> grown(rank + 1, Triangle::Upper);
+  for (int i = 0; i <= rank; i++) {
+    T* row = grown.packedRow(i);
+    if (i < index) {
+      const T* old = factor.packedRow(i);
+      std::copy(old, old + (index - i), row);
+      row[index - i] = r1[i];
+      std::copy(old + (index - i), old + (rank - i), row + (index - i) + 1);
+    } else if (i == index) {
+      row[0] = rho;
+      std::copy(r3.begin(), r3.end(), row + 1);
+    } else {
+      const T* old = factor.packedRow(i - 1);
+      std::copy(old, old + (rank - i + 1), row);
+    }
+  }
+  if (not downdateFactor(grown, index + 1, r3.data())) return false;
+  factor = std::move(grown);
+  return true;
+}
+
+/**
+ * Without column index R has a bulge below the diagonal of the columns
+ * that follow, which is the same as updating the trailing factor by the
+ * rest of row index of R. O(n^2).
+ */
+template <typename T>
+bool CholeskyFactorization<T>::deleteRowAndColumn(int index) {
+  const int rank = getRows();
+  if (index < 0 or index >= rank) return false;
+  std::vector<T> x(factor.packedRow(index) + 1, 
+                   factor.packedRow(index) + (rank - index));
+  TriangularMatrix<T> shrunk(rank - 1, Triangle::Upper);
+  for (int i = 0; i < rank - 1; i++) {
+    T* row = shrunk.packedRow(i);
+    if (i < index) {
+      const T* old = factor.packedRow(i);
+      std::copy(old, old + (index - i), row);
+      std::copy(old + (index - i) + 1, old + (rank - i), row + (index - i));
+    } else {
+      const T* old = factor.packedRow(i + 1);
+      std::copy(old, old + (rank - i - 1), row);
+    }
+  }
+  rotateIntoFactor(shrunk, index, x.data());
+  factor = std::move(shrunk);
+  return true;
+}
+
+/**
+ * A X = matrix by two triangular sweeps, O(n^2) per column of matrix.
+ */
+template <typename T>
+Matrix<T> CholeskyFactorization<T>::solve(const Matrix<T>& matrix) const {
+  if (matrix.getRows() != getRows() or isEmpty()) return {};
+  Matrix<T> solution(matrix);
+  solveWithFactor(factor, solution);
+  return solution;
+}
+
+/**
+ * QRFactorization class
+ * The R of the QR factorization of a matrix of observations, one per 
+ * row, and the matrix itself, which insertRow and deleteRow edit along 
+ * with R in O(n^2) each. Q is never formed.
+ */
+template <typename T>
+class QRFactorization {
+  static_assert(std::is_floating_point<T>::value, 
+                "The factorizations need floating point cells");
+ public:
+  QRFactorization() {}
+  explicit QRFactorization(const Matrix<T>& matrix);
+  
+  const Matrix<T>& getMatrix() const { return matrix; }
+  const TriangularMatrix<T>& getR() const { return factor; }
+  
+  bool insertRow(int row, const std::vector<T>& values);
+  bool deleteRow(int row);
+  Matrix<T> leastSquares(const Matrix<T>& rhs) const;
+ private:
+  Matrix<T> matrix;
+  TriangularMatrix<T> factor;
+  
+  void refactorize();
+};
+
+template <typename T>
+QRFactorization<T>::QRFactorization(const Matrix<T>& matrix) 
+    : matrix (matrix) {
+  refactorize();
+}
+
+/**
+ * Every row is rotated into R, O(m n^2) as Householder's QR and as 
+ * stable.
+ */
+template <typename T>
+void QRFactorization<T>::refactorize() {
+  const int columns = matrix.getColumns();
+  factor = TriangularMatrix<T>(columns, Triangle::Upper);
+  std::vector<T> work(columns);
+  // Read through data(), as a row of no columns has no cell 0
+  const Matrix<T>& rows = matrix;
+  for (int i = 0; i < rows.getRows(); i++) {
+    std::copy(rows[i].data(), rows[i].data() + columns, work.begin());
+    rotateIntoFactor(factor, 0, work.data());
+  }
+}
+
+template <typename T>
+bool QRFactorization<T>::insertRow(int row, const std::vector<T>& values) {
+  const int columns = matrix.getColumns();
+  if (static_cast<int>(values.size()) != columns or 
+      not matrix.insertRow(row)) {
+    return false;
+  }
+  if (columns == 0) return true;
+  std::copy(values.begin(), values.end(), &matrix(row, 0));
+  std::vector<T> work(values);
+  rotateIntoFactor(factor, 0, work.data());
+  return true;
+}
+
+/**
+ * When the remaining rows lose rank, or nearly, the downdate is refused 
+ * and R is computed again from them.
+ */
+template <typename T>
+bool QRFactorization<T>::deleteRow(int row) {
+  if (row < 0 or row >= matrix.getRows()) return false;
+  const Matrix<T>& rows = matrix;
+  const std::vector<T> values(rows[row].begin(), rows[row].end());
+  matrix.deleteRow(row);
+  if (not downdateFactor(factor, 0, values.data())) refactorize();
+  return true;
+}
+
+/**
+ * min ||X B - rhs|| column by column by the corrected semi-normal 
+ * equations: R^T R B = X^T rhs and one step of refinement with the 
+ * residual, which recovers the accuracy of a solution through Q. 
+ * O(m n + n^2) per column. It is empty when R is singular.
+ */
+template <typename T>
+Matrix<T> QRFactorization<T>::leastSquares(const Matrix<T>& rhs) const {
+  const int columns = factor.getRows();
+  if (rhs.getRows() != matrix.getRows() or columns == 0) return {};
+  for (int i = 0; i < columns; i++) {
+    if (factor.packedRow(i)[0] == T()) return {};
+  }
+  Matrix<T> solution = multiplyMatrices(matrix.transposedView(), rhs);
+  solveWithFactor(factor, solution);
+  Matrix<T> residual = rhs;
+  residual -= multiplyMatrices(matrix, solution);
+  Matrix<T> correction = multiplyMatrices(matrix.transposedView(), residual);
+  solveWithFactor(factor, correction);
+  solution += correction;
+  return solution;
+}
+
+/**
+ * The inverse by Gauss-Jordan elimination with partial pivoting, O(n^3),
+ * or an empty matrix when matrix is not square or is singular.
+ */
+template <typename T>
+Matrix<T> inverse(const Matrix<T>& matrix) {
+  static_assert(std::is_floating_point<T>::value, 
+                "The inverse needs floating point cells");
+  INSTRUMENT_OPERATION("inverse", matrix.numberOfCells(), 
+      2LL * matrix.numberOfCells() * matrix.getRows(), 
+      2 * sizeof(T) * matrix.numberOfCells() * matrix.getRows());
+  const int rank = matrix.getRows();
+  if (rank != matrix.getColumns() or rank == 0) return {};
+  Matrix<T> work(matrix);
+  Matrix<T> result = Matrix<T>::identity(rank, T(1));
+  const std::vector<T*> workRows = rowPointers(work);
+  const std::vector<T*> resultRows = rowPointers(result);
+  for (int k = 0; k < rank; k++) {
+    int pivot = k;
+    for (int i = k + 1; i < rank; i++) {
+      if (std::abs(workRows[i][k]) > std::abs(workRows[pivot][k])) pivot = i;
+    }
+    if (workRows[pivot][k] == T()) return {};
+    if (pivot != k) {
+      std::swap_ranges(workRows[k], workRows[k] + rank, workRows[pivot]);
+      std::swap_ranges(resultRows[k], resultRows[k] + rank, resultRows[pivot]);
+    }
+    T* pivotRow = workRows[k];
+    T* pivotResult = resultRows[k];
+    const T scale = T(1) / pivotRow[k];
+    for (int j = 0; j < rank; j++) {
+      pivotRow[j] *= scale;
+      pivotResult[j] *= scale;
+    }
+    parallelFor(0, rank, rowsPerChunk(2 * rank), [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        T* row = workRows[i];
+        const T factor = row[k];
+        if (i == k or factor == T()) continue;
+        T* resultRow = resultRows[i];
+        for (int j = 0; j < rank; j++) {
+          row[j] -= factor * pivotRow[j];
+          resultRow[j] -= factor * pivotResult[j];
+        }
+      }
+    });
+  }
+  return result;
+}
+
+/**
+ * It turns the inverse of A into the one of A + u v^T:
+ * A^-1 - (A^-1 u)(v^T A^-1) / (1 + v^T A^-1 u), O(n^2). It fails when 
+ * the denominator vanishes, A + u v^T is singular then.
+ */
+template <typename T>
+bool shermanMorrisonUpdate(Matrix<T>& inverse, const std::vector<T>& u, 
+                           const std::vector<T>& v) {
+  INSTRUMENT_OPERATION("shermanMorrisonUpdate", inverse.numberOfCells(), 
+                       4LL * inverse.numberOfCells(), 
+                       3 * sizeof(T) * inverse.numberOfCells());
+  const int rank = inverse.getRows();
+  if (rank != inverse.getColumns() or static_cast<int>(u.size()) != rank or
+      static_cast<int>(v.size()) != rank) {
+    return false;
+  }
+  std::vector<T> w(rank), z(rank, T());
+  for (int i = 0; i < rank; i++) {
+    const T* row = &inverse(i, 0);
+    w[i] = dotProduct(row, u.data(), rank);
+    for (int j = 0; j < rank; j++) {
+      z[j] += v[i] * row[j];
+    }
+  }
+  const T denominator = T(1) + dotProduct(v.data(), w.data(), rank);
+  if (std::abs(denominator) <= std::numeric_limits<T>::epsilon()) {
+    return false;
+  }
+  parallelFor(0, rank, rowsPerChunk(rank), [&](int first, int last) {
+    for (int i = first; i < last; i++) {
+      T* row = &inverse(i, 0);
+      const T factor = w[i] / denominator;
+      for (int j = 0; j < rank; j++) {
+        row[j] -= factor * z[j];
+      }
+    }
+  });
+  return true;
+}
+
+/**
+ * It turns the inverse of A into the one of A + U V^T, with n x k 
+ * matrices U and V: A^-1 - W (I + V^T W)^-1 Z with W = A^-1 U and 
+ * Z = V^T A^-1, O(k n^2 + k^3). It fails when I + V^T W is singular.
+ */
+template <typename T>
+bool woodburyUpdate(Matrix<T>& inverse, const Matrix<T>& u, 
+                    const Matrix<T>& v) {
+  const int rank = inverse.getRows();
+  if (rank != inverse.getColumns() or u.getRows() != rank or 
+      not u.hasSameDimensionsAs(v)) {
+    return false;
+  }
+  const Matrix<T> w = multiplyMatrices(inverse, u);
+  const Matrix<T> z = multiplyMatrices(v.transposedView(), inverse);
+  Matrix<T> capacitance = multiplyMatrices(v.transposedView(), w);
+  for (int i = 0; i < capacitance.getRows(); i++) {
+    capacitance(i, i) += T(1);
+  }
+  const Matrix<T> capacitanceInverse = ::inverse(capacitance);
+  if (capacitanceInverse.isEmpty()) return false;
+  inverse -= multiplyMatrices(w, multiplyMatrices(capacitanceInverse, z));
+  return true;
+}
+
+#endif // FACTORIZATION_UPDATES_H
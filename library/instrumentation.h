@@ -0,0 +1,294 @@
+/*
+  @file instrumentation.h Opt-in counters and tracing of the library operations
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+	Opt-in instrumentation of the public operations of the library. It is 
+	compiled in by defining MATRICES_INSTRUMENTATION before including any 
+	header of the library, otherwise INSTRUMENT_OPERATION and 
+	INSTRUMENT_ALLOCATION expand to nothing and the functions below 
+	return nothing.
+	
+	Every call to an instrumented operation adds to the statistics of its
+	name: calls, wall time, cells processed, estimated floating point 
+	operations and bytes read and written, and the temporaries (matrices
+	allocated) while it ran, including the ones of the operations it calls.
+	The estimates count one operation per cell for functors, whose real 
+	cost is unknown, and the bytes that a single pass over the operands
+	and the result moves. Iterative operations such as the roots of a
+	polynomial report 0 when there is no useful estimate.
+	
+	  instrumentation::snapshot()          the statistics so far
+	  instrumentation::reset()             clear statistics and trace
+	  instrumentation::setTracing(true)    also keep one event per call
+	  instrumentation::writeChromeTrace(s) the events as Chrome trace JSON,
+	                                       for chrome://tracing or Perfetto
+	
+	At most TRACE_CAPACITY events are kept, the rest are only counted.
+*/
+
+namespace instrumentation {
+
+struct OperationStatistics {
+  std::string name;
+  long long calls;
+  double seconds;
+  long long cells;
+  long long flops;
+  long long bytes;
+  long long temporaries;
+};
+
+} // namespace instrumentation
+
+#ifdef MATRICES_INSTRUMENTATION
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+namespace instrumentation {
+
+const int TRACE_CAPACITY = 1 << 20;
+
+struct TraceEvent {
+  const char* name;
+  double start;
+  double duration;
+  int thread;
+  long long cells;
+  long long flops;
+  long long bytes;
+  long long temporaries;
+};
+
+/**
+ * Registry class
+ * The statistics of every operation and the trace, shared by all the 
+ * threads. The names are string literals, so they are keyed by address.
+ */
+class Registry {
+ public:
+  static Registry& instance() {
+    static Registry registry;
+    return registry;
+  }
+  
+  void record(const TraceEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    OperationStatistics& statistics = operations[event.name];
+    statistics.calls++;
+    statistics.seconds += event.duration;
+    statistics.cells += event.cells;
+    statistics.flops += event.flops;
+    statistics.bytes += event.bytes;
+    statistics.temporaries += event.temporaries;
+    if (tracing) {
+      if (events.size() < static_cast<size_t>(TRACE_CAPACITY)) {
+        events.push_back(event);
+      } else {
+        droppedEvents++;
+      }
+    }
+  }
+  
+  std::vector<OperationStatistics> snapshot();
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    operations.clear();
+    events.clear();
+    droppedEvents = 0;
+  }
+  void setTracing(bool enabled) { 
+    std::lock_guard<std::mutex> lock(mutex);
+    tracing = enabled; 
+  }
+  bool writeChromeTrace(std::ostream& outputStream);
+  
+  double now() const {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - origin).count();
+  }
+  int threadNumber() {
+    static thread_local int number = nextThread++;
+    return number;
+  }
+ private:
+  Registry() : origin (std::chrono::steady_clock::now()), nextThread (0), 
+               droppedEvents (0), tracing (false) {}
+  
+  std::mutex mutex;
+  std::map<const char*, OperationStatistics> operations;
+  std::vector<TraceEvent> events;
+  const std::chrono::steady_clock::time_point origin;
+  std::atomic<int> nextThread;
+  long long droppedEvents;
+  bool tracing;
+};
+
+/**
+ * Operations with the same name from different literals are merged, 
+ * and the result is sorted by decreasing time.
+ */
+inline std::vector<OperationStatistics> Registry::snapshot() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, OperationStatistics> merged;
+  for (const auto& entry : operations) {
+    OperationStatistics& statistics = merged[entry.first];
+    statistics.name = entry.first;
+    statistics.calls += entry.second.calls;
+    statistics.seconds += entry.second.seconds;
+    statistics.cells += entry.second.cells;
+    statistics.flops += entry.second.flops;
+    statistics.bytes += entry.second.bytes;
+    statistics.temporaries += entry.second.temporaries;
+  }
+  std::vector<OperationStatistics> result;
+  for (const auto& entry : merged) {
+    result.push_back(entry.second);
+  }
+  std::sort(result.begin(), result.end(), 
+    [](const OperationStatistics& a, const OperationStatistics& b) {
+      return a.seconds > b.seconds;
+    });
+  return result;
+}
+
+/**
+ * The times are written in microseconds with fixed notation, so events
+ * keep their order and resolution however long the process has run.
+ */
+inline bool Registry::writeChromeTrace(std::ostream& outputStream) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const std::ios_base::fmtflags flags = outputStream.flags();
+  const std::streamsize precision = outputStream.precision();
+  outputStream << std::fixed << std::setprecision(3);
+  outputStream << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); i++) {
+    const TraceEvent& event = events[i];
+    outputStream << (i == 0 ? "" : ",") << "\n{\"name\":\"" << event.name
+                 << "\",\"cat\":\"matrices\",\"ph\":\"X\",\"pid\":1,"
+                 << "\"tid\":" << event.thread 
+                 << ",\"ts\":" << event.start * 1e6 
+                 << ",\"dur\":" << event.duration * 1e6
+                 << ",\"args\":{\"cells\":" << event.cells 
+                 << ",\"flops\":" << event.flops 
+                 << ",\"bytes\":" << event.bytes 
+                 << ",\"temporaries\":" << event.temporaries << "}}";
+  }
+  outputStream << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":"
+               << "{\"droppedEvents\":" << droppedEvents << "}}\n";
+  outputStream.flags(flags);
+  outputStream.precision(precision);
+  return static_cast<bool>(outputStream);
+}
+
+/**
+ * Matrices allocated by the calling thread so far.
+ */
+inline long long& allocations() {
+  static thread_local long long count = 0;
+  return count;
+}
+
+/**
+ * ScopedOperation class
+ * It times the enclosing scope and records it when it ends.
+ */
+class ScopedOperation {
+ public:
+  ScopedOperation(const char* name, long long cells, long long flops, 
+                  long long bytes)
+      : registry (Registry::instance()), firstAllocation (allocations()) {
+    event.name = name;
+    event.cells = cells;
+    event.flops = flops;
+    event.bytes = bytes;
+    event.start = registry.now();
+  }
+  ~ScopedOperation() {
+    event.duration = registry.now() - event.start;
+    event.thread = registry.threadNumber();
+    event.temporaries = allocations() - firstAllocation;
+    registry.record(event);
+  }
+ private:
+  ScopedOperation(const ScopedOperation&) = delete;
+  ScopedOperation& operator=(const ScopedOperation&) = delete;
+  
+  Registry& registry;
+  const long long firstAllocation;
+  TraceEvent event;
+};
+
+inline std::vector<OperationStatistics> snapshot() {
+  return Registry::instance().snapshot();
+}
+inline void reset() { Registry::instance().reset(); }
+inline void setTracing(bool enabled) { 
+  Registry::instance().setTracing(enabled); 
+}
+inline bool writeChromeTrace(std::ostream& outputStream) {
+  return Registry::instance().writeChromeTrace(outputStream);
+}
+
+} // namespace instrumentation
+
+#define INSTRUMENTATION_CONCATENATE(a, b) a##b
+#define INSTRUMENTATION_VARIABLE(line) \
+  INSTRUMENTATION_CONCATENATE(instrumentedOperation, line)
+#define INSTRUMENT_OPERATION(name, cells, flops, bytes) \
+  instrumentation::ScopedOperation INSTRUMENTATION_VARIABLE(__LINE__)( \
+      name, cells, flops, bytes)
+#define INSTRUMENT_ALLOCATION() (instrumentation::allocations()++)
+
+#else
+
+namespace instrumentation {
+
+inline std::vector<OperationStatistics> snapshot() { return {}; }
+inline void reset() {}
+inline void setTracing(bool) {}
+inline bool writeChromeTrace(std::ostream&) { return false; }
+
+} // namespace instrumentation
+
+#define INSTRUMENT_OPERATION(name, cells, flops, bytes) ((void)0)
+#define INSTRUMENT_ALLOCATION() ((void)0)
+
+#endif // MATRICES_INSTRUMENTATION
+
+#endif // INSTRUMENTATION_H
@@ -29,11 +29,49 @@
 #ifndef MATRICES_CPP
 #define MATRICES_CPP
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
  
 /**
  * Matrix class implementation
  */
+
+/**
+ * It calls functor(i, j) for every cell of a rows x columns matrix 
+ * visiting them by square tiles. When one of the operands is read 
+ * transposed, its rows and columns both stay in cache along a tile.
+ */
+template <typename Functor>
+void forEachCellByTiles(int rows, int columns, const Functor& functor) {
+  const int TILE = 32;
+  for (int ii = 0; ii < rows; ii += TILE) {
+    const int iEnd = std::min(ii + TILE, rows);
+    for (int jj = 0; jj < columns; jj += TILE) {
+      const int jEnd = std::min(jj + TILE, columns);
+      for (int i = ii; i < iEnd; i++) {
+        for (int j = jj; j < jEnd; j++) {
+          functor(i, j);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * The rows of matrix, for the kernels writing it cell by cell: taking 
+ * them counts once as a write for its version, which the non const 
+ * operator() does on every call.
+ */
+template <typename T>
+std::vector<T*> rowPointers(Matrix<T>& matrix) {
+  std::vector<T*> rows(matrix.getRows());
+  if (matrix.getColumns() == 0) return rows;
+  for (int i = 0; i < matrix.getRows(); i++) {
+    rows[i] = &matrix(i, 0);
+  }
+  return rows;
+}
  
 // CONSTRUCTORS
 
@@ -47,58 +85,106 @@ Matrix<T>::Matrix()
 /**
  * It creates a Matrix with a specific number of rows and columns 
  * and also with an optional default value for each cell.
+ * Once the thread pool is pinned to NUMA nodes (see numa.h), large 
+ * matrices allocate and fill their rows in it, split as the parallel 
+ * kernels split them, so the pages of a row are first touched by the 
+ * node which will process it. Otherwise they are filled by the calling 
+ * thread, which does not wait for the pool.
  */
 template <typename T>
 Matrix<T>::Matrix(int rows, int columns, const T& value)
-    : matrix (rows, std::vector<T>(columns, value)) {
+    : matrix (rows) {
+  INSTRUMENT_ALLOCATION();
   this->rows = rows;
   this->columns = columns;
+  const auto fill = [&](int first, int last) {
+    for (int i = first; i < last; i++) {
+      matrix[i].assign(columns, value);
+    }
+  };
+  if (ThreadPool::instance().domainCount() > 1) {
+    parallelFor(0, rows, rowsPerChunk(columns), fill);
+  } else {
+    fill(0, rows);
+  }
 }
 
 template <typename T>
 Matrix<T>::Matrix(const Matrix& other)
     : matrix (other.matrix) {
+  INSTRUMENT_ALLOCATION();
   rows = other.rows;
   columns = other.columns;
 }
 
 template <typename T>
 Matrix<T>::Matrix(Matrix&& other)
-    : matrix (std::move(other.matrix)) {
+    : matrix (std::move(other.matrix)), serial (other.serial), 
+      state (other.state.load(std::memory_order_relaxed)) {
   rows = other.rows;
   columns = other.columns;
   other.rows = 0;
   other.columns = 0;
+  other.serial = nextMatrixSerial();
+  other.state = 0;
   // std::cout << "Move contructor" << std::endl;
 }
 
+/**
+ * Each row is built straight from the other matrix's row, so the cells
+ * are converted into uninitialized storage instead of being value
+ * initialized first and assigned afterwards. For arithmetic types
+ * (int, float, double, and real to complex) this is a plain conversion
+ * loop which the compiler vectorizes.
+ */
 template <typename T>
 template <typename K>
-Matrix<T>::Matrix(const Matrix<K>& other)
-    : matrix (other.getRows(), std::vector<T>(other.getColumns())) {
+Matrix<T>::Matrix(const Matrix<K>& other) {
+  INSTRUMENT_ALLOCATION();
   rows = other.getRows();
   columns = other.getColumns();
+  matrix.reserve(rows);
   for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      matrix[i][j] = other[i][j];
-    }
+    matrix.emplace_back(begin(other[i]), end(other[i]));
   }
 }
 
+/**
+ * The cells of the other matrix are moved into the conversion and every
+ * source row is released as soon as it has been converted, so the peak
+ * memory stays close to one matrix plus one row instead of two whole
+ * matrices.
+ */
 template <typename T>
 template <typename K>
-Matrix<T>::Matrix(Matrix<K>&& other)
-    : matrix (other.getRows(), std::vector<T>(other.getColumns())) {
+Matrix<T>::Matrix(Matrix<K>&& other) {
+  INSTRUMENT_ALLOCATION();
   rows = other.getRows();
   columns = other.getColumns();
-  for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      matrix[i][j] = other[i][j];
-    }
+  matrix.reserve(rows);
+  for (std::vector<K>& row : other.matrix) {
+    matrix.emplace_back(std::make_move_iterator(begin(row)), 
+                        std::make_move_iterator(end(row)));
+    std::vector<K>().swap(row);
   }
   other.clear();
 }
 
+/**
+ * It builds the transpose of the matrix viewed by other.
+ */
+template <typename T>
+template <typename K>
+Matrix<T>::Matrix(const TransposedMatrix<K>& other)
+    : matrix (other.getRows(), std::vector<T>(other.getColumns())) {
+  INSTRUMENT_ALLOCATION();
+  rows = other.getRows();
+  columns = other.getColumns();
+  forEachCellByTiles(rows, columns, [&](int i, int j) {
+    matrix[i][j] = other(i, j);
+  });
+}
+
 /**
  * Because of a Matrix must be squared and a initializer_list may not,
  * this constructor creates a matrix sized according to:
@@ -107,6 +193,7 @@ Matrix<T>::Matrix(Matrix<K>&& other)
  */
 template <typename T>
 Matrix<T>::Matrix(std::initializer_list<std::initializer_list<T>> il) {
+  INSTRUMENT_ALLOCATION();
   if (il.size() > 0 and (*begin(il)).size() > 0) {
     rows = il.size();
     columns = (*begin(il)).size();
@@ -130,6 +217,7 @@ Matrix<T>::Matrix(std::initializer_list<std::initializer_list<T>> il) {
 template <typename T>
 Matrix<T>::Matrix(std::initializer_list<T> il)
     : matrix (1, il) {
+  INSTRUMENT_ALLOCATION();
   rows = 1;
   columns = il.size();
 }
@@ -138,6 +226,7 @@ Matrix<T>::Matrix(std::initializer_list<T> il)
 
 template <typename T>
 Matrix<T>& Matrix<T>::operator=(const Matrix& other) {
+  markModified();
   matrix = other.matrix;
   rows = other.rows;
   columns = other.columns;
@@ -146,26 +235,33 @@ Matrix<T>& Matrix<T>::operator=(const Matrix& other) {
 
 template <typename T>
 Matrix<T>& Matrix<T>::operator=(Matrix&& other) {
+  if (&other == this) return *this;
   matrix = std::move(other.matrix);
   rows = other.rows;
   columns = other.columns;
+  serial = other.serial;
+  state = other.state.load(std::memory_order_relaxed);
   other.rows = 0;
   other.columns = 0;
+  other.serial = nextMatrixSerial();
+  other.state = 0;
   // std::cout << "Move assingation" << std::endl;
   return *this;
 }
 
+/**
+ * The rows already allocated by this matrix are reused whenever their
+ * capacity is enough to hold the converted cells.
+ */
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator=(const Matrix<K>& other) {
-  matrix.clear();
+  markModified();
   rows = other.getRows();
   columns = other.getColumns();
-  matrix = std::vector<std::vector<T>>(rows, std::vector<T>(columns));
+  matrix.resize(rows);
   for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      matrix[i][j] = other[i][j];
-    }
+    matrix[i].assign(begin(other[i]), end(other[i]));
   }
   return *this;
 }
@@ -173,19 +269,33 @@ Matrix<T>& Matrix<T>::operator=(const Matrix<K>& other) {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator=(Matrix<K>&& other) {
-  matrix.clear();
+  markModified();
   rows = other.getRows();
   columns = other.getColumns();
-  matrix = std::vector<std::vector<T>>(rows, std::vector<T>(columns));
+  matrix.resize(rows);
   for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      matrix[i][j] = other[i][j];
-    }
+    std::vector<K>& row = other.matrix[i];
+    matrix[i].assign(std::make_move_iterator(begin(row)), 
+                     std::make_move_iterator(end(row)));
+    std::vector<K>().swap(row);
   }
   other.clear();
   return *this;
 }
 
+/**
+ * A pending write is folded into the version by whichever reader sees it
+ * first, so concurrent readers agree on the new version.
+ */
+template <typename T>
+unsigned long Matrix<T>::getVersion() const {
+  unsigned long current = state.load(std::memory_order_relaxed);
+  while ((current & 1) and 
+         not state.compare_exchange_weak(current, current + 1, 
+                                         std::memory_order_relaxed)) {}
+  return (current + (current & 1)) / 2;
+}
+
 template <typename T>
 Matrix<T> Matrix<T>::operator-() const {
   Matrix resultingMatrix(*this);
@@ -205,6 +315,7 @@ Matrix<T> Matrix<T>::operator+() const {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator*=(const K& multiplier) {
+  markModified();
   for (std::vector<T>& vector : matrix) {
     for (T& value : vector) {
       value *= multiplier;
@@ -216,6 +327,7 @@ Matrix<T>& Matrix<T>::operator*=(const K& multiplier) {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator/=(const K& divisor) {
+  markModified();
   for (std::vector<T>& vector : matrix) {
     for (T& value : vector) {
       value /= divisor;
@@ -227,6 +339,7 @@ Matrix<T>& Matrix<T>::operator/=(const K& divisor) {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator+=(const K& adding) {
+  markModified();
   for (std::vector<T>& vector : matrix) {
     for (T& value : vector) {
       value += adding;
@@ -238,6 +351,7 @@ Matrix<T>& Matrix<T>::operator+=(const K& adding) {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator-=(const K& subtrahend) {
+  markModified();
   for (std::vector<T>& vector : matrix) {
     for (T& value : vector) {
       value -= subtrahend;
@@ -249,52 +363,91 @@ Matrix<T>& Matrix<T>::operator-=(const K& subtrahend) {
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator*=(const Matrix<K>& other) {
-  if (hasSameDimensionsAs(other)) {
-    for (int i = 0; i < rows; i++) {
-      for (int j = 0; j < columns; j++) {
-        matrix[i][j] *= other[i][j];
-      }
-    }
-  }
+  broadcastInPlace(matrix_execution::seq, other, 
+                   [](T& x, const K& y) { x *= y; });
   return *this;
 }
 
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator/=(const Matrix<K>& other) {
-  if (hasSameDimensionsAs(other)) {
-    for (int i = 0; i < rows; i++) {
-      for (int j = 0; j < columns; j++) {
-        matrix[i][j] /= other[i][j];
-      }
-    }
-  }
+  broadcastInPlace(matrix_execution::seq, other, 
+                   [](T& x, const K& y) { x /= y; });
   return *this;
 }
 
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator+=(const Matrix<K>& other) {
-  if (hasSameDimensionsAs(other)) {
-    for (int i = 0; i < rows; i++) {
-      for (int j = 0; j < columns; j++) {
-        matrix[i][j] += other[i][j];
-      }
-    }
-  }
+  broadcastInPlace(matrix_execution::seq, other, 
+                   [](T& x, const K& y) { x += y; });
   return *this;
 }
 
 template <typename T>
 template <typename K>
 Matrix<T>& Matrix<T>::operator-=(const Matrix<K>& other) {
-  if (hasSameDimensionsAs(other)) {
+  broadcastInPlace(matrix_execution::seq, other, 
+                   [](T& x, const K& y) { x -= y; });
+  return *this;
+}
+
+/*
+	The compound operators taking a transposed matrix visit the cells by
+	tiles. A matrix combined with its own transpose is copied first, since
+	it would otherwise read cells that it has already overwritten. A row 
+	or a column of other dimensions is copied too and broadcast as the 
+	operators taking a Matrix do.
+*/
+
+template <typename T>
+template <typename K, typename Functor>
+void Matrix<T>::applyFunctorByTiles(const TransposedMatrix<K>& other, 
+    const Functor& functor) {
+  if (not hasSameDimensionsAs(other)) {
+    broadcastInPlace(matrix_execution::seq, Matrix<K>(other), functor);
+    return;
+  }
+  markModified();
+  if (static_cast<const void*>(&other.transpose()) == this) {
+    const Matrix<K> transposed(other);
     for (int i = 0; i < rows; i++) {
       for (int j = 0; j < columns; j++) {
-        matrix[i][j] -= other[i][j];
+        functor(matrix[i][j], transposed[i][j]);
       }
     }
+    return;
   }
+  forEachCellByTiles(rows, columns, [&](int i, int j) {
+    functor(matrix[i][j], other(i, j));
+  });
+}
+
+template <typename T>
+template <typename K>
+Matrix<T>& Matrix<T>::operator*=(const TransposedMatrix<K>& other) {
+  applyFunctorByTiles(other, [](T& x, const K& y) { x *= y; });
+  return *this;
+}
+
+template <typename T>
+template <typename K>
+Matrix<T>& Matrix<T>::operator/=(const TransposedMatrix<K>& other) {
+  applyFunctorByTiles(other, [](T& x, const K& y) { x /= y; });
+  return *this;
+}
+
+template <typename T>
+template <typename K>
+Matrix<T>& Matrix<T>::operator+=(const TransposedMatrix<K>& other) {
+  applyFunctorByTiles(other, [](T& x, const K& y) { x += y; });
+  return *this;
+}
+
+template <typename T>
+template <typename K>
+Matrix<T>& Matrix<T>::operator-=(const TransposedMatrix<K>& other) {
+  applyFunctorByTiles(other, [](T& x, const K& y) { x -= y; });
   return *this;
 }
 
@@ -302,6 +455,8 @@ Matrix<T>& Matrix<T>::operator-=(const Matrix<K>& other) {
 
 template <typename T>
 bool Matrix<T>::insertRow(int row, const T& value) {
+  INSTRUMENT_OPERATION("insertRow", columns, 0, sizeof(T) * columns);
+  markModified();
   if (row < 0 or row > rows) return false;
   matrix.insert(begin(matrix) + row, std::vector<T>(columns, value)); 
   rows++;
@@ -310,6 +465,9 @@ bool Matrix<T>::insertRow(int row, const T& value) {
 
 template <typename T>
 bool Matrix<T>::insertColumn(int column, const T& value) {
+  INSTRUMENT_OPERATION("insertColumn", rows, 0, 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
   if (column < 0 or column > columns) return false;
   for (std::vector<T>& vector: matrix) {
     vector.insert(begin(vector) + column, value);
@@ -320,6 +478,8 @@ bool Matrix<T>::insertColumn(int column, const T& value) {
 
 template <typename T>
 bool Matrix<T>::deleteRow(int row) {
+  INSTRUMENT_OPERATION("deleteRow", columns, 0, sizeof(std::vector<T>) * rows);
+  markModified();
   if (row < 0 or row >= rows) return false;
   matrix.erase(begin(matrix) + row);
   rows--;
@@ -328,6 +488,9 @@ bool Matrix<T>::deleteRow(int row) {
 
 template <typename T>
 bool Matrix<T>::deleteColumn(int column) {
+  INSTRUMENT_OPERATION("deleteColumn", rows, 0, 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
   if (column < 0 or column >= columns) return false;
   for (std::vector<T>& vector: matrix) {
     vector.erase(begin(vector) + column);
@@ -339,6 +502,9 @@ bool Matrix<T>::deleteColumn(int column) {
 template <typename T>
 template <typename K>
 bool Matrix<T>::appendHorizontally(const Matrix<K>& other, int column) {
+  INSTRUMENT_OPERATION("appendHorizontally", other.numberOfCells(), 0, 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
   if (column < 0 or column > columns or rows != other.getRows()) return false;
   for (int i = 0; i < rows; i++) {
     matrix[i].insert(
@@ -353,11 +519,14 @@ bool Matrix<T>::appendHorizontally(const Matrix<K>& other, int column) {
 template <typename T>
 template <typename K>
 bool Matrix<T>::appendVertically(const Matrix<K>& other, int row) {
+  INSTRUMENT_OPERATION("appendVertically", other.numberOfCells(), 0, 
+                       2 * sizeof(T) * other.numberOfCells());
+  markModified();
   if (row < 0 or row > rows or columns != other.getColumns()) return false;
+  matrix.reserve(rows + other.getRows());
   for (int i = 0; i < other.getRows(); i++) {
-    matrix.push_back(
-      std::vector<T>(begin(other[i]), begin(other[i]) + other.getRows())
-    );
+    matrix.insert(begin(matrix) + row + i, 
+                  std::vector<T>(begin(other[i]), end(other[i])));
   }
   rows += other.getRows();
   return true;
@@ -370,6 +539,9 @@ bool Matrix<T>::appendVertically(const Matrix<K>& other, int row) {
 template <typename T>
 template <typename Functor>
 void Matrix<T>::applyFunctor(const Functor& functor) {
+  INSTRUMENT_OPERATION("applyFunctor", numberOfCells(), numberOfCells(), 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
   for (std::vector<T>& vector : matrix) {
     for (T& value : vector) {
       value = std::move(functor(value));
@@ -380,28 +552,114 @@ void Matrix<T>::applyFunctor(const Functor& functor) {
 template <typename T>
 template <typename K, typename Functor>
 void Matrix<T>::applyFunctor(const Matrix<K>& other, const Functor& functor) {
-  if (hasSameDimensionsAs(other)) {
-    for (int i = 0; i < rows; i++) {
-      for (int j = 0; j < columns; j++) {
-        matrix[i][j] = std::move(functor(matrix[i][j], other[i][j]));
+  INSTRUMENT_OPERATION("applyFunctor", numberOfCells(), numberOfCells(), 
+                       (2 * sizeof(T) + sizeof(K)) * numberOfCells());
+  broadcastInPlace(matrix_execution::seq, other, [&](T& x, const K& y) { 
+    x = std::move(functor(x, y)); 
+  });
+}
+
+template <typename T>
+template <typename Policy, typename Functor>
+typename std::enable_if<
+    matrix_execution::isExecutionPolicy<Policy>::value>::type 
+Matrix<T>::applyFunctor(const Policy& policy, const Functor& functor) {
+  INSTRUMENT_OPERATION("applyFunctor", numberOfCells(), numberOfCells(), 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
+  const int columns = this->columns;
+  matrix_execution::forEachRowBlock(policy, rows, columns, 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        T* row = matrix[i].data();
+        matrix_execution::forEachColumn(policy, columns, [&](int j) {
+          row[j] = functor(row[j]);
+        });
       }
-    }
+  });
+}
+
+template <typename T>
+template <typename Policy, typename K, typename Functor>
+void Matrix<T>::applyFunctor(const Policy& policy, const Matrix<K>& other, 
+    const Functor& functor) {
+  INSTRUMENT_OPERATION("applyFunctor", numberOfCells(), numberOfCells(), 
+                       (2 * sizeof(T) + sizeof(K)) * numberOfCells());
+  broadcastInPlace(policy, other, [&](T& x, const K& y) { 
+    x = functor(x, y); 
+  });
+}
+
+/**
+ * It calls functor(cell, otherCell) for every cell with other broadcast
+ * to the dimensions of this matrix (see applyFunctorToMatrices), nothing
+ * when it does not broadcast to them.
+ */
+template <typename T>
+template <typename Policy, typename K, typename Functor>
+void Matrix<T>::broadcastInPlace(const Policy& policy, 
+    const Matrix<K>& other, const Functor& functor) {
+  const int otherRows = other.getRows();
+  const int otherColumns = other.getColumns();
+  if ((otherRows != rows and otherRows != 1) or 
+      (otherColumns != columns and otherColumns != 1)) {
+    return;
   }
+  markModified();
+  const int columns = this->columns;
+  const bool spread = otherColumns != columns;
+  matrix_execution::forEachRowBlock(policy, rows, columns, 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        T* row = matrix[i].data();
+        const K* otherRow = other[otherRows == 1 ? 0 : i].data();
+        if (spread) {
+          const K value = otherRow[0];
+          matrix_execution::forEachColumn(policy, columns, [&](int j) {
+            functor(row[j], value);
+          });
+        } else {
+          matrix_execution::forEachColumn(policy, columns, [&](int j) {
+            functor(row[j], otherRow[j]);
+          });
+        }
+      }
+  });
+}
+
+template <typename T>
+template <typename Policy, typename Functor>
+void Matrix<T>::applyFunctorByRows(const Policy& policy, 
+    const Functor& functor) {
+  INSTRUMENT_OPERATION("applyFunctorByRows", numberOfCells(), 
+                       numberOfCells(), 
+                       2 * sizeof(T) * numberOfCells());
+  markModified();
+  const int columns = this->columns;
+  matrix_execution::forEachRowBlock(policy, rows, columns, 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        T* row = matrix[i].data();
+        functor(i, row, row + columns);
+      }
+  });
 }
 
 template <typename T>
 Matrix<T> Matrix<T>::transpose() const {
-  Matrix resultingMatrix(columns, rows);
-  for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      resultingMatrix.matrix[j][i] = matrix[i][j];
-    }
-  }
-  return resultingMatrix;
+  INSTRUMENT_OPERATION("transpose", numberOfCells(), 0, 
+                       2 * sizeof(T) * numberOfCells());
+  return Matrix(transposedView());
+}
+
+template <typename T>
+TransposedMatrix<T> Matrix<T>::transposedView() const & {
+  return TransposedMatrix<T>(*this);
 }
 
 template <typename T>
 void Matrix<T>::clear() {
+  markModified();
   rows = 0;
   columns = 0;
   matrix.clear();
@@ -422,59 +680,543 @@ Matrix<T> Matrix<T>::identity(int rank, const T& value) {
 
 // Functions
 
+/*
+	The functions and operators combining two matrices cell by cell 
+	broadcast them as NumPy does: each dimension must be the same in both
+	or 1 in one of them, which is then repeated along it. So a 1 x N row
+	is combined with every row of an M x N matrix, an M x 1 column with 
+	every column, and a column with a row gives their M x N outer 
+	combination. The repeated operand is never copied: a broadcast row is
+	read again from the cache for every row and a broadcast column cell 
+	is kept in a register across its row, and every row is a contiguous 
+	loop which the compiler vectorizes.
+	Matrices that cannot be broadcast give an empty result.
+*/
+
+/**
+ * It sets rows and columns to the dimensions of the broadcast of both
+ * matrices, or returns false when they do not broadcast.
+ */
+template <typename A, typename B>
+bool broadcastDimensions(const A& matrix1, const B& matrix2, int& rows, 
+                         int& columns) {
+  const int rows1 = matrix1.getRows(), rows2 = matrix2.getRows();
+  const int columns1 = matrix1.getColumns();
+  const int columns2 = matrix2.getColumns();
+  if ((rows1 != rows2 and rows1 != 1 and rows2 != 1) or 
+      (columns1 != columns2 and columns1 != 1 and columns2 != 1)) {
+    return false;
+  }
+  rows = rows1 == 1 ? rows2 : rows1;
+  columns = columns1 == 1 ? columns2 : columns1;
+  return true;
+}
+
+template <typename A, typename B>
+long long broadcastCells(const A& matrix1, const B& matrix2) {
+  int rows, columns;
+  if (not broadcastDimensions(matrix1, matrix2, rows, columns)) return 0;
+  return 1LL * rows * columns;
+}
+
+/**
+ * It combines one row of the result, spread tells that the row of that
+ * operand is a single cell repeated along it.
+ */
+template <typename Policy, typename T, typename K, typename R, 
+          typename Functor>
+void combineRows(const Policy& policy, const T* row1, bool spread1, 
+                 const K* row2, bool spread2, int columns, 
+                 R* resultingRow, const Functor& functor) {
+  if (spread1) {
+    const T value = row1[0];
+    matrix_execution::forEachColumn(policy, columns, [&](int j) {
+      resultingRow[j] = functor(value, row2[j]);
+    });
+  } else if (spread2) {
+    const K value = row2[0];
+    matrix_execution::forEachColumn(policy, columns, [&](int j) {
+      resultingRow[j] = functor(row1[j], value);
+    });
+  } else {
+    matrix_execution::forEachColumn(policy, columns, [&](int j) {
+      resultingRow[j] = functor(row1[j], row2[j]);
+    });
+  }
+}
+
 template <typename T, typename K, typename Functor>
 auto applyFunctorToMatrices(const Matrix<T>& matrix1, const Matrix<K>& matrix2,
     const Functor& functor) -> Matrix<decltype(functor(T(), K()))> {
-  if (matrix1.hasSameDimensionsAs(matrix2)) {
-    const int rows = matrix1.getRows();
-    const int columns = matrix1.getColumns();
-    Matrix<decltype(functor(T(), K()))> resultingMatrix(rows, columns);
-    for (int i = 0; i < rows; i++) {
-      const auto& row1 = matrix1[i];
-      const auto& row2 = matrix2[i];
-      auto& resultingRow = resultingMatrix[i];
-      for (int j = 0; j < columns; j++) {
-        resultingRow[j] = std::move(functor(row1[j], row2[j]));
-      }
-    }
-    return resultingMatrix;
-  }
-  return {};
+  return applyFunctorToMatrices(matrix_execution::seq, matrix1, matrix2, 
+                                functor);
 }
 
 template <typename T, typename K, typename Functor>
 auto applyFunctorToMatrixAndScalar(const Matrix<T>& matrix, const K& scalar,
     const Functor& functor) -> Matrix<decltype(functor(T(), K()))> {
+  return applyFunctorToMatrixAndScalar(matrix_execution::seq, matrix, scalar,
+                                       functor);
+}
+
+template <typename Policy, typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const Policy& policy, const Matrix<T>& matrix1, 
+    const Matrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  int rows, columns;
+  if (not broadcastDimensions(matrix1, matrix2, rows, columns)) return {};
+  const bool spreadRows1 = matrix1.getRows() != rows;
+  const bool spreadRows2 = matrix2.getRows() != rows;
+  const bool spread1 = matrix1.getColumns() != columns;
+  const bool spread2 = matrix2.getColumns() != columns;
+  Matrix<decltype(functor(T(), K()))> resultingMatrix(rows, columns);
+  matrix_execution::forEachRowBlock(policy, rows, columns, 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        combineRows(policy, matrix1[spreadRows1 ? 0 : i].data(), spread1, 
+                    matrix2[spreadRows2 ? 0 : i].data(), spread2, columns,
+                    resultingMatrix[i].data(), functor);
+      }
+  });
+  return resultingMatrix;
+}
+
+template <typename Policy, typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const Policy& policy, 
+    const Matrix<T>& matrix, const K& scalar, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
   const int rows = matrix.getRows();
   const int columns = matrix.getColumns();
   Matrix<decltype(functor(T(), K()))> resultingMatrix(rows, columns);
-  for (int i = 0; i < rows; i++) {
-    const auto& row = matrix[i];
-    for (int j = 0; j < columns; j++) {
-      resultingMatrix(i, j) = std::move(functor(row[j], scalar));
-    }
+  matrix_execution::forEachRowBlock(policy, rows, columns, 
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        const T* row = matrix[i].data();
+        auto resultingRow = resultingMatrix[i].data();
+        matrix_execution::forEachColumn(policy, columns, [&](int j) {
+          resultingRow[j] = functor(row[j], scalar);
+        });
+      }
+  });
+  return resultingMatrix;
+}
+
+/*
+	The functions taking transposed matrices visit the cells of the
+	result by tiles, see forEachCellByTiles. Operands of different 
+	dimensions are copied into matrices and broadcast as above.
+*/
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const TransposedMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  if (not matrix1.hasSameDimensionsAs(matrix2)) {
+    return applyFunctorToMatrices(Matrix<T>(matrix1), matrix2, functor);
+  }
+  Matrix<decltype(functor(T(), K()))> resultingMatrix(matrix1.getRows(), 
+                                                      matrix1.getColumns());
+  const auto resultingRows = rowPointers(resultingMatrix);
+  forEachCellByTiles(matrix1.getRows(), matrix1.getColumns(), 
+    [&](int i, int j) {
+      resultingRows[i][j] = functor(matrix1(i, j), matrix2(i, j));
+  });
+  return resultingMatrix;
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const Matrix<T>& matrix1, 
+    const TransposedMatrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  if (not matrix1.hasSameDimensionsAs(matrix2)) {
+    return applyFunctorToMatrices(matrix1, Matrix<K>(matrix2), functor);
+  }
+  Matrix<decltype(functor(T(), K()))> resultingMatrix(matrix1.getRows(), 
+                                                      matrix1.getColumns());
+  const auto resultingRows = rowPointers(resultingMatrix);
+  forEachCellByTiles(matrix1.getRows(), matrix1.getColumns(), 
+    [&](int i, int j) {
+      resultingRows[i][j] = functor(matrix1(i, j), matrix2(i, j));
+  });
+  return resultingMatrix;
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const TransposedMatrix<T>& matrix1, 
+    const TransposedMatrix<K>& matrix2, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  if (not matrix1.hasSameDimensionsAs(matrix2)) {
+    return applyFunctorToMatrices(Matrix<T>(matrix1), Matrix<K>(matrix2), 
+                                  functor);
   }
+  Matrix<decltype(functor(T(), K()))> resultingMatrix(matrix1.getRows(), 
+                                                      matrix1.getColumns());
+  const auto resultingRows = rowPointers(resultingMatrix);
+  forEachCellByTiles(matrix1.getRows(), matrix1.getColumns(), 
+    [&](int i, int j) {
+      resultingRows[i][j] = functor(matrix1(i, j), matrix2(i, j));
+  });
   return resultingMatrix;
 }
 
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const TransposedMatrix<T>& matrix, 
+    const K& scalar, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))> {
+  Matrix<decltype(functor(T(), K()))> resultingMatrix(matrix.getRows(), 
+                                                      matrix.getColumns());
+  const auto resultingRows = rowPointers(resultingMatrix);
+  forEachCellByTiles(matrix.getRows(), matrix.getColumns(), 
+    [&](int i, int j) {
+      resultingRows[i][j] = functor(matrix(i, j), scalar);
+  });
+  return resultingMatrix;
+}
+
+/**
+ * It adds row1 times the rows [kk, kEnd) of matrix2 to the columns [jj, jEnd)
+ * of resultingRow, row1 holds the cells kk..kEnd-1 of a row of the left 
+ * operand. The innermost loop walks contiguous rows of matrix2 and of the 
+ * result so the compiler is able to vectorize it.
+ */
+template <typename T, typename K, typename R>
+inline void accumulateRowProduct(const T* row1, const Matrix<K>& matrix2,
+    int kk, int kEnd, int jj, int jEnd, R* resultingRow) {
+  for (int k = kk; k < kEnd; k++) {
+    const T value = row1[k - kk];
+    const K* row2 = matrix2[k].data();
+    for (int j = jj; j < jEnd; j++) {
+      resultingRow[j] += value * row2[j];
+    }
+  }
+}
+
+/**
+ * It adds matrix1 * matrix2 to resultingMatrix, which must already have
+ * matrix1.getRows() rows and matrix2.getColumns() columns.
+ * The loops run in i-k-j order over blocks of matrix2 small enough to stay
+ * in cache.
+ */
+template <typename T, typename K, typename R>
+void accumulateProduct(const Matrix<T>& matrix1, const Matrix<K>& matrix2,
+    Matrix<R>& resultingMatrix) {
+  const int blockDepth = 128;
+  const int blockWidth = 256;
+  const int rows = matrix1.getRows();
+  const int depth = matrix1.getColumns();
+  const int columns = matrix2.getColumns();
+  if (columns == 0) return;
+  for (int jj = 0; jj < columns; jj += blockWidth) {
+    const int jEnd = std::min(jj + blockWidth, columns);
+    for (int kk = 0; kk < depth; kk += blockDepth) {
+      const int kEnd = std::min(kk + blockDepth, depth);
+      for (int i = 0; i < rows; i++) {
+        accumulateRowProduct(matrix1[i].data() + kk, matrix2, kk, kEnd, 
+                             jj, jEnd, &resultingMatrix(i, 0));
+      }
+    }
+  }
+}
+
+/**
+ * It copies the rows [kk, kEnd) of matrix transposed into panel, so the
+ * row i of the panel holds the cells (kk..kEnd-1, i) of matrix.
+ */
+template <typename T>
+void packTransposedPanel(const Matrix<T>& matrix, int kk, int kEnd, 
+                         std::vector<T>& panel) {
+  const int columns = matrix.getColumns();
+  const int panelDepth = kEnd - kk;
+  for (int k = kk; k < kEnd; k++) {
+    const T* row = matrix[k].data();
+    for (int i = 0; i < columns; i++) {
+      panel[static_cast<size_t>(i) * panelDepth + (k - kk)] = row[i];
+    }
+  }
+}
+
+/**
+ * The same as above with a transposed left operand. The columns of the 
+ * original matrix needed by a block of depth are copied first into a 
+ * contiguous panel, one row per row of the product, so the kernel never 
+ * walks the original matrix by columns.
+ */
+template <typename T, typename K, typename R>
+void accumulateProduct(const TransposedMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2, Matrix<R>& resultingMatrix) {
+  const int blockDepth = 128;
+  const int blockWidth = 256;
+  const int rows = matrix1.getRows();
+  const int depth = matrix1.getColumns();
+  const int columns = matrix2.getColumns();
+  if (columns == 0) return;
+  std::vector<T> panel(static_cast<size_t>(rows) * std::min(blockDepth, depth));
+  for (int kk = 0; kk < depth; kk += blockDepth) {
+    const int kEnd = std::min(kk + blockDepth, depth);
+    const int panelDepth = kEnd - kk;
+    packTransposedPanel(matrix1.transpose(), kk, kEnd, panel);
+    for (int jj = 0; jj < columns; jj += blockWidth) {
+      const int jEnd = std::min(jj + blockWidth, columns);
+      for (int i = 0; i < rows; i++) {
+        accumulateRowProduct(&panel[static_cast<size_t>(i) * panelDepth], 
+                             matrix2, kk, kEnd, jj, jEnd, 
+                             &resultingMatrix(i, 0));
+      }
+    }
+  }
+}
+
+/**
+ * It adds the lower triangle of matrix^T * matrix to the rows given by
+ * rowOf(i), a pointer to the cells 0..i of the row i of the product. 
+ * Those cells are contiguous both in a Matrix and in a packed 
+ * SymmetricMatrix, so the same kernel fills both. 
+ * It is the kernel of the transposed product above computing only the 
+ * products of one triangle, half of the work.
+ */
+template <typename T, typename RowOf>
+void accumulateGramProduct(const Matrix<T>& matrix, const RowOf& rowOf) {
+  const int blockDepth = 128;
+  const int blockWidth = 256;
+  const int rank = matrix.getColumns();
+  const int depth = matrix.getRows();
+  std::vector<T> panel(static_cast<size_t>(rank) * std::min(blockDepth, depth));
+  for (int kk = 0; kk < depth; kk += blockDepth) {
+    const int kEnd = std::min(kk + blockDepth, depth);
+    const int panelDepth = kEnd - kk;
+    packTransposedPanel(matrix, kk, kEnd, panel);
+    for (int jj = 0; jj < rank; jj += blockWidth) {
+      for (int i = jj; i < rank; i++) {
+        const int jEnd = std::min(jj + blockWidth, i + 1);
+        accumulateRowProduct(&panel[static_cast<size_t>(i) * panelDepth], 
+                             matrix, kk, kEnd, jj, jEnd, rowOf(i));
+      }
+    }
+  }
+}
+
+/**
+ * It copies the lower triangle of a square matrix into the upper one.
+ */
+template <typename T>
+void mirrorLowerTriangle(Matrix<T>& matrix) {
+  const std::vector<T*> rows = rowPointers(matrix);
+  forEachCellByTiles(matrix.getRows(), matrix.getColumns(), 
+    [&rows](int i, int j) {
+      if (j > i) rows[i][j] = rows[j][i];
+    });
+}
+
+template <typename T, typename K>
+bool isSameMatrix(const Matrix<T>&, const Matrix<K>&) { return false; }
+
+template <typename T>
+bool isSameMatrix(const Matrix<T>& matrix1, const Matrix<T>& matrix2) {
+  return &matrix1 == &matrix2;
+}
+
 template <typename T, typename K>
 auto multiplyMatrices(const Matrix<T>& matrix1, const Matrix<K>& matrix2) 
     -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("multiplyMatrices", 
+      1LL * matrix1.getRows() * matrix2.getColumns(), 
+      2LL * matrix1.getRows() * matrix1.getColumns() * matrix2.getColumns(),
+      sizeof(T) * matrix1.numberOfCells() + sizeof(K) * matrix2.numberOfCells()
+      + sizeof(T() * K()) * matrix1.getRows() * matrix2.getColumns());
   if (matrix1.getColumns() == matrix2.getRows()) {
-    Matrix<decltype(T() + K())> resultingMatrix(matrix1.getRows(), 
+    Matrix<decltype(T() * K())> resultingMatrix(matrix1.getRows(), 
                                                 matrix2.getColumns());
-    for (int i = 0; i < resultingMatrix.getRows(); i++) {
-      for (int j = 0; j < resultingMatrix.getColumns(); j++) {
-        auto sum = decltype(T() * K())();
-        for (int k = 0; k < matrix1.getColumns(); k++) {
-          sum += matrix1(i, k) * matrix2(k, j);
+    accumulateProduct(matrix1, matrix2, resultingMatrix);
+    return resultingMatrix;
+  }
+  return {};
+}
+
+/**
+ * It sets resultingMatrix to matrix1 * matrix2 reusing its storage, it
+ * must already have the dimensions of the product.
+ */
+template <typename T, typename K, typename R>
+void overwriteProduct(const Matrix<T>& matrix1, const Matrix<K>& matrix2,
+                      Matrix<R>& resultingMatrix) {
+  const int columns = resultingMatrix.getColumns();
+  if (columns == 0) return;
+  for (int i = 0; i < resultingMatrix.getRows(); i++) {
+    R* row = &resultingMatrix(i, 0);
+    std::fill(row, row + columns, R());
+  }
+  accumulateProduct(matrix1, matrix2, resultingMatrix);
+}
+
+/**
+ * The number of products of the repeated squaring below: a squaring for
+ * every bit of power below the highest one, and a product by the square
+ * for every one of those bits which is set.
+ */
+inline int repeatedSquaringProducts(int power) {
+  int products = 0;
+  for (; power > 1; power /= 2) {
+    products += 1 + power % 2;
+  }
+  return products;
+}
+
+/**
+ * Matrix power of a square matrix by repeated squaring, about 2 log2(power) 
+ * products. The squares and the partial products take turns between two 
+ * buffers each instead of a new matrix per product.
+ * pow(matrix, 0) is the identity. It returns an empty matrix for non square 
+ * matrices and negative powers.
+ */
+template <typename T>
+Matrix<T> pow(const Matrix<T>& matrix, int power) {
+  INSTRUMENT_OPERATION("pow", matrix.numberOfCells(), 
+      2LL * matrix.numberOfCells() * matrix.getRows() * 
+          repeatedSquaringProducts(power),
+      3 * sizeof(T) * matrix.numberOfCells());
+  const int rank = matrix.getRows();
+  if (rank != matrix.getColumns() or power < 0) return {};
+  if (power == 0) return Matrix<T>::identity(rank, T(1));
+  Matrix<T> square = matrix;
+  Matrix<T> resultingMatrix;
+  Matrix<T> buffer(rank, rank);
+  while (true) {
+    if (power % 2 != 0) {
+      if (resultingMatrix.isEmpty()) {
+        resultingMatrix = square;
+      } else {
+        overwriteProduct(resultingMatrix, square, buffer);
+        std::swap(resultingMatrix, buffer);
+      }
+    }
+    power /= 2;
+    if (power == 0) break;
+    overwriteProduct(square, square, buffer);
+    std::swap(square, buffer);
+  }
+  return resultingMatrix;
+}
+
+/**
+ * With a transposed right operand every cell of the result is the dot
+ * product of two contiguous rows, computed over blocks of both matrices
+ * and with several partial sums to overlap the multiplications.
+ * When lowerTriangle is true only the cells (i, j) with j <= i are 
+ * computed, which is all A * A^T needs.
+ */
+template <typename T, typename K, typename R>
+void accumulateRowProducts(const Matrix<T>& matrix1, 
+    const Matrix<K>& original2, Matrix<R>& resultingMatrix, 
+    bool lowerTriangle) {
+  const int BLOCK = 64;
+  const int blockDepth = 256;
+  const int rows = matrix1.getRows();
+  const int depth = matrix1.getColumns();
+  const int columns = original2.getRows();
+  for (int kk = 0; kk < depth; kk += blockDepth) {
+    const int kEnd = std::min(kk + blockDepth, depth);
+    for (int ii = 0; ii < rows; ii += BLOCK) {
+      const int iEnd = std::min(ii + BLOCK, rows);
+      const int jLimit = lowerTriangle ? std::min(iEnd, columns) : columns;
+      for (int jj = 0; jj < jLimit; jj += BLOCK) {
+        const int jEnd = std::min(jj + BLOCK, jLimit);
+        for (int i = ii; i < iEnd; i++) {
+          const T* row1 = matrix1[i].data();
+          R* resultingRow = &resultingMatrix(i, 0);
+          const int jLast = lowerTriangle ? std::min(jEnd, i + 1) : jEnd;
+          for (int j = jj; j < jLast; j++) {
+            const K* row2 = original2[j].data();
+            R sum0 = R(), sum1 = R(), sum2 = R(), sum3 = R();
+            int k = kk;
+            for (; k + 3 < kEnd; k += 4) {
+              sum0 += row1[k] * row2[k];
+              sum1 += row1[k + 1] * row2[k + 1];
+              sum2 += row1[k + 2] * row2[k + 2];
+              sum3 += row1[k + 3] * row2[k + 3];
+            }
+            for (; k < kEnd; k++) {
+              sum0 += row1[k] * row2[k];
+            }
+            resultingRow[j] += (sum0 + sum1) + (sum2 + sum3);
+          }
         }
-        resultingMatrix(i, j) = std::move(sum);
       }
     }
+  }
+}
+
+template <typename T, typename K, typename R>
+void accumulateProduct(const Matrix<T>& matrix1, 
+    const TransposedMatrix<K>& matrix2, Matrix<R>& resultingMatrix) {
+  accumulateRowProducts(matrix1, matrix2.transpose(), resultingMatrix, false);
+}
+
+/**
+ * A^T * A and A * A^T are symmetric, so when both operands are the same 
+ * matrix only the lower triangle is computed and then mirrored.
+ */
+
+template <typename T, typename K>
+auto multiplyMatrices(const TransposedMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("multiplyMatrices", 
+      1LL * matrix1.getRows() * matrix2.getColumns(), 
+      2LL * matrix1.getRows() * matrix1.getColumns() * matrix2.getColumns(),
+      sizeof(T) * matrix1.numberOfCells() + sizeof(K) * matrix2.numberOfCells()
+      + sizeof(T() * K()) * matrix1.getRows() * matrix2.getColumns());
+  typedef decltype(T() * K()) R;
+  if (matrix1.getColumns() == matrix2.getRows()) {
+    Matrix<R> resultingMatrix(matrix1.getRows(), matrix2.getColumns());
+    if (isSameMatrix(matrix1.transpose(), matrix2)) {
+      accumulateGramProduct(matrix2, 
+        [&resultingMatrix](int i) { return &resultingMatrix(i, 0); });
+      mirrorLowerTriangle(resultingMatrix);
+    } else {
+      accumulateProduct(matrix1, matrix2, resultingMatrix);
+    }
+    return resultingMatrix;
+  }
+  return {};
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix1, 
+    const TransposedMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("multiplyMatrices", 
+      1LL * matrix1.getRows() * matrix2.getColumns(), 
+      2LL * matrix1.getRows() * matrix1.getColumns() * matrix2.getColumns(),
+      sizeof(T) * matrix1.numberOfCells() + sizeof(K) * matrix2.numberOfCells()
+      + sizeof(T() * K()) * matrix1.getRows() * matrix2.getColumns());
+  if (matrix1.getColumns() == matrix2.getRows()) {
+    Matrix<decltype(T() * K())> resultingMatrix(matrix1.getRows(), 
+                                                matrix2.getColumns());
+    const bool symmetric = isSameMatrix(matrix1, matrix2.transpose());
+    accumulateRowProducts(matrix1, matrix2.transpose(), resultingMatrix, 
+                          symmetric);
+    if (symmetric) mirrorLowerTriangle(resultingMatrix);
     return resultingMatrix;
   }
   return {};
 }
 
+/**
+ * A^T * B^T is computed as (B * A)^T.
+ */
+template <typename T, typename K>
+auto multiplyMatrices(const TransposedMatrix<T>& matrix1, 
+    const TransposedMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("multiplyMatrices", 
+      1LL * matrix1.getRows() * matrix2.getColumns(), 
+      2LL * matrix1.getRows() * matrix1.getColumns() * matrix2.getColumns(),
+      sizeof(T) * matrix1.numberOfCells() + sizeof(K) * matrix2.numberOfCells()
+      + sizeof(T() * K()) * matrix1.getRows() * matrix2.getColumns());
+  if (matrix1.getColumns() == matrix2.getRows()) {
+    Matrix<decltype(K() * T())> product(matrix2.getColumns(), 
+                                        matrix1.getRows());
+    accumulateProduct(matrix2.transpose(), matrix1.transpose(), product);
+    return product.transpose();
+  }
+  return {};
+}
+
 #endif // MATRICES_CPP
\ No newline at end of file
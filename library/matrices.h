@@ -28,8 +28,25 @@
 #ifndef MATRICES_H
 #define MATRICES_H
 
+#include <atomic>
 #include <vector>
 #include <ostream>
+#include <type_traits>
+
+#include "parallel.h"
+#include "instrumentation.h"
+
+template <typename T>
+class TransposedMatrix;
+
+/**
+ * It returns a serial number that no matrix has had before, see
+ * Matrix::getSerial.
+ */
+inline unsigned long long nextMatrixSerial() {
+  static std::atomic<unsigned long long> next(1);
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
 
 /**
  * Matrix class
@@ -48,6 +65,8 @@ class Matrix {
 	Matrix(const Matrix<K>& other);
 	template <typename K>
 	Matrix(Matrix<K>&& other);
+	template <typename K>
+	Matrix(const TransposedMatrix<K>& other);
 	~Matrix() { clear(); }
 	
 	bool insertRow(int row, const T& value = T());	
@@ -56,6 +75,14 @@ class Matrix {
 	bool deleteColumn(int column);
   
 	Matrix transpose() const;
+	/*
+		A lazy transpose which only refers to this matrix, see 
+		TransposedMatrix, for the products and operators that read it in 
+		place. It cannot be taken from a temporary, which would not outlive 
+		it.
+	*/
+	TransposedMatrix<T> transposedView() const &;
+	TransposedMatrix<T> transposedView() const && = delete;
 	
 	template <typename K>
 	bool appendHorizontally(const Matrix<K>& other, int column);
@@ -65,6 +92,22 @@ class Matrix {
 	void applyFunctor(const Functor& functor);
   template <typename K, typename Functor>
 	void applyFunctor(const Matrix<K>& other, const Functor& functor);
+	/*
+		The following overloads take an execution policy (see parallel.h)
+		and may call the functor concurrently from several threads.
+		"applyFunctorByRows" calls functor(row, first, last) once per row
+		with the contiguous cells of the row, so the functor can vectorize
+		its own loop.
+	*/
+	template <typename Policy, typename Functor>
+	typename std::enable_if<
+	    matrix_execution::isExecutionPolicy<Policy>::value>::type 
+	applyFunctor(const Policy& policy, const Functor& functor);
+	template <typename Policy, typename K, typename Functor>
+	void applyFunctor(const Policy& policy, const Matrix<K>& other, 
+	                  const Functor& functor);
+	template <typename Policy, typename Functor>
+	void applyFunctorByRows(const Policy& policy, const Functor& functor);
 	
 	void clear();
 	
@@ -72,8 +115,26 @@ class Matrix {
 	int getColumns() const { return columns; }
 	int numberOfCells() const { return rows * columns; }	
 	bool isEmpty() const { return rows == 0; }
-	template <typename K>
-	bool hasSameDimensionsAs(const Matrix<K>& other) const {
+	/*
+		Every matrix has a serial number that no other matrix ever gets and 
+		a version that changes once its cells or dimensions may have changed,
+		through the non const operator() or any mutating member, so both 
+		together tell whether a result computed from the matrix still holds
+		(see ResultCache). A moved matrix keeps them and the moved from one 
+		gets a new serial number. Reading through the non const operator() 
+		counts as a write, so matrices worth caching are read through a const
+		reference.
+		The write is counted when the reference is taken, not when it is 
+		written through: a reference or row pointer kept from before the 
+		version was read goes unseen, so one is taken again after a cached 
+		call before writing. Each call costs an atomic load, so loops over 
+		the cells take a row pointer, &matrix(i, 0), once per row, as the 
+		kernels of the library do.
+	*/
+	unsigned long long getSerial() const { return serial; }
+	unsigned long getVersion() const;
+	template <typename Other>
+	bool hasSameDimensionsAs(const Other& other) const {
 		return rows == other.getRows() and columns == other.getColumns();
 	}
 	
@@ -101,6 +162,11 @@ class Matrix {
 	template <typename K>
 	Matrix& operator-=(const K& subtrahend);
   
+	/*
+		The ones taking a matrix, and applyFunctor with another matrix, 
+		broadcast a 1 x columns row or a rows x 1 column to every row or 
+		column (see applyFunctorToMatrices).
+	*/
 	template <typename K>
 	Matrix& operator*=(const Matrix<K>& other);
 	template <typename K>
@@ -110,19 +176,96 @@ class Matrix {
 	template <typename K>
 	Matrix& operator-=(const Matrix<K>& other);
   
-	T& operator()(int row, int column) { return matrix[row][column]; }
+	template <typename K>
+	Matrix& operator*=(const TransposedMatrix<K>& other);
+	template <typename K>
+	Matrix& operator/=(const TransposedMatrix<K>& other);
+	template <typename K>
+	Matrix& operator+=(const TransposedMatrix<K>& other);
+	template <typename K>
+	Matrix& operator-=(const TransposedMatrix<K>& other);
+  
+	T& operator()(int row, int column) { 
+		markModified();
+		return matrix[row][column]; 
+	}
 	const T& operator()(int row, int column) const { return matrix[row][column]; }
-	const std::vector<T>& operator[](int index) const { return matrix[index]; }
+	// A temporary matrix, such as m.transpose(), is read through this one too
+	const std::vector<T>& operator[](int index) const & { 
+		return matrix[index]; 
+	}
 	
 	static Matrix identity(int rank, const T& value);
  private:
 	std::vector<std::vector<T>> matrix;
 	int rows, columns;
+	unsigned long long serial = nextMatrixSerial();
+	/*
+		Twice the version, plus one while some write is not counted by it 
+		yet. A write only sets the low bit, which costs a load once it is 
+		set, and getVersion folds it into the version.
+	*/
+	mutable std::atomic<unsigned long> state {0};
   
-  std::vector<T>& operator[](int index) { return matrix[index]; }
+  std::vector<T>& operator[](int index) & { 
+    markModified();
+    return matrix[index]; 
+  }
+  void markModified() {
+    if (not (state.load(std::memory_order_relaxed) & 1)) {
+      state.fetch_or(1, std::memory_order_relaxed);
+    }
+  }
   
+  template <typename K> friend class Matrix;
   template <typename E, typename U, typename Functor> friend auto applyFunctorToMatrices(const Matrix<E>&, const Matrix<U>&, 
     const Functor& functor) -> Matrix<decltype(functor(E(), U()))>;
+  template <typename P, typename E, typename U, typename Functor> 
+  friend auto applyFunctorToMatrices(const P&, const Matrix<E>&, 
+    const Matrix<U>&, const Functor& functor) 
+    -> Matrix<decltype(functor(E(), U()))>;
+  template <typename P, typename E, typename U, typename Functor> 
+  friend auto applyFunctorToMatrixAndScalar(const P&, const Matrix<E>&, 
+    const U&, const Functor& functor) -> Matrix<decltype(functor(E(), U()))>;
+  
+  template <typename K, typename Functor>
+  void applyFunctorByTiles(const TransposedMatrix<K>& other, 
+                           const Functor& functor);
+  template <typename Policy, typename K, typename Functor>
+  void broadcastInPlace(const Policy& policy, const Matrix<K>& other, 
+                        const Functor& functor);
+};
+
+/**
+ * TransposedMatrix class
+ * Lazy transpose of a Matrix, as returned by Matrix::transposedView(). 
+ * It only refers to the original matrix, which must outlive it, and the
+ * functions and operators taking it read the original matrix in the 
+ * right order instead of copying it first.
+ * Transposing it again gives back the original matrix for free, and it
+ * becomes a regular Matrix through the Matrix constructor.
+ */
+template <typename T>
+class TransposedMatrix {
+ public:
+  explicit TransposedMatrix(const Matrix<T>& matrix) : matrix (&matrix) {}
+  
+  int getRows() const { return matrix->getColumns(); }
+  int getColumns() const { return matrix->getRows(); }
+  int numberOfCells() const { return matrix->numberOfCells(); }
+  bool isEmpty() const { return getRows() == 0; }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return getRows() == other.getRows() and getColumns() == other.getColumns();
+  }
+  
+  const Matrix<T>& transpose() const { return *matrix; }
+  
+  const T& operator()(int row, int column) const { 
+    return (*matrix)(column, row); 
+  }
+ private:
+  const Matrix<T>* matrix;
 };
 
 // The overloaded arithmetic operators are in the matrices.cpp file
@@ -134,17 +277,83 @@ auto applyFunctorToMatrices(const Matrix<T>&, const Matrix<K>&,
 template <typename T, typename K, typename Functor>
 auto applyFunctorToMatrixAndScalar(const Matrix<T>&, const K&,
     const Functor& functor) -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename Policy, typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const Policy& policy, const Matrix<T>&, 
+    const Matrix<K>&, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename Policy, typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const Policy& policy, const Matrix<T>&, 
+    const K&, const Functor& functor) -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const TransposedMatrix<T>&, const Matrix<K>&, 
+    const Functor& functor) -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const Matrix<T>&, const TransposedMatrix<K>&, 
+    const Functor& functor) -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const TransposedMatrix<T>&, 
+    const TransposedMatrix<K>&, const Functor& functor) 
+    -> Matrix<decltype(functor(T(), K()))>;
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const TransposedMatrix<T>&, const K&,
+    const Functor& functor) -> Matrix<decltype(functor(T(), K()))>;
 	
 template <typename T, typename K>
 auto multiplyMatrices(const Matrix<T>&, const Matrix<K>&) 
 	-> Matrix<decltype(T() * K())>;	
 
+template <typename T, typename K>
+auto multiplyMatrices(const TransposedMatrix<T>&, const Matrix<K>&) 
+	-> Matrix<decltype(T() * K())>;
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>&, const TransposedMatrix<K>&) 
+	-> Matrix<decltype(T() * K())>;
+
+template <typename T, typename K>
+auto multiplyMatrices(const TransposedMatrix<T>&, const TransposedMatrix<K>&) 
+	-> Matrix<decltype(T() * K())>;
+
+template <typename T>
+Matrix<T> pow(const Matrix<T>&, int power);
+
+template <typename T, typename K, typename R>
+void accumulateProduct(const Matrix<T>&, const Matrix<K>&, Matrix<R>&);
+
+template <typename T, typename K, typename R>
+void accumulateProduct(const TransposedMatrix<T>&, const Matrix<K>&, 
+                       Matrix<R>&);
+
+template <typename T, typename K, typename R>
+void accumulateProduct(const Matrix<T>&, const TransposedMatrix<K>&, 
+                       Matrix<R>&);
+
 
 #include "matrices.cpp"
 #include "matrix_operators.h"
+#include "complex_matrices.h"
+#include "structured_matrices.h"
+#include "decompositions.h"
+#include "factorization_updates.h"
+#include "tiled_matrices.h"
+#include "task_graph.h"
+#include "shared_matrices.h"
+#include "column_major_matrices.h"
+#include "small_matrices.h"
+#include "window_matrices.h"
+#include "result_cache.h"
+#include "numa.h"
+#include "elementwise_functions.h"
 
 using dMatrix = Matrix<double>;
 using fMatrix = Matrix<float>;
 using iMatrix = Matrix<int>;
+using dSharedMatrix = SharedMatrix<double>;
 
 #endif // MATRICES_H
\ No newline at end of file
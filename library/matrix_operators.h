@@ -47,8 +47,8 @@ std::ostream& operator<<(std::ostream& outputStream, const Matrix<T>& matrix) {
 	The following operators apply the corresponding binary 
 	operation of the corresponding elements of the two matrices given 
 	or one matrix and a scalar value and returns a new matrix.
-    If the matrices have not the same dimensions, 
-	the matrix returned will be empty.
+	Matrices of different dimensions are broadcast as NumPy does (see 
+	applyFunctorToMatrices), otherwise the matrix returned will be empty.
 	The function "applyFunctorToMatrices" have the same meaning but
 	using a binary functor instead and operator.
 */
@@ -56,54 +56,61 @@ std::ostream& operator<<(std::ostream& outputStream, const Matrix<T>& matrix) {
 template <typename T, typename K>
 inline auto operator*(const Matrix<T>& matrix1, const Matrix<K>& matrix2) 
     -> Matrix<decltype(T() * K())> {
-  if (matrix1.hasSameDimensionsAs(matrix2)) {
-    return applyFunctorToMatrices(matrix1, matrix2, 
-      [](const T& x, const K& y) {
-        return x * y;
-    });
-  }
-  return {};
+  INSTRUMENT_OPERATION("operator*", broadcastCells(matrix1, matrix2), 
+      broadcastCells(matrix1, matrix2), 
+      (sizeof(T) + sizeof(K) + sizeof(T() * K())) * 
+      broadcastCells(matrix1, matrix2));
+  return applyFunctorToMatrices(matrix1, matrix2, 
+    [](const T& x, const K& y) {
+      return x * y;
+  });
 }
 
 template <typename T, typename K>
 inline auto operator/(const Matrix<T>& matrix1, const Matrix<K>& matrix2) 
     -> Matrix<decltype(T() / K())> {
-  if (matrix1.hasSameDimensionsAs(matrix2)) {
-    return applyFunctorToMatrices(matrix1, matrix2, 
-      [](const T& x, const K& y) {
-        return x / y;
-    });
-  }
-  return {};
+  INSTRUMENT_OPERATION("operator/", broadcastCells(matrix1, matrix2), 
+      broadcastCells(matrix1, matrix2), 
+      (sizeof(T) + sizeof(K) + sizeof(T() / K())) * 
+      broadcastCells(matrix1, matrix2));
+  return applyFunctorToMatrices(matrix1, matrix2, 
+    [](const T& x, const K& y) {
+      return x / y;
+  });
 }
 
 template <typename T, typename K>
 inline auto operator+(const Matrix<T>& matrix1, const Matrix<K>& matrix2) 
     -> Matrix<decltype(T() + K())> {
-  if (matrix1.hasSameDimensionsAs(matrix2)) {
-    return applyFunctorToMatrices(matrix1, matrix2, 
-      [](const T& x, const K& y) {
-        return x + y;
-    });
-  }
-  return {};
+  INSTRUMENT_OPERATION("operator+", broadcastCells(matrix1, matrix2), 
+      broadcastCells(matrix1, matrix2), 
+      (sizeof(T) + sizeof(K) + sizeof(T() + K())) * 
+      broadcastCells(matrix1, matrix2));
+  return applyFunctorToMatrices(matrix1, matrix2, 
+    [](const T& x, const K& y) {
+      return x + y;
+  });
 }
 
 template <typename T, typename K>
 inline auto operator-(const Matrix<T>& matrix1, const Matrix<K>& matrix2) 
     -> Matrix<decltype(T() - K())> {
-  if (matrix1.hasSameDimensionsAs(matrix2)) {
-    return applyFunctorToMatrices(matrix1, matrix2, 
-      [](const T& x, const K& y) {
-        return x - y;
-    });
-  }
-  return {};
+  INSTRUMENT_OPERATION("operator-", broadcastCells(matrix1, matrix2), 
+      broadcastCells(matrix1, matrix2), 
+      (sizeof(T) + sizeof(K) + sizeof(T() - K())) * 
+      broadcastCells(matrix1, matrix2));
+  return applyFunctorToMatrices(matrix1, matrix2, 
+    [](const T& x, const K& y) {
+      return x - y;
+  });
 }
 
 template <typename T, typename K>
 inline auto operator*(const Matrix<T>& matrix, const K& value) 
 	  -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("operator*", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() * K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x * y;
@@ -113,6 +120,9 @@ inline auto operator*(const Matrix<T>& matrix, const K& value)
 template <typename T, typename K>
 inline auto operator*(const K& value, const Matrix<T>& matrix) 
     -> Matrix<decltype(T() * K())> {
+  INSTRUMENT_OPERATION("operator*", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() * K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x * y;
@@ -122,6 +132,9 @@ inline auto operator*(const K& value, const Matrix<T>& matrix)
 template <typename T, typename K>
 inline auto operator/(const Matrix<T>& matrix, const K& value) 
 	  -> Matrix<decltype(T() / K())> {
+  INSTRUMENT_OPERATION("operator/", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() / K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x / y;
@@ -131,6 +144,9 @@ inline auto operator/(const Matrix<T>& matrix, const K& value)
 template <typename T, typename K>
 inline auto operator/(const K& value, const Matrix<T>& matrix) 
     -> Matrix<decltype(K() / T())> {
+  INSTRUMENT_OPERATION("operator/", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(K() / T())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return y / x;
@@ -140,6 +156,9 @@ inline auto operator/(const K& value, const Matrix<T>& matrix)
 template <typename T, typename K>
 inline auto operator+(const Matrix<T>& matrix, const K& value) 
     -> Matrix<decltype(T() + K())> {
+  INSTRUMENT_OPERATION("operator+", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() + K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x + y;
@@ -149,6 +168,9 @@ inline auto operator+(const Matrix<T>& matrix, const K& value)
 template <typename T, typename K>
 inline auto operator+(const K& value, const Matrix<T>& matrix)      
     -> Matrix<decltype(T() + K())> {
+  INSTRUMENT_OPERATION("operator+", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() + K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x + y;
@@ -158,6 +180,9 @@ inline auto operator+(const K& value, const Matrix<T>& matrix)
 template <typename T, typename K>
 inline auto operator-(const Matrix<T>& matrix, const K& value) 
     -> Matrix<decltype(T() - K())> {
+  INSTRUMENT_OPERATION("operator-", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(T() - K())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return x - y;
@@ -167,10 +192,101 @@ inline auto operator-(const Matrix<T>& matrix, const K& value)
 template <typename T, typename K>
 inline auto operator-(const K& value, const Matrix<T>& matrix) 
     -> Matrix<decltype(K() - T())> {
+  INSTRUMENT_OPERATION("operator-", matrix.numberOfCells(), 
+      matrix.numberOfCells(), 
+      (sizeof(T) + sizeof(K() - T())) * matrix.numberOfCells());
   return applyFunctorToMatrixAndScalar(matrix, value, 
     [](const T& x, const K& y) {
       return y - x;
   });
 }
 
+template <typename T>
+std::ostream& operator<<(std::ostream& outputStream, 
+    const TransposedMatrix<T>& matrix) {
+  const int rows = matrix.getRows();
+  const int columns = matrix.getColumns();
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      outputStream << matrix(i, j);
+      if (j < columns - 1) outputStream << ',';
+      outputStream << ' ';
+    }
+    outputStream << '\n';
+  }
+  return outputStream;
+}
+
+/*
+	The same operators taking lazy transposes (see TransposedMatrix), 
+	which are read in place instead of being copied into a Matrix first,
+	unless they are broadcast.
+*/
+
+#define TRANSPOSED_MATRIX_OPERATOR(OP)                                      \
+template <typename T, typename K>                                           \
+inline auto operator OP(const TransposedMatrix<T>& matrix1,                 \
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {             \
+  INSTRUMENT_OPERATION("operator" #OP, broadcastCells(matrix1, matrix2),    \
+      broadcastCells(matrix1, matrix2),                                     \
+      3 * sizeof(T) * broadcastCells(matrix1, matrix2));                    \
+  return applyFunctorToMatrices(matrix1, matrix2,                           \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const Matrix<T>& matrix1,                           \
+    const TransposedMatrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {   \
+  INSTRUMENT_OPERATION("operator" #OP, broadcastCells(matrix1, matrix2),    \
+      broadcastCells(matrix1, matrix2),                                     \
+      3 * sizeof(T) * broadcastCells(matrix1, matrix2));                    \
+  return applyFunctorToMatrices(matrix1, matrix2,                           \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const TransposedMatrix<T>& matrix1,                 \
+    const TransposedMatrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {   \
+  INSTRUMENT_OPERATION("operator" #OP, broadcastCells(matrix1, matrix2),    \
+      broadcastCells(matrix1, matrix2),                                     \
+      3 * sizeof(T) * broadcastCells(matrix1, matrix2));                    \
+  return applyFunctorToMatrices(matrix1, matrix2,                           \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const TransposedMatrix<T>& matrix, const K& value)  \
+    -> Matrix<decltype(T() OP K())> {                                       \
+  INSTRUMENT_OPERATION("operator" #OP, matrix.numberOfCells(),              \
+      matrix.numberOfCells(), 2 * sizeof(T) * matrix.numberOfCells());      \
+  return applyFunctorToMatrixAndScalar(matrix, value,                       \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const K& value, const TransposedMatrix<T>& matrix)  \
+    -> Matrix<decltype(K() OP T())> {                                       \
+  INSTRUMENT_OPERATION("operator" #OP, matrix.numberOfCells(),              \
+      matrix.numberOfCells(), 2 * sizeof(T) * matrix.numberOfCells());      \
+  return applyFunctorToMatrixAndScalar(matrix, value,                       \
+    [](const T& x, const K& y) {                                            \
+      return y OP x;                                                        \
+  });                                                                       \
+}
+
+TRANSPOSED_MATRIX_OPERATOR(*)
+TRANSPOSED_MATRIX_OPERATOR(/)
+TRANSPOSED_MATRIX_OPERATOR(+)
+TRANSPOSED_MATRIX_OPERATOR(-)
+
+#undef TRANSPOSED_MATRIX_OPERATOR
+
 #endif // MATRIX_OPERATORS_H
\ No newline at end of file
@@ -0,0 +1,380 @@
+/*
+  @file numa.h NUMA placement of matrices and of the thread pool
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+	NUMA placement of matrices and of the workers of the thread pool. It 
+	goes through the system calls of Linux, so there is nothing to link.
+	Elsewhere, or where the calls are refused (as in some containers), 
+	there is a single node and the functions do nothing, returning false
+	where they would have moved memory or threads.
+	
+	  numa::topology()               the nodes and their processors, from
+	                                 /sys/devices/system/node
+	  numa::pinThreadPool()          it pins the workers evenly to the 
+	                                 nodes and makes parallelFor give each 
+	                                 node a contiguous part of every range
+	  numa::place(m, placement)      it moves the pages of a matrix:
+	                                   RowBlocks    the rows of the part of
+	                                                each node to that node
+	                                   Interleaved  round robin over nodes
+	  numa::placeOnNode(m, node)     every page of m to one node
+	  numa::makeMatrix(r, c, v, p)   a matrix allocated with a placement
+	  numa::nodesOfRows(m)           the node of the first cell of each 
+	                                 row, -1 when unknown
+	
+	Once the pool is pinned, Matrix(rows, columns, value) already places 
+	by RowBlocks, its rows are first touched by the threads that process 
+	them in the elementwise kernels and the decompositions. Interleaving 
+	suits matrices that every node reads whole, such as the right operand
+	of a product.
+	Placement works on whole pages, so rows smaller than a page share them
+	with their neighbours and go where the last of them sends them.
+*/
+
+namespace numa {
+
+// Nodes addressed by the masks given to the system calls
+const int MAX_NODES = 1024;
+
+enum class Placement { RowBlocks, Interleaved };
+
+struct Topology {
+  // The online nodes and the processors of each one
+  std::vector<int> nodes;
+  std::vector<std::vector<int>> cpus;
+  // The nodes with processors, the domains of a pinned pool in order
+  std::vector<int> computeNodes;
+  
+  int nodeOfCpu(int cpu) const {
+    for (size_t i = 0; i < nodes.size(); i++) {
+      if (std::find(cpus[i].begin(), cpus[i].end(), cpu) != cpus[i].end()) {
+        return nodes[i];
+      }
+    }
+    return -1;
+  }
+};
+
+/**
+ * It parses lists as the kernel writes them, such as "0-3,8,10-11".
+ */
+inline std::vector<int> parseList(const std::string& list) {
+  std::vector<int> values;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    const size_t dash = range.find('-');
+    try {
+      const int first = std::stoi(range.substr(0, dash));
+      const int last = dash == std::string::npos 
+                       ? first : std::stoi(range.substr(dash + 1));
+      for (int value = first; value <= last; value++) {
+        values.push_back(value);
+      }
+    } catch (...) {
+      break;
+    }
+  }
+  return values;
+}
+
+inline std::string readLine(const std::string& path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+inline Topology readTopology() {
+  const std::string root = "/sys/devices/system/node/";
+  Topology topology;
+  for (int node : parseList(readLine(root + "online"))) {
+    if (node < 0 or node >= MAX_NODES) continue;
+    topology.nodes.push_back(node);
+    topology.cpus.push_back(parseList(
+        readLine(root + "node" + std::to_string(node) + "/cpulist")));
+    if (not topology.cpus.back().empty()) {
+      topology.computeNodes.push_back(node);
+    }
+  }
+  if (topology.computeNodes.empty()) {
+    const int processors = std::max(1u, std::thread::hardware_concurrency());
+    topology.nodes.assign(1, 0);
+    topology.cpus.assign(1, std::vector<int>());
+    for (int cpu = 0; cpu < processors; cpu++) {
+      topology.cpus[0].push_back(cpu);
+    }
+    topology.computeNodes.assign(1, 0);
+  }
+  return topology;
+}
+
+inline const Topology& topology() {
+  static const Topology topology = readTopology();
+  return topology;
+}
+
+inline int nodeCount() { return topology().nodes.size(); }
+
+#ifdef __linux__
+
+const int POLICY_DEFAULT = 0;
+const int POLICY_PREFERRED = 1;
+const int POLICY_INTERLEAVE = 3;
+const unsigned MOVE_PAGES = 1 << 1;
+const unsigned long QUERY_NODE_OF_ADDRESS = 1 | 1 << 1;
+
+typedef std::vector<unsigned long> NodeMask;
+
+inline NodeMask nodeMask(const std::vector<int>& nodes) {
+  const int bits = CHAR_BIT * sizeof(unsigned long);
+  NodeMask mask(MAX_NODES / bits, 0);
+  for (int node : nodes) {
+    mask[node / bits] |= 1UL << (node % bits);
+  }
+  return mask;
+}
+
+/**
+ * It gives the pages holding [first, last) the policy and moves the ones
+ * that do not follow it.
+ */
+inline bool bindPages(const void* first, const void* last, int policy, 
+                      const NodeMask& mask) {
+  if (first == last) return true;
+  const unsigned long page = sysconf(_SC_PAGESIZE);
+  const unsigned long begin = reinterpret_cast<unsigned long>(first) 
+                              & ~(page - 1);
+  const unsigned long end = (reinterpret_cast<unsigned long>(last) + 
+                             page - 1) & ~(page - 1);
+  return syscall(SYS_mbind, begin, end - begin, policy, mask.data(), 
+                 MAX_NODES, MOVE_PAGES) == 0;
+}
+
+inline int nodeOfAddress(const void* address) {
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, 
+              QUERY_NODE_OF_ADDRESS) != 0) {
+    return -1;
+  }
+  return node;
+}
+
+inline bool setThreadPolicy(int policy, const NodeMask& mask) {
+  return syscall(SYS_set_mempolicy, policy, 
+                 policy == POLICY_DEFAULT ? nullptr : mask.data(), 
+                 policy == POLICY_DEFAULT ? 0 : MAX_NODES) == 0;
+}
+
+inline bool pinThread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+inline int currentCpu() { return sched_getcpu(); }
+
+#else
+
+const int POLICY_DEFAULT = 0;
+const int POLICY_PREFERRED = 1;
+const int POLICY_INTERLEAVE = 3;
+
+typedef std::vector<unsigned long> NodeMask;
+
+inline NodeMask nodeMask(const std::vector<int>&) { return NodeMask(); }
+inline bool bindPages(const void*, const void*, int, const NodeMask&) {
+  return false;
+}
+inline int nodeOfAddress(const void*) { return -1; }
+inline bool setThreadPolicy(int, const NodeMask&) { return false; }
+inline bool pinThread(const std::vector<int>&) { return false; }
+inline int currentCpu() { return -1; }
+
+#endif
+
+/**
+ * The domain of the calling thread in a pinned pool, the position of its
+ * node among the nodes with processors.
+ */
+inline int currentDomain() {
+  const std::vector<int>& computeNodes = topology().computeNodes;
+  const int node = topology().nodeOfCpu(currentCpu());
+  const auto found = std::find(computeNodes.begin(), computeNodes.end(), 
+                               node);
+  return found == computeNodes.end() ? 0 : found - computeNodes.begin();
+}
+
+/**
+ * It pins the workers of the pool to the nodes with processors, the same
+ * number to each one as far as possible, and groups them by node so that
+ * parallelFor splits its ranges into one part per node. The calling 
+ * thread is not pinned, it works on the part of the node it runs on.
+ */
+inline bool pinThreadPool() {
+  const Topology& topology = numa::topology();
+  ThreadPool& pool = ThreadPool::instance();
+  const int nodes = topology.computeNodes.size();
+  const int workers = pool.size() - 1;
+  std::vector<int> domains(pool.size(), 0);
+  std::atomic<bool> pinned(true);
+  pool.forEachThread([&](int thread) {
+    if (thread == 0) return;
+    const int domain = (thread - 1) * nodes / workers;
+    domains[thread] = domain;
+    const auto node = std::find(topology.nodes.begin(), topology.nodes.end(),
+                                topology.computeNodes[domain]);
+    if (not pinThread(topology.cpus[node - topology.nodes.begin()])) {
+      pinned = false;
+    }
+  });
+  pool.setThreadDomains(domains, &currentDomain);
+  return pinned;
+}
+
+/**
+ * It lets the workers run anywhere again and removes their domains.
+ */
+inline bool unpinThreadPool() {
+  std::vector<int> cpus;
+  for (const std::vector<int>& nodeCpus : topology().cpus) {
+    cpus.insert(cpus.end(), nodeCpus.begin(), nodeCpus.end());
+  }
+  std::atomic<bool> unpinned(true);
+  ThreadPool& pool = ThreadPool::instance();
+  pool.forEachThread([&](int thread) {
+    if (thread != 0 and not pinThread(cpus)) unpinned = false;
+  });
+  pool.setThreadDomains(std::vector<int>(), nullptr);
+  return unpinned;
+}
+
+/**
+ * It moves the rows [first, last) of matrix to the nodes of mask.
+ */
+template <typename T>
+bool placeRows(const Matrix<T>& matrix, int first, int last, int policy, 
+               const NodeMask& mask) {
+  const int columns = matrix.getColumns();
+  bool placed = true;
+  for (int i = first; i < last; i++) {
+    const T* row = matrix[i].data();
+    placed = bindPages(row, row + columns, policy, mask) and placed;
+  }
+  return placed;
+}
+
+/**
+ * It moves the pages of matrix as placement says, its cells and version
+ * stay the same. RowBlocks splits the rows as a pinned pool does, one 
+ * contiguous part per node with processors.
+ */
+template <typename T>
+bool place(const Matrix<T>& matrix, Placement placement) {
+  const Topology& topology = numa::topology();
+  const int rows = matrix.getRows();
+  if (placement == Placement::Interleaved) {
+    return placeRows(matrix, 0, rows, POLICY_INTERLEAVE, 
+                     nodeMask(topology.nodes));
+  }
+  const int parts = topology.computeNodes.size();
+  bool placed = true;
+  for (int part = 0; part < parts; part++) {
+    placed = placeRows(matrix, partitionBoundary(0, rows, part, parts),
+                       partitionBoundary(0, rows, part + 1, parts), 
+                       POLICY_PREFERRED, 
+                       nodeMask({topology.computeNodes[part]})) and placed;
+  }
+  return placed;
+}
+
+template <typename T>
+bool placeOnNode(const Matrix<T>& matrix, int node) {
+  if (node < 0 or node >= MAX_NODES) return false;
+  return placeRows(matrix, 0, matrix.getRows(), POLICY_PREFERRED, 
+                   nodeMask({node}));
+}
+
+/**
+ * A new matrix whose pages follow placement from the start. RowBlocks 
+ * relies on the first touch of a pinned pool and moves only the rows 
+ * that another node's threads touched. Interleaved sets the policy of 
+ * every thread of the pool while the rows are allocated.
+ */
+template <typename T>
+Matrix<T> makeMatrix(int rows, int columns, const T& value, 
+                     Placement placement) {
+  if (placement == Placement::RowBlocks) {
+    Matrix<T> matrix(rows, columns, value);
+    place(matrix, placement);
+    return matrix;
+  }
+  const NodeMask mask = nodeMask(topology().nodes);
+  ThreadPool& pool = ThreadPool::instance();
+  pool.forEachThread([&](int) { setThreadPolicy(POLICY_INTERLEAVE, mask); });
+  Matrix<T> matrix(rows, columns, value);
+  pool.forEachThread([&](int) { setThreadPolicy(POLICY_DEFAULT, mask); });
+  return matrix;
+}
+
+/**
+ * The node holding the first cell of every row, -1 for empty rows or 
+ * when it cannot be told.
+ */
+template <typename T>
+std::vector<int> nodesOfRows(const Matrix<T>& matrix) {
+  std::vector<int> nodes(matrix.getRows(), -1);
+  if (matrix.getColumns() == 0) return nodes;
+  for (int i = 0; i < matrix.getRows(); i++) {
+    nodes[i] = nodeOfAddress(matrix[i].data());
+  }
+  return nodes;
+}
+
+} // namespace numa
+
+#endif // NUMA_H
@@ -0,0 +1,413 @@
+/*
+  @file parallel.h Thread pool used by the parallel kernels of the library
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Below this number of cells the kernels of the library run serially,
+ * waking up the pool costs more than the work itself.
+ */
+const int PARALLEL_THRESHOLD = 1 << 15;
+
+/**
+ * It returns where part of parts equal contiguous parts of [begin, end)
+ * starts, part == parts gives end.
+ */
+inline int partitionBoundary(int begin, int end, int part, int parts) {
+  return begin + static_cast<int>(static_cast<long long>(end - begin) * 
+                                  part / parts);
+}
+
+/**
+ * ThreadPool class
+ * A fixed set of worker threads, created the first time that it is used,
+ * which run the chunks of a range in parallel together with the calling 
+ * thread. Every worker takes part in every job, so a job is finished
+ * once all of them have run out of chunks.
+ * A parallelFor called from inside another one runs serially in the 
+ * calling thread, so functors are free to call parallel kernels.
+ * If a functor throws, the chunks not yet started are skipped, the job
+ * is waited for and the first exception is rethrown in the calling 
+ * thread.
+ * 
+ * The threads may be grouped in domains, such as the NUMA nodes they are
+ * pinned to (see numa.h). Then a range is split into one contiguous part
+ * per domain, as partitionBoundary does, and every thread takes the 
+ * chunks of the part of its domain before helping with the others, so 
+ * the same rows of a matrix go to the same domain in every job.
+ */
+class ThreadPool {
+ public:
+  static ThreadPool& instance() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+  }
+  ~ThreadPool();
+  
+  int size() const { return workers.size() + 1; }
+  
+  /*
+    It calls functor(first, last) over consecutive chunks of [begin, end)
+    with at least grainSize indices each and waits for all of them.
+  */
+  template <typename Functor>
+  void parallelFor(int begin, int end, int grainSize, const Functor& functor);
+  /*
+    It calls functor(thread) once in every thread of the pool, thread 0 
+    being the calling thread and 1... the workers.
+  */
+  template <typename Functor>
+  void forEachThread(const Functor& functor);
+  /*
+    domains[thread] is the domain of each worker thread, domains[0] is 
+    ignored, and callerDomain tells the domain of the calling thread when
+    a job starts. Domains are numbered from 0, an empty vector removes 
+    them.
+  */
+  void setThreadDomains(const std::vector<int>& domains, 
+                        int (*callerDomain)());
+  // Readable from any thread, while a job runs too
+  int domainCount() const { 
+    return domainParts.load(std::memory_order_relaxed); 
+  }
+ private:
+  explicit ThreadPool(int threads);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  
+  void workerLoop(int index);
+  void runChunks();
+  void startJob(const std::function<void(int, int)>& wrapper);
+  
+  static bool& insideParallelRegion() {
+    static thread_local bool inside = false;
+    return inside;
+  }
+  static int& threadIndex() {
+    static thread_local int index = 0;
+    return index;
+  }
+  
+  std::vector<std::thread> workers;
+  std::mutex jobMutex;
+  std::mutex stateMutex;
+  std::condition_variable jobReady;
+  std::condition_variable jobDone;
+  const std::function<void(int, int)>* task;
+  bool perThread;
+  int chunkSize;
+  // One part of the range per domain, a single one without domains
+  int parts;
+  std::atomic<int> domainParts;
+  std::unique_ptr<std::atomic<int>[]> nextIndex;
+  std::vector<int> partEnd;
+  std::vector<int> threadDomains;
+  int (*callerDomain)();
+  int jobCallerDomain;
+  std::atomic<bool> cancelled;
+  std::exception_ptr jobException;
+  int pendingWorkers;
+  unsigned long generation;
+  bool stopping;
+};
+
+inline ThreadPool::ThreadPool(int threads) 
+    : task (nullptr), perThread (false), chunkSize (1), parts (1), 
+      domainParts (1), nextIndex (new std::atomic<int>[1]), partEnd (1, 0), 
+      callerDomain (nullptr), jobCallerDomain (0), cancelled (false), 
+      pendingWorkers (0), 
+      generation (0), stopping (false) {
+  for (int i = 1; i < threads; i++) {
+    workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    stopping = true;
+  }
+  jobReady.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+inline void ThreadPool::runChunks() {
+  const int index = threadIndex();
+  try {
+    if (perThread) {
+      (*task)(index, index + 1);
+      return;
+    }
+    const int own = parts == 1 ? 0 
+                    : index == 0 ? jobCallerDomain : threadDomains[index];
+    for (int p = 0; p < parts; p++) {
+      const int part = (own + p) % parts;
+      std::atomic<int>& next = nextIndex[part];
+      const int end = partEnd[part];
+      for (int first = next.fetch_add(chunkSize); 
+           first < end and not cancelled.load(std::memory_order_relaxed); 
+           first = next.fetch_add(chunkSize)) {
+        (*task)(first, std::min(first + chunkSize, end));
+      }
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (not jobException) jobException = std::current_exception();
+    cancelled = true;
+  }
+}
+
+inline void ThreadPool::workerLoop(int index) {
+  insideParallelRegion() = true;
+  threadIndex() = index;
+  unsigned long seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(stateMutex);
+      jobReady.wait(lock, [&] { 
+        return stopping or generation != seenGeneration; 
+      });
+      if (stopping) return;
+      seenGeneration = generation;
+    }
+    runChunks();
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      last = --pendingWorkers == 0;
+    }
+    if (last) jobDone.notify_all();
+  }
+}
+
+/**
+ * It runs the job set up by the caller, which holds jobMutex, in every 
+ * thread, waits for all of them and rethrows the first exception thrown
+ * by the task, if any.
+ */
+inline void ThreadPool::startJob(
+    const std::function<void(int, int)>& wrapper) {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    task = &wrapper;
+    cancelled = false;
+    pendingWorkers = workers.size();
+    generation++;
+  }
+  jobReady.notify_all();
+  insideParallelRegion() = true;
+  runChunks();
+  insideParallelRegion() = false;
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobDone.wait(lock, [&] { return pendingWorkers == 0; });
+    task = nullptr;
+    std::swap(exception, jobException);
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+template <typename Functor>
+void ThreadPool::parallelFor(int begin, int end, int grainSize, 
+    const Functor& functor) {
+  if (begin >= end) return;
+  grainSize = std::max(1, grainSize);
+  if (workers.empty() or end - begin <= grainSize or insideParallelRegion()) {
+    functor(begin, end);
+    return;
+  }
+  std::lock_guard<std::mutex> jobLock(jobMutex);
+  const std::function<void(int, int)> wrapper = functor;
+  const int chunks = std::min(size() * 4, (end - begin) / grainSize);
+  perThread = false;
+  chunkSize = (end - begin + chunks - 1) / chunks;
+  for (int part = 0; part < parts; part++) {
+    nextIndex[part] = partitionBoundary(begin, end, part, parts);
+    partEnd[part] = partitionBoundary(begin, end, part + 1, parts);
+  }
+  if (parts > 1) {
+    jobCallerDomain = std::min(std::max(0, callerDomain()), parts - 1);
+  }
+  startJob(wrapper);
+}
+
+template <typename Functor>
+void ThreadPool::forEachThread(const Functor& functor) {
+  if (workers.empty() or insideParallelRegion()) {
+    functor(0);
+    return;
+  }
+  std::lock_guard<std::mutex> jobLock(jobMutex);
+  const std::function<void(int, int)> wrapper = [&](int thread, int) { 
+    functor(thread); 
+  };
+  perThread = true;
+  startJob(wrapper);
+}
+
+inline void ThreadPool::setThreadDomains(const std::vector<int>& domains, 
+    int (*callerDomain)()) {
+  std::lock_guard<std::mutex> jobLock(jobMutex);
+  int count = 1;
+  if (callerDomain and static_cast<int>(domains.size()) == size()) {
+    for (int thread = 1; thread < size(); thread++) {
+      count = std::max(count, domains[thread] + 1);
+    }
+  }
+  parts = count;
+  domainParts.store(count, std::memory_order_relaxed);
+  threadDomains = count > 1 ? domains : std::vector<int>();
+  this->callerDomain = callerDomain;
+  nextIndex.reset(new std::atomic<int>[count]);
+  partEnd.assign(count, 0);
+}
+
+template <typename Functor>
+inline void parallelFor(int begin, int end, int grainSize, 
+    const Functor& functor) {
+  ThreadPool::instance().parallelFor(begin, end, grainSize, functor);
+}
+
+/**
+ * It returns how many rows of the given width a chunk needs so that
+ * it holds at least the given number of cells.
+ */
+inline int rowsPerChunk(int columns, int cells = PARALLEL_THRESHOLD) {
+  return std::max(1, cells / std::max(1, columns));
+}
+
+/**
+ * It marks the next loop as free of dependencies between iterations.
+ */
+#if defined(__clang__)
+#define UNSEQUENCED_LOOP _Pragma("clang loop vectorize(enable)")
+#elif defined(__GNUC__)
+#define UNSEQUENCED_LOOP _Pragma("GCC ivdep")
+#else
+#define UNSEQUENCED_LOOP
+#endif
+
+/*
+	Execution policies taken by the applyFunctor family.
+	  seq: the functor is called in order in the calling thread.
+	  par: the rows are split into chunks which run in the thread pool,
+	       so the functor may be called concurrently.
+	  par_unseq: like par, and besides the calls inside a row may be 
+	       interleaved, so the compiler is told to vectorize the loop.
+	The parallel policies take a grain size hint, the minimum number of 
+	cells given to a chunk, e.g. matrix_execution::par.withGrainSize(4096) for
+	functors expensive enough to pay off with smaller chunks.
+*/
+
+namespace matrix_execution {
+
+struct SequencedPolicy {};
+
+template <bool Unsequenced>
+struct ParallelPolicyBase {
+  int grainSize;
+  ParallelPolicyBase withGrainSize(int cells) const { 
+    return ParallelPolicyBase{cells}; 
+  }
+};
+
+typedef ParallelPolicyBase<false> ParallelPolicy;
+typedef ParallelPolicyBase<true> ParallelUnsequencedPolicy;
+
+const SequencedPolicy seq = SequencedPolicy();
+const ParallelPolicy par = ParallelPolicy{PARALLEL_THRESHOLD};
+const ParallelUnsequencedPolicy par_unseq = 
+    ParallelUnsequencedPolicy{PARALLEL_THRESHOLD};
+
+template <typename T> struct isExecutionPolicy : std::false_type {};
+template <> struct isExecutionPolicy<SequencedPolicy> : std::true_type {};
+template <bool Unsequenced> 
+struct isExecutionPolicy<ParallelPolicyBase<Unsequenced>> 
+    : std::true_type {};
+
+/**
+ * It calls functor(first, last) over the row ranges of a matrix with
+ * the given number of rows and columns, as the policy says.
+ */
+template <typename Functor>
+void forEachRowBlock(const SequencedPolicy&, int rows, int, 
+    const Functor& functor) {
+  if (rows > 0) functor(0, rows);
+}
+
+template <bool Unsequenced, typename Functor>
+void forEachRowBlock(const ParallelPolicyBase<Unsequenced>& policy, 
+    int rows, int columns, const Functor& functor) {
+  parallelFor(0, rows, rowsPerChunk(columns, policy.grainSize), functor);
+}
+
+/**
+ * It calls functor(j) for each column of a row, as the policy says.
+ */
+template <typename Functor>
+inline void forEachColumn(const SequencedPolicy&, int columns, 
+    const Functor& functor) {
+  for (int j = 0; j < columns; j++) {
+    functor(j);
+  }
+}
+
+template <typename Functor>
+inline void forEachColumn(const ParallelPolicy&, int columns, 
+    const Functor& functor) {
+  for (int j = 0; j < columns; j++) {
+    functor(j);
+  }
+}
+
+template <typename Functor>
+inline void forEachColumn(const ParallelUnsequencedPolicy&, int columns, 
+    const Functor& functor) {
+  UNSEQUENCED_LOOP
+  for (int j = 0; j < columns; j++) {
+    functor(j);
+  }
+}
+
+} // namespace matrix_execution
+
+#endif // PARALLEL_H
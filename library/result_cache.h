@@ -0,0 +1,300 @@
+/*
+  @file result_cache.h Cache of results of operations on unchanged matrices
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Memory that a ResultCache may hold by default, in bytes.
+ */
+const size_t RESULT_CACHE_BUDGET = size_t(256) << 20;
+
+/*
+	The memory taken by a cached result, as the cache accounts it. Types 
+	without an overload here count as their size alone.
+*/
+
+template <typename R>
+size_t resultBytes(const R&) { return sizeof(R); }
+
+template <typename T>
+size_t resultBytes(const Matrix<T>& matrix) {
+  return sizeof(Matrix<T>) + matrix.getRows() * sizeof(std::vector<T>) + 
+         matrix.numberOfCells() * sizeof(T);
+}
+
+template <typename T>
+size_t resultBytes(const CholeskyFactorization<T>& cholesky) {
+  const size_t rank = cholesky.getRows();
+  return sizeof(cholesky) + rank * (rank + 1) / 2 * sizeof(T);
+}
+
+template <typename T>
+size_t resultBytes(const Eigensystem<T>& eigensystem) {
+  return resultBytes(eigensystem.vectors) + 
+         eigensystem.values.size() * sizeof(T);
+}
+
+template <typename T>
+size_t resultBytes(const SingularSystem<T>& singular) {
+  return resultBytes(singular.u) + resultBytes(singular.v) + 
+         singular.values.size() * sizeof(T);
+}
+
+/**
+ * ResultCache class
+ * Results of operations on matrices, kept while their operands do not 
+ * change: the key of a result is the operation, the type of the result 
+ * and the serial number and version of every operand (see 
+ * Matrix::getVersion), so writing to an operand makes its old results 
+ * unreachable and the next call computes them again. A hit costs a hash
+ * lookup whatever the operation. Writes through a reference into an 
+ * operand taken before the call are not seen, see Matrix::getVersion.
+ * 
+ * The results are shared and immutable, and stay valid after they are 
+ * evicted. The cache holds at most memoryBudget bytes of them and evicts
+ * the least recently used ones first; results that are no longer 
+ * reachable leave that way too. A result larger than the whole budget is
+ * returned without being cached.
+ * 
+ * It is opt-in: only calls through a ResultCache are cached, and they 
+ * may come from several threads. A miss computes outside the lock, so 
+ * concurrent misses on the same key may compute the result twice, and 
+ * the first one stored is kept.
+ */
+class ResultCache {
+ public:
+  explicit ResultCache(size_t memoryBudget = RESULT_CACHE_BUDGET)
+      : memoryBudget (memoryBudget), memoryUsage (0), hits (0), misses (0) {}
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+  
+  /*
+  	It returns computation(operands...) from the cache, or computes and 
+  	caches it. The operation names the computation, including any other
+  	parameter it takes.
+  */
+  template <typename Result, typename Computation, typename... Operands>
+  std::shared_ptr<const Result> compute(const std::string& operation, 
+      const Computation& computation, const Matrix<Operands>&... operands);
+  
+  template <typename T, typename K>
+  std::shared_ptr<const Matrix<decltype(T() * K())>> multiplyMatrices(
+      const Matrix<T>& matrix1, const Matrix<K>& matrix2) {
+    typedef Matrix<decltype(T() * K())> Result;
+    return compute<Result>("multiplyMatrices", 
+        [](const Matrix<T>& m1, const Matrix<K>& m2) {
+          return ::multiplyMatrices(m1, m2);
+        }, matrix1, matrix2);
+  }
+  template <typename T>
+  std::shared_ptr<const Matrix<T>> transpose(const Matrix<T>& matrix) {
+    return compute<Matrix<T>>("transpose", [](const Matrix<T>& m) {
+      return m.transpose();
+    }, matrix);
+  }
+  template <typename T>
+  std::shared_ptr<const Matrix<T>> inverse(const Matrix<T>& matrix) {
+    return compute<Matrix<T>>("inverse", [](const Matrix<T>& m) {
+      return ::inverse(m);
+    }, matrix);
+  }
+  // The symmetric matrix is read from the lower triangle of matrix
+  template <typename T>
+  std::shared_ptr<const CholeskyFactorization<T>> choleskyFactorization(
+      const Matrix<T>& matrix) {
+    return compute<CholeskyFactorization<T>>("choleskyFactorization", 
+        [](const Matrix<T>& m) {
+          return CholeskyFactorization<T>(SymmetricMatrix<T>(m));
+        }, matrix);
+  }
+  template <typename T>
+  std::shared_ptr<const Eigensystem<T>> symmetricEigendecomposition(
+      const Matrix<T>& matrix, int count = -1) {
+    return compute<Eigensystem<T>>(
+        "symmetricEigendecomposition " + std::to_string(count), 
+        [count](const Matrix<T>& m) {
+          return ::symmetricEigendecomposition(m, count);
+        }, matrix);
+  }
+  template <typename T>
+  std::shared_ptr<const SingularSystem<T>> singularValueDecomposition(
+      const Matrix<T>& matrix, int count = -1) {
+    return compute<SingularSystem<T>>(
+        "singularValueDecomposition " + std::to_string(count), 
+        [count](const Matrix<T>& m) {
+          return ::singularValueDecomposition(m, count);
+        }, matrix);
+  }
+  
+  void clear();
+  size_t getMemoryBudget() const { return memoryBudget; }
+  size_t getMemoryUsage() const;
+  size_t size() const;
+  unsigned long getHits() const;
+  unsigned long getMisses() const;
+ private:
+  struct Key {
+    std::string operation;
+    std::type_index result;
+    std::vector<unsigned long long> operands;
+    
+    bool operator==(const Key& other) const {
+      return operation == other.operation and result == other.result and 
+             operands == other.operands;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t hash = std::hash<std::string>()(key.operation) ^ 
+                    key.result.hash_code();
+      for (unsigned long long operand : key.operands) {
+        hash = hash * 1000003 ^ std::hash<unsigned long long>()(operand);
+      }
+      return hash;
+    }
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<const void> result;
+    size_t bytes;
+  };
+  typedef std::list<Entry> EntryList;
+  
+  const size_t memoryBudget;
+  mutable std::mutex mutex;
+  // The most recently used entry first
+  EntryList entries;
+  std::unordered_map<Key, EntryList::iterator, KeyHash> index;
+  size_t memoryUsage;
+  unsigned long hits, misses;
+  
+  static void addOperands(std::vector<unsigned long long>&) {}
+  template <typename T, typename... Rest>
+  static void addOperands(std::vector<unsigned long long>& operands, 
+      const Matrix<T>& matrix, const Matrix<Rest>&... rest) {
+    operands.push_back(matrix.getSerial());
+    operands.push_back(matrix.getVersion());
+    addOperands(operands, rest...);
+  }
+  std::shared_ptr<const void> find(const Key& key);
+  std::shared_ptr<const void> insert(Key&& key, 
+      std::shared_ptr<const void> result, size_t bytes);
+};
+
+/**
+ * It returns the result under key and makes it the most recently used, 
+ * or null.
+ */
+inline std::shared_ptr<const void> ResultCache::find(const Key& key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto found = index.find(key);
+  if (found == index.end()) {
+    misses++;
+    return nullptr;
+  }
+  hits++;
+  entries.splice(entries.begin(), entries, found->second);
+  return found->second->result;
+}
+
+/**
+ * It stores result under key unless another thread stored one first, 
+ * evicts least recently used results until the budget holds, and returns
+ * the stored result.
+ */
+inline std::shared_ptr<const void> ResultCache::insert(Key&& key, 
+    std::shared_ptr<const void> result, size_t bytes) {
+  if (bytes > memoryBudget) return result;
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto found = index.find(key);
+  if (found != index.end()) return found->second->result;
+  while (memoryUsage + bytes > memoryBudget) {
+    memoryUsage -= entries.back().bytes;
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+  entries.push_front(Entry{key, result, bytes});
+  index.emplace(std::move(key), entries.begin());
+  memoryUsage += bytes;
+  return result;
+}
+
+template <typename Result, typename Computation, typename... Operands>
+std::shared_ptr<const Result> ResultCache::compute(
+    const std::string& operation, const Computation& computation, 
+    const Matrix<Operands>&... operands) {
+  Key key{operation, std::type_index(typeid(Result)), {}};
+  key.operands.reserve(2 * sizeof...(Operands));
+  addOperands(key.operands, operands...);
+  std::shared_ptr<const void> cached = find(key);
+  if (not cached) {
+    const std::shared_ptr<const Result> result = 
+        std::make_shared<const Result>(computation(operands...));
+    cached = insert(std::move(key), result, resultBytes(*result));
+  }
+  return std::static_pointer_cast<const Result>(cached);
+}
+
+inline void ResultCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  index.clear();
+  memoryUsage = 0;
+}
+
+inline size_t ResultCache::getMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return memoryUsage;
+}
+
+inline size_t ResultCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+inline unsigned long ResultCache::getHits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return hits;
+}
+
+inline unsigned long ResultCache::getMisses() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return misses;
+}
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,212 @@
+/*
+  @file shared_matrices.h Copy-on-write matrices
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef SHARED_MATRICES_H
+#define SHARED_MATRICES_H
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+
+/**
+ * SharedMatrix class
+ * Matrix with copy-on-write storage: copies share one reference counted
+ * Matrix, so copying is O(1) whatever the size, and the cells are only 
+ * copied by the first write through a copy while the storage is shared.
+ * 
+ * Reading goes through the const members or read(), which gives the 
+ * Matrix itself to pass to any function of the library. Writing goes 
+ * through the non const operator(), the mutating members or write(); 
+ * a reference obtained from them must not be kept past the next copy of
+ * this SharedMatrix, since it would write through the copy as well.
+ * 
+ * The counts are atomic, so copies may be used and destroyed from any
+ * thread, each one from one thread at a time as with any object.
+ */
+template <typename T>
+class SharedMatrix {
+ public:
+  SharedMatrix() : storage (std::make_shared<Matrix<T>>()) {}
+  SharedMatrix(int rows, int columns, const T& value = T())
+      : storage (std::make_shared<Matrix<T>>(rows, columns, value)) {}
+  SharedMatrix(std::initializer_list<std::initializer_list<T>> il)
+      : storage (std::make_shared<Matrix<T>>(il)) {}
+  SharedMatrix(const Matrix<T>& matrix)
+      : storage (std::make_shared<Matrix<T>>(matrix)) {}
+  SharedMatrix(Matrix<T>&& matrix)
+      : storage (std::make_shared<Matrix<T>>(std::move(matrix))) {}
+  
+  int getRows() const { return storage->getRows(); }
+  int getColumns() const { return storage->getColumns(); }
+  int numberOfCells() const { return storage->numberOfCells(); }
+  bool isEmpty() const { return storage->isEmpty(); }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return storage->hasSameDimensionsAs(other);
+  }
+  bool isShared() const { return storage.use_count() > 1; }
+  
+  const Matrix<T>& read() const { return *storage; }
+  Matrix<T>& write() {
+    detach();
+    return *storage;
+  }
+  Matrix<T> toMatrix() const { return *storage; }
+  
+  const T& operator()(int row, int column) const { 
+    return (*storage)(row, column); 
+  }
+  T& operator()(int row, int column) { return write()(row, column); }
+  const std::vector<T>& operator[](int index) const { 
+    return read()[index]; 
+  }
+  
+  bool insertRow(int row, const T& value = T()) {
+    return write().insertRow(row, value);
+  }
+  bool insertColumn(int column, const T& value = T()) {
+    return write().insertColumn(column, value);
+  }
+  bool deleteRow(int row) { return write().deleteRow(row); }
+  bool deleteColumn(int column) { return write().deleteColumn(column); }
+  template <typename Functor>
+  void applyFunctor(const Functor& functor) { write().applyFunctor(functor); }
+  void clear() { storage = std::make_shared<Matrix<T>>(); }
+  
+  template <typename K>
+  SharedMatrix& operator*=(const K& other) {
+    write() *= other;
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator*=(const SharedMatrix<K>& other) {
+    write() *= other.read();
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator/=(const K& other) {
+    write() /= other;
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator/=(const SharedMatrix<K>& other) {
+    write() /= other.read();
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator+=(const K& other) {
+    write() += other;
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator+=(const SharedMatrix<K>& other) {
+    write() += other.read();
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator-=(const K& other) {
+    write() -= other;
+    return *this;
+  }
+  template <typename K>
+  SharedMatrix& operator-=(const SharedMatrix<K>& other) {
+    write() -= other.read();
+    return *this;
+  }
+  
+  SharedMatrix operator+() const { return *this; }
+  SharedMatrix operator-() const { return SharedMatrix(-*storage); }
+ private:
+  std::shared_ptr<Matrix<T>> storage;
+  
+  /*
+  	The count is read relaxed, so a count of one is followed by an acquire
+  	fence which pairs with the release of the last other reference, and 
+  	the writes that follow cannot race with its reads.
+  */
+  void detach() {
+    if (storage.use_count() > 1) {
+      storage = std::make_shared<Matrix<T>>(*storage);
+    } else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+  }
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& outputStream, 
+                         const SharedMatrix<T>& matrix) {
+  return outputStream << matrix.read();
+}
+
+/*
+	The arithmetic operators of Matrix (see matrix_operators.h) over the
+	storage of shared matrices. The result of two shared matrices, or of 
+	one and a scalar, is a new SharedMatrix, and that of a shared matrix 
+	and a Matrix is a Matrix, which converts to either one by moving it.
+*/
+
+#define SHARED_MATRIX_OPERATOR(OP)                                          \
+template <typename T, typename K>                                           \
+inline auto operator OP(const SharedMatrix<T>& matrix1,                     \
+    const SharedMatrix<K>& matrix2) -> SharedMatrix<decltype(T() OP K())> { \
+  return SharedMatrix<decltype(T() OP K())>(                                \
+      matrix1.read() OP matrix2.read());                                    \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const SharedMatrix<T>& matrix1,                     \
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {             \
+  return matrix1.read() OP matrix2;                                         \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const Matrix<T>& matrix1,                           \
+    const SharedMatrix<K>& matrix2) -> Matrix<decltype(T() OP K())> {       \
+  return matrix1 OP matrix2.read();                                         \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const SharedMatrix<T>& matrix, const K& value)      \
+    -> SharedMatrix<decltype(T() OP K())> {                                 \
+  return SharedMatrix<decltype(T() OP K())>(matrix.read() OP value);        \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const K& value, const SharedMatrix<T>& matrix)      \
+    -> SharedMatrix<decltype(K() OP T())> {                                 \
+  return SharedMatrix<decltype(K() OP T())>(value OP matrix.read());        \
+}
+
+SHARED_MATRIX_OPERATOR(*)
+SHARED_MATRIX_OPERATOR(/)
+SHARED_MATRIX_OPERATOR(+)
+SHARED_MATRIX_OPERATOR(-)
+
+#undef SHARED_MATRIX_OPERATOR
+
+#endif // SHARED_MATRICES_H
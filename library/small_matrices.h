@@ -0,0 +1,496 @@
+/*
+  @file small_matrices.h Matrices with inline storage for a few cells
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef SMALL_MATRICES_H
+#define SMALL_MATRICES_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <ostream>
+
+/*
+	Cells kept inside a SmallMatrix by default, enough for a 4x4 block.
+*/
+const int SMALL_MATRIX_CELLS = 16;
+
+/**
+ * SmallMatrix class
+ * Matrix whose size is only known at runtime but usually tiny, e.g. the
+ * 1xN rows of an initializer list or 2x2 and 3x3 blocks. Up to N cells
+ * are stored inside the object, so creating, copying and editing it does
+ * not allocate, and a bigger one spills to a single heap block, which 
+ * grows geometrically as rows and columns are inserted.
+ * The cells are contiguous by rows, operator[] gives a pointer to a row.
+ * The edits follow the ones of Matrix: an invalid position or dimension
+ * returns false and leaves the matrix as it was.
+ */
+template <typename T, int N = SMALL_MATRIX_CELLS>
+class SmallMatrix {
+  static_assert(N > 0, "A SmallMatrix needs room for at least one cell");
+ public:
+  SmallMatrix() : rows (0), columns (0), capacity (N) {}
+  SmallMatrix(int rows, int columns, const T& value = T());
+  SmallMatrix(std::initializer_list<std::initializer_list<T>> il);
+  SmallMatrix(std::initializer_list<T> il);
+  explicit SmallMatrix(const Matrix<T>& matrix);
+  SmallMatrix(const SmallMatrix& other);
+  SmallMatrix(SmallMatrix&& other);
+  
+  SmallMatrix& operator=(const SmallMatrix& other);
+  SmallMatrix& operator=(SmallMatrix&& other);
+  
+  int getRows() const { return rows; }
+  int getColumns() const { return columns; }
+  int numberOfCells() const { return rows * columns; }
+  bool isEmpty() const { return rows == 0; }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return rows == other.getRows() and columns == other.getColumns();
+  }
+  bool isInline() const { return not heap; }
+  
+  T& operator()(int row, int column) { return data()[row * columns + column]; }
+  const T& operator()(int row, int column) const { 
+    return data()[row * columns + column]; 
+  }
+  T* operator[](int row) { return data() + row * columns; }
+  const T* operator[](int row) const { return data() + row * columns; }
+  
+  bool insertRow(int row, const T& value = T());
+  bool insertColumn(int column, const T& value = T());
+  bool deleteRow(int row);
+  bool deleteColumn(int column);
+  template <int M>
+  bool appendHorizontally(const SmallMatrix<T, M>& other, int column);
+  template <int M>
+  bool appendVertically(const SmallMatrix<T, M>& other, int row);
+  template <typename Functor>
+  void applyFunctor(const Functor& functor);
+  void clear() { rows = columns = 0; }
+  
+  SmallMatrix transpose() const;
+  Matrix<T> toMatrix() const;
+  
+  template <typename K>
+  SmallMatrix& operator*=(const K& multiplier);
+  template <typename K>
+  SmallMatrix& operator/=(const K& divisor);
+  template <typename K>
+  SmallMatrix& operator+=(const K& adding);
+  template <typename K>
+  SmallMatrix& operator-=(const K& subtrahend);
+  template <typename K, int M>
+  SmallMatrix& operator+=(const SmallMatrix<K, M>& other);
+  template <typename K, int M>
+  SmallMatrix& operator-=(const SmallMatrix<K, M>& other);
+ private:
+  T buffer[N];
+  std::unique_ptr<T[]> heap;
+  int rows, columns, capacity;
+  
+  T* data() { return heap ? heap.get() : buffer; }
+  const T* data() const { return heap ? heap.get() : buffer; }
+  void reserve(int cells);
+  void insertColumns(int column, int count, const T* source, 
+                     int sourceColumns, const T& value);
+};
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(int rows, int columns, const T& value) 
+    : rows (0), columns (0), capacity (N) {
+  reserve(rows * columns);
+  this->rows = rows;
+  this->columns = columns;
+  std::fill(data(), data() + rows * columns, value);
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(
+    std::initializer_list<std::initializer_list<T>> il) 
+    : rows (0), columns (0), capacity (N) {
+  const int width = il.size() == 0 ? 0 : il.begin()->size();
+  reserve(il.size() * width);
+  T* cell = data();
+  for (const std::initializer_list<T>& row : il) {
+    cell = std::copy(row.begin(), row.begin() + std::min<int>(row.size(), 
+                     width), cell);
+    cell = std::fill_n(cell, width - std::min<int>(row.size(), width), T());
+  }
+  rows = il.size();
+  columns = width;
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(std::initializer_list<T> il) 
+    : rows (0), columns (0), capacity (N) {
+  reserve(il.size());
+  std::copy(il.begin(), il.end(), data());
+  rows = 1;
+  columns = il.size();
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(const Matrix<T>& matrix) 
+    : rows (0), columns (0), capacity (N) {
+  reserve(matrix.numberOfCells());
+  rows = matrix.getRows();
+  columns = matrix.getColumns();
+  for (int i = 0; i < rows; i++) {
+    std::copy(matrix[i].begin(), matrix[i].end(), (*this)[i]);
+  }
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(const SmallMatrix& other) 
+    : rows (0), columns (0), capacity (N) {
+  reserve(other.numberOfCells());
+  std::copy(other.data(), other.data() + other.numberOfCells(), data());
+  rows = other.rows;
+  columns = other.columns;
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>::SmallMatrix(SmallMatrix&& other) 
+    : rows (other.rows), columns (other.columns), capacity (N) {
+  if (other.heap) {
+    heap = std::move(other.heap);
+    capacity = other.capacity;
+    other.capacity = N;
+  } else {
+    std::move(other.buffer, other.buffer + numberOfCells(), buffer);
+  }
+  other.rows = other.columns = 0;
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>& SmallMatrix<T, N>::operator=(const SmallMatrix& other) {
+  if (this != &other) {
+    rows = columns = 0;
+    reserve(other.numberOfCells());
+    std::copy(other.data(), other.data() + other.numberOfCells(), data());
+    rows = other.rows;
+    columns = other.columns;
+  }
+  return *this;
+}
+
+template <typename T, int N>
+SmallMatrix<T, N>& SmallMatrix<T, N>::operator=(SmallMatrix&& other) {
+  if (this != &other) {
+    if (other.heap) {
+      heap = std::move(other.heap);
+      capacity = other.capacity;
+      other.capacity = N;
+    } else {
+      std::move(other.buffer, other.buffer + other.numberOfCells(), data());
+    }
+    rows = other.rows;
+    columns = other.columns;
+    other.rows = other.columns = 0;
+  }
+  return *this;
+}
+
+/**
+ * It makes room for the given number of cells keeping the current ones,
+ * at least doubling the heap block when it has to grow.
+ */
+template <typename T, int N>
+void SmallMatrix<T, N>::reserve(int cells) {
+  if (cells <= capacity) return;
+  const int newCapacity = std::max(cells, 2 * capacity);
+  std::unique_ptr<T[]> block(new T[newCapacity]);
+  std::move(data(), data() + numberOfCells(), block.get());
+  heap = std::move(block);
+  capacity = newCapacity;
+}
+
+template <typename T, int N>
+bool SmallMatrix<T, N>::insertRow(int row, const T& value) {
+  if (row < 0 or row > rows) return false;
+  reserve((rows + 1) * columns);
+  T* cells = data();
+  std::move_backward(cells + row * columns, cells + rows * columns, 
+                     cells + (rows + 1) * columns);
+  std::fill_n(cells + row * columns, columns, value);
+  rows++;
+  return true;
+}
+
+template <typename T, int N>
+bool SmallMatrix<T, N>::deleteRow(int row) {
+  if (row < 0 or row >= rows) return false;
+  T* cells = data();
+  std::move(cells + (row + 1) * columns, cells + rows * columns, 
+            cells + row * columns);
+  rows--;
+  return true;
+}
+
+/**
+ * It opens count columns at column, filled from the rows of source or 
+ * with value when it is null. The cells only move forward, so they are 
+ * moved in place from the last one.
+ */
+template <typename T, int N>
+void SmallMatrix<T, N>::insertColumns(int column, int count, 
+    const T* source, int sourceColumns, const T& value) {
+  const int width = columns + count;
+  reserve(rows * width);
+  T* cells = data();
+  for (int i = rows - 1; i >= 0; i--) {
+    T* oldRow = cells + i * columns;
+    T* newRow = cells + i * width;
+    std::move_backward(oldRow + column, oldRow + columns, newRow + width);
+    std::move_backward(oldRow, oldRow + column, newRow + column);
+    if (source) {
+      std::copy(source + i * sourceColumns, 
+                source + i * sourceColumns + count, newRow + column);
+    } else {
+      std::fill_n(newRow + column, count, value);
+    }
+  }
+  columns = width;
+}
+
+template <typename T, int N>
+bool SmallMatrix<T, N>::insertColumn(int column, const T& value) {
+  if (column < 0 or column > columns) return false;
+  insertColumns(column, 1, nullptr, 0, value);
+  return true;
+}
+
+template <typename T, int N>
+bool SmallMatrix<T, N>::deleteColumn(int column) {
+  if (column < 0 or column >= columns) return false;
+  T* cells = data();
+  const int width = columns - 1;
+  for (int i = 0; i < rows; i++) {
+    T* oldRow = cells + i * columns;
+    T* newRow = cells + i * width;
+    std::move(oldRow, oldRow + column, newRow);
+    std::move(oldRow + column + 1, oldRow + columns, newRow + column);
+  }
+  columns = width;
+  return true;
+}
+
+template <typename T, int N>
+template <int M>
+bool SmallMatrix<T, N>::appendHorizontally(const SmallMatrix<T, M>& other, 
+                                           int column) {
+  if (column < 0 or column > columns or rows != other.getRows()) return false;
+  if (static_cast<const void*>(&other) == this) {
+    return appendHorizontally(SmallMatrix<T, M>(other), column);
+  }
+  insertColumns(column, other.getColumns(), other[0], other.getColumns(), 
+                T());
+  return true;
+}
+
+template <typename T, int N>
+template <int M>
+bool SmallMatrix<T, N>::appendVertically(const SmallMatrix<T, M>& other, 
+                                         int row) {
+  if (row < 0 or row > rows or columns != other.getColumns()) return false;
+  if (static_cast<const void*>(&other) == this) {
+    return appendVertically(SmallMatrix<T, M>(other), row);
+  }
+  const int count = other.getRows();
+  reserve((rows + count) * columns);
+  T* cells = data();
+  std::move_backward(cells + row * columns, cells + rows * columns, 
+                     cells + (rows + count) * columns);
+  std::copy(other[0], other[0] + count * columns, cells + row * columns);
+  rows += count;
+  return true;
+}
+
+template <typename T, int N>
+template <typename Functor>
+void SmallMatrix<T, N>::applyFunctor(const Functor& functor) {
+  T* cells = data();
+  for (int k = 0; k < numberOfCells(); k++) {
+    cells[k] = functor(cells[k]);
+  }
+}
+
+template <typename T, int N>
+SmallMatrix<T, N> SmallMatrix<T, N>::transpose() const {
+  SmallMatrix resultingMatrix(columns, rows);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      resultingMatrix(j, i) = (*this)(i, j);
+    }
+  }
+  return resultingMatrix;
+}
+
+template <typename T, int N>
+Matrix<T> SmallMatrix<T, N>::toMatrix() const {
+  Matrix<T> resultingMatrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    std::copy((*this)[i], (*this)[i] + columns, &resultingMatrix(i, 0));
+  }
+  return resultingMatrix;
+}
+
+#define SMALL_MATRIX_COMPOUND_OPERATOR(OP)                                  \
+template <typename T, int N>                                                \
+template <typename K>                                                       \
+SmallMatrix<T, N>& SmallMatrix<T, N>::operator OP##=(const K& value) {      \
+  T* cells = data();                                                        \
+  for (int k = 0; k < numberOfCells(); k++) {                               \
+    cells[k] OP##= value;                                                   \
+  }                                                                         \
+  return *this;                                                             \
+}
+
+SMALL_MATRIX_COMPOUND_OPERATOR(*)
+SMALL_MATRIX_COMPOUND_OPERATOR(/)
+SMALL_MATRIX_COMPOUND_OPERATOR(+)
+SMALL_MATRIX_COMPOUND_OPERATOR(-)
+
+#undef SMALL_MATRIX_COMPOUND_OPERATOR
+
+template <typename T, int N>
+template <typename K, int M>
+SmallMatrix<T, N>& SmallMatrix<T, N>::operator+=(
+    const SmallMatrix<K, M>& other) {
+  if (hasSameDimensionsAs(other)) {
+    T* cells = data();
+    for (int k = 0; k < numberOfCells(); k++) {
+      cells[k] += other[0][k];
+    }
+  }
+  return *this;
+}
+
+template <typename T, int N>
+template <typename K, int M>
+SmallMatrix<T, N>& SmallMatrix<T, N>::operator-=(
+    const SmallMatrix<K, M>& other) {
+  if (hasSameDimensionsAs(other)) {
+    T* cells = data();
+    for (int k = 0; k < numberOfCells(); k++) {
+      cells[k] -= other[0][k];
+    }
+  }
+  return *this;
+}
+
+/*
+	The elementwise operators of matrix_operators.h, mismatched dimensions
+	give an empty matrix.
+*/
+
+#define SMALL_MATRIX_OPERATOR(OP)                                           \
+template <typename T, int N, typename K, int M>                             \
+auto operator OP(const SmallMatrix<T, N>& matrix1,                          \
+                 const SmallMatrix<K, M>& matrix2)                          \
+    -> SmallMatrix<decltype(T() OP K()), N> {                               \
+  if (not matrix1.hasSameDimensionsAs(matrix2)) return {};                  \
+  SmallMatrix<decltype(T() OP K()), N> resultingMatrix(matrix1.getRows(),   \
+                                                       matrix1.getColumns());\
+  for (int k = 0; k < matrix1.numberOfCells(); k++) {                       \
+    resultingMatrix[0][k] = matrix1[0][k] OP matrix2[0][k];                 \
+  }                                                                         \
+  return resultingMatrix;                                                   \
+}                                                                           \
+                                                                            \
+template <typename T, int N, typename K>                                    \
+auto operator OP(const SmallMatrix<T, N>& matrix, const K& value)           \
+    -> SmallMatrix<decltype(T() OP K()), N> {                               \
+  SmallMatrix<decltype(T() OP K()), N> resultingMatrix(matrix.getRows(),    \
+                                                       matrix.getColumns());\
+  for (int k = 0; k < matrix.numberOfCells(); k++) {                        \
+    resultingMatrix[0][k] = matrix[0][k] OP value;                          \
+  }                                                                         \
+  return resultingMatrix;                                                   \
+}                                                                           \
+                                                                            \
+template <typename T, int N, typename K>                                    \
+auto operator OP(const K& value, const SmallMatrix<T, N>& matrix)           \
+    -> SmallMatrix<decltype(K() OP T()), N> {                               \
+  SmallMatrix<decltype(K() OP T()), N> resultingMatrix(matrix.getRows(),    \
+                                                       matrix.getColumns());\
+  for (int k = 0; k < matrix.numberOfCells(); k++) {                        \
+    resultingMatrix[0][k] = value OP matrix[0][k];                          \
+  }                                                                         \
+  return resultingMatrix;                                                   \
+}
+
+SMALL_MATRIX_OPERATOR(*)
+SMALL_MATRIX_OPERATOR(/)
+SMALL_MATRIX_OPERATOR(+)
+SMALL_MATRIX_OPERATOR(-)
+
+#undef SMALL_MATRIX_OPERATOR
+
+/**
+ * The plain triple loop, at these sizes the blocked kernel of Matrix 
+ * only adds overhead.
+ */
+template <typename T, int N, typename K, int M>
+auto multiplyMatrices(const SmallMatrix<T, N>& matrix1, 
+                      const SmallMatrix<K, M>& matrix2) 
+    -> SmallMatrix<decltype(T() * K()), N> {
+  typedef decltype(T() * K()) R;
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  const int rows = matrix1.getRows();
+  const int inner = matrix1.getColumns();
+  const int columns = matrix2.getColumns();
+  SmallMatrix<R, N> resultingMatrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    R* resultingRow = resultingMatrix[i];
+    for (int k = 0; k < inner; k++) {
+      const T factor = matrix1(i, k);
+      const K* row2 = matrix2[k];
+      for (int j = 0; j < columns; j++) {
+        resultingRow[j] += factor * row2[j];
+      }
+    }
+  }
+  return resultingMatrix;
+}
+
+template <typename T, int N>
+std::ostream& operator<<(std::ostream& outputStream, 
+                         const SmallMatrix<T, N>& matrix) {
+  for (int i = 0; i < matrix.getRows(); i++) {
+    for (int j = 0; j < matrix.getColumns(); j++) {
+      outputStream << matrix(i, j);
+      if (j < matrix.getColumns() - 1) outputStream << ',';
+      outputStream << ' ';
+    }
+    outputStream << '\n';
+  }
+  return outputStream;
+}
+
+#endif // SMALL_MATRICES_H
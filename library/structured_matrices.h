@@ -0,0 +1,607 @@
+/*
+  @file structured_matrices.h Packed symmetric, triangular and banded matrices
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef STRUCTURED_MATRICES_H
+#define STRUCTURED_MATRICES_H
+
+#include <cmath>
+
+/*
+	Packed storage for square matrices with a known structure, only the
+	cells not implied by it are kept:
+	
+	SymmetricMatrix    the lower triangle by rows, n(n+1)/2 cells.
+	TriangularMatrix   a lower or an upper triangle by rows, n(n+1)/2 cells.
+	BandedMatrix       the diagonals from -lower to +upper by rows,
+	                   n(lower+upper+1) cells. A tridiagonal matrix is a
+	                   BandedMatrix(n, 1, 1).
+	
+	They are built from a Matrix reading only the cells of their structure
+	and toMatrix() gives the full Matrix back. The stored cells of a row
+	are contiguous: packedRow(i)[j - rowBegin(i)] is the cell (i, j) for
+	rowBegin(i) <= j < rowEnd(i), and that is what the kernels walk.
+	
+	multiplyMatrices takes any of them with a Matrix on either side, and
+	solve(A, B) returns X such that A * X = B. As in the rest of the library
+	a failure (wrong dimensions, a singular or a not positive definite 
+	matrix) gives an empty matrix.
+*/
+
+enum class Triangle { Lower, Upper };
+
+/**
+ * SymmetricMatrix class
+ * Only the lower triangle is stored, operator() reaches both of them.
+ */
+template <typename T>
+class SymmetricMatrix {
+ public:
+  SymmetricMatrix() : rank (0) {}
+  explicit SymmetricMatrix(int rank, const T& value = T())
+      : cells (rowOffset(rank), value), rank (rank) {}
+  explicit SymmetricMatrix(const Matrix<T>& matrix);
+  
+  int getRows() const { return rank; }
+  int getColumns() const { return rank; }
+  bool isEmpty() const { return rank == 0; }
+  
+  int rowBegin(int) const { return 0; }
+  int rowEnd(int row) const { return row + 1; }
+  T* packedRow(int row) { return &cells[rowOffset(row)]; }
+  const T* packedRow(int row) const { return &cells[rowOffset(row)]; }
+  
+  T& operator()(int row, int column) { 
+    return row >= column ? cells[rowOffset(row) + column] 
+                         : cells[rowOffset(column) + row]; 
+  }
+  const T& operator()(int row, int column) const { 
+    return row >= column ? cells[rowOffset(row) + column] 
+                         : cells[rowOffset(column) + row]; 
+  }
+  
+  Matrix<T> toMatrix() const;
+ private:
+  std::vector<T> cells;
+  int rank;
+  
+  static size_t rowOffset(int row) { 
+    return static_cast<size_t>(row) * (row + 1) / 2; 
+  }
+};
+
+/**
+ * TriangularMatrix class
+ * The cells outside of the triangle are zero, they can be read with 
+ * operator() but not written.
+ */
+template <typename T>
+class TriangularMatrix {
+ public:
+  TriangularMatrix() : rank (0), triangle (Triangle::Lower) {}
+  TriangularMatrix(int rank, Triangle triangle, const T& value = T())
+      : cells (static_cast<size_t>(rank) * (rank + 1) / 2, value), 
+        rank (rank), triangle (triangle) {}
+  TriangularMatrix(const Matrix<T>& matrix, Triangle triangle);
+  
+  int getRows() const { return rank; }
+  int getColumns() const { return rank; }
+  bool isEmpty() const { return rank == 0; }
+  Triangle getTriangle() const { return triangle; }
+  
+  int rowBegin(int row) const { 
+    return triangle == Triangle::Lower ? 0 : row; 
+  }
+  int rowEnd(int row) const { 
+    return triangle == Triangle::Lower ? row + 1 : rank; 
+  }
+  T* packedRow(int row) { return &cells[rowOffset(row)]; }
+  const T* packedRow(int row) const { return &cells[rowOffset(row)]; }
+  
+  T& operator()(int row, int column) { 
+    return packedRow(row)[column - rowBegin(row)]; 
+  }
+  T operator()(int row, int column) const {
+    if (column < rowBegin(row) or column >= rowEnd(row)) return T();
+    return packedRow(row)[column - rowBegin(row)];
+  }
+  
+  Matrix<T> toMatrix() const;
+ private:
+  std::vector<T> cells;
+  int rank;
+  Triangle triangle;
+  
+  size_t rowOffset(int row) const { 
+    const size_t i = row;
+    return triangle == Triangle::Lower ? i * (i + 1) / 2 
+                                       : i * rank - i * (i - 1) / 2;
+  }
+};
+
+/**
+ * BandedMatrix class
+ * It keeps the diagonals from -lower (below the main one) to +upper 
+ * (above it). The cells outside of the band are zero, they can be read 
+ * with operator() but not written.
+ */
+template <typename T>
+class BandedMatrix {
+ public:
+  BandedMatrix() : rank (0), lower (0), upper (0) {}
+  BandedMatrix(int rank, int lower, int upper, const T& value = T());
+  BandedMatrix(const Matrix<T>& matrix, int lower, int upper);
+  
+  int getRows() const { return rank; }
+  int getColumns() const { return rank; }
+  bool isEmpty() const { return rank == 0; }
+  int getLowerBandwidth() const { return lower; }
+  int getUpperBandwidth() const { return upper; }
+  
+  int rowBegin(int row) const { return std::max(0, row - lower); }
+  int rowEnd(int row) const { return std::min(rank, row + upper + 1); }
+  T* packedRow(int row) { return &cells[cellIndex(row, rowBegin(row))]; }
+  const T* packedRow(int row) const { 
+    return &cells[cellIndex(row, rowBegin(row))]; 
+  }
+  
+  T& operator()(int row, int column) { return cells[cellIndex(row, column)]; }
+  T operator()(int row, int column) const {
+    if (column < rowBegin(row) or column >= rowEnd(row)) return T();
+    return cells[cellIndex(row, column)];
+  }
+  
+  Matrix<T> toMatrix() const;
+ private:
+  std::vector<T> cells;
+  int rank, lower, upper;
+  
+  size_t cellIndex(int row, int column) const {
+    return static_cast<size_t>(row) * (lower + upper + 1) + 
+           (column - row + lower);
+  }
+};
+
+// CONSTRUCTORS
+
+/**
+ * A matrix that is not square gives an empty SymmetricMatrix, otherwise
+ * only its lower triangle is read.
+ */
+template <typename T>
+SymmetricMatrix<T>::SymmetricMatrix(const Matrix<T>& matrix) : rank (0) {
+  if (matrix.getRows() != matrix.getColumns()) return;
+  rank = matrix.getRows();
+  cells.reserve(rowOffset(rank));
+  for (int i = 0; i < rank; i++) {
+    cells.insert(end(cells), begin(matrix[i]), begin(matrix[i]) + i + 1);
+  }
+}
+
+template <typename T>
+TriangularMatrix<T>::TriangularMatrix(const Matrix<T>& matrix, 
+    Triangle triangle) : rank (0), triangle (triangle) {
+  if (matrix.getRows() != matrix.getColumns()) return;
+  rank = matrix.getRows();
+  cells.reserve(static_cast<size_t>(rank) * (rank + 1) / 2);
+  for (int i = 0; i < rank; i++) {
+    cells.insert(end(cells), begin(matrix[i]) + rowBegin(i), 
+                 begin(matrix[i]) + rowEnd(i));
+  }
+}
+
+/**
+ * The bandwidths are clamped to [0, rank - 1].
+ */
+template <typename T>
+BandedMatrix<T>::BandedMatrix(int rank, int lower, int upper, const T& value)
+    : rank (rank) {
+  this->lower = std::max(0, std::min(lower, rank - 1));
+  this->upper = std::max(0, std::min(upper, rank - 1));
+  cells.assign(static_cast<size_t>(rank) * (this->lower + this->upper + 1), 
+               value);
+}
+
+template <typename T>
+BandedMatrix<T>::BandedMatrix(const Matrix<T>& matrix, int lower, int upper)
+    : BandedMatrix() {
+  if (matrix.getRows() != matrix.getColumns()) return;
+  *this = BandedMatrix(matrix.getRows(), lower, upper);
+  for (int i = 0; i < rank; i++) {
+    std::copy(begin(matrix[i]) + rowBegin(i), begin(matrix[i]) + rowEnd(i), 
+              packedRow(i));
+  }
+}
+
+/**
+ * It copies the stored cells of every row of a structured matrix into a 
+ * Matrix of zeros.
+ */
+template <typename T, typename Structured>
+Matrix<T> expandStructuredMatrix(const Structured& structured) {
+  const int rank = structured.getRows();
+  Matrix<T> resultingMatrix(rank, rank);
+  for (int i = 0; i < rank; i++) {
+    const int first = structured.rowBegin(i);
+    std::copy(structured.packedRow(i), 
+              structured.packedRow(i) + (structured.rowEnd(i) - first), 
+              &resultingMatrix(i, first));
+  }
+  return resultingMatrix;
+}
+
+template <typename T>
+Matrix<T> SymmetricMatrix<T>::toMatrix() const {
+  Matrix<T> resultingMatrix = expandStructuredMatrix<T>(*this);
+  mirrorLowerTriangle(resultingMatrix);
+  return resultingMatrix;
+}
+
+template <typename T>
+Matrix<T> TriangularMatrix<T>::toMatrix() const {
+  return expandStructuredMatrix<T>(*this);
+}
+
+template <typename T>
+Matrix<T> BandedMatrix<T>::toMatrix() const {
+  return expandStructuredMatrix<T>(*this);
+}
+
+// Functions
+
+/**
+ * A^T * A computing and storing only its lower triangle.
+ */
+template <typename T>
+SymmetricMatrix<T> gramMatrix(const Matrix<T>& matrix) {
+  SymmetricMatrix<T> resultingMatrix(matrix.getColumns());
+  accumulateGramProduct(matrix, 
+    [&resultingMatrix](int i) { return resultingMatrix.packedRow(i); });
+  return resultingMatrix;
+}
+
+/**
+ * Sample covariance of the columns of observations, one observation
+ * per row.
+ */
+template <typename T>
+SymmetricMatrix<T> covarianceMatrix(const Matrix<T>& observations) {
+  const int rows = observations.getRows();
+  const int columns = observations.getColumns();
+  if (rows < 2) return {};
+  std::vector<T> means(columns);
+  for (int i = 0; i < rows; i++) {
+    const T* row = observations[i].data();
+    for (int j = 0; j < columns; j++) {
+      means[j] += row[j];
+    }
+  }
+  for (T& mean : means) mean /= rows;
+  Matrix<T> centered(observations);
+  for (int i = 0; i < rows; i++) {
+    T* row = &centered(i, 0);
+    for (int j = 0; j < columns; j++) {
+      row[j] -= means[j];
+    }
+  }
+  SymmetricMatrix<T> covariance = gramMatrix(centered);
+  for (int i = 0; i < columns; i++) {
+    T* row = covariance.packedRow(i);
+    for (int j = 0; j <= i; j++) {
+      row[j] /= rows - 1;
+    }
+  }
+  return covariance;
+}
+
+/*
+	Products of a triangular or banded matrix and a Matrix, every stored 
+	cell scales a row of the other operand into a row of the result.
+*/
+
+template <typename T, typename K, typename Structured>
+auto multiplyStructuredByMatrix(const Structured& structured, 
+    const Matrix<K>& matrix) -> Matrix<decltype(T() * K())> {
+  if (structured.getColumns() != matrix.getRows()) return {};
+  const int rows = structured.getRows();
+  const int columns = matrix.getColumns();
+  Matrix<decltype(T() * K())> resultingMatrix(rows, columns);
+  if (columns == 0) return resultingMatrix;
+  for (int i = 0; i < rows; i++) {
+    accumulateRowProduct(structured.packedRow(i), matrix, 
+                         structured.rowBegin(i), structured.rowEnd(i), 
+                         0, columns, &resultingMatrix(i, 0));
+  }
+  return resultingMatrix;
+}
+
+template <typename T, typename K, typename Structured>
+auto multiplyMatrixByStructured(const Matrix<K>& matrix, 
+    const Structured& structured) -> Matrix<decltype(K() * T())> {
+  if (matrix.getColumns() != structured.getRows()) return {};
+  const int rows = matrix.getRows();
+  const int depth = matrix.getColumns();
+  Matrix<decltype(K() * T())> resultingMatrix(rows, depth);
+  if (depth == 0) return resultingMatrix;
+  for (int i = 0; i < rows; i++) {
+    const K* row1 = matrix[i].data();
+    auto* resultingRow = &resultingMatrix(i, 0);
+    for (int k = 0; k < depth; k++) {
+      const K value = row1[k];
+      const T* row2 = structured.packedRow(k);
+      const int first = structured.rowBegin(k);
+      const int last = structured.rowEnd(k);
+      for (int j = first; j < last; j++) {
+        resultingRow[j] += value * row2[j - first];
+      }
+    }
+  }
+  return resultingMatrix;
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const TriangularMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyStructuredByMatrix<T>(matrix1, matrix2);
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix1, 
+    const TriangularMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyMatrixByStructured<K>(matrix1, matrix2);
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const BandedMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyStructuredByMatrix<T>(matrix1, matrix2);
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix1, 
+    const BandedMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  return multiplyMatrixByStructured<K>(matrix1, matrix2);
+}
+
+/**
+ * Every stored cell (i, j) below the diagonal is used twice, for the 
+ * row i and for the row j of the result.
+ */
+template <typename T, typename K>
+auto multiplyMatrices(const SymmetricMatrix<T>& matrix1, 
+    const Matrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  typedef decltype(T() * K()) R;
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  const int rank = matrix1.getRows();
+  const int columns = matrix2.getColumns();
+  Matrix<R> resultingMatrix(rank, columns);
+  if (columns == 0) return resultingMatrix;
+  for (int i = 0; i < rank; i++) {
+    const T* row = matrix1.packedRow(i);
+    const K* rowI = matrix2[i].data();
+    R* resultingRowI = &resultingMatrix(i, 0);
+    for (int k = 0; k < i; k++) {
+      const T value = row[k];
+      const K* rowK = matrix2[k].data();
+      R* resultingRowK = &resultingMatrix(k, 0);
+      for (int j = 0; j < columns; j++) {
+        resultingRowI[j] += value * rowK[j];
+        resultingRowK[j] += value * rowI[j];
+      }
+    }
+    const T diagonal = row[i];
+    for (int j = 0; j < columns; j++) {
+      resultingRowI[j] += diagonal * rowI[j];
+    }
+  }
+  return resultingMatrix;
+}
+
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix1, 
+    const SymmetricMatrix<K>& matrix2) -> Matrix<decltype(T() * K())> {
+  typedef decltype(T() * K()) R;
+  if (matrix1.getColumns() != matrix2.getRows()) return {};
+  const int rows = matrix1.getRows();
+  const int rank = matrix2.getRows();
+  Matrix<R> resultingMatrix(rows, rank);
+  if (rank == 0) return resultingMatrix;
+  for (int i = 0; i < rows; i++) {
+    const T* row1 = matrix1[i].data();
+    R* resultingRow = &resultingMatrix(i, 0);
+    for (int k = 0; k < rank; k++) {
+      const T value = row1[k];
+      const K* row2 = matrix2.packedRow(k);
+      R sum = R();
+      for (int j = 0; j < k; j++) {
+        resultingRow[j] += value * row2[j];
+        sum += row1[j] * row2[j];
+      }
+      resultingRow[k] += sum + value * row2[k];
+    }
+  }
+  return resultingMatrix;
+}
+
+/**
+ * It solves triangular * X = matrix by forward or backward substitution,
+ * a zero on the diagonal gives an empty matrix.
+ */
+template <typename T, typename K>
+auto solve(const TriangularMatrix<T>& triangular, const Matrix<K>& matrix) 
+    -> Matrix<decltype(K() / T())> {
+  typedef decltype(K() / T()) R;
+  if (triangular.getColumns() != matrix.getRows()) return {};
+  const int rank = triangular.getRows();
+  const int columns = matrix.getColumns();
+  Matrix<R> solution(matrix);
+  if (columns == 0) return solution;
+  const bool lower = triangular.getTriangle() == Triangle::Lower;
+  for (int n = 0; n < rank; n++) {
+    const int i = lower ? n : rank - 1 - n;
+    const T* row = triangular.packedRow(i);
+    const int first = triangular.rowBegin(i);
+    const int last = triangular.rowEnd(i);
+    const T diagonal = row[i - first];
+    if (diagonal == T()) return {};
+    R* solutionRow = &solution(i, 0);
+    for (int k = first; k < last; k++) {
+      if (k == i) continue;
+      const T value = row[k - first];
+      const R* solvedRow = &solution(k, 0);
+      for (int j = 0; j < columns; j++) {
+        solutionRow[j] -= value * solvedRow[j];
+      }
+    }
+    for (int j = 0; j < columns; j++) {
+      solutionRow[j] /= diagonal;
+    }
+  }
+  return solution;
+}
+
+/**
+ * It returns the lower triangular L such that L * L^T = symmetric, or an
+ * empty matrix if symmetric is not positive definite.
+ */
+template <typename T>
+TriangularMatrix<T> choleskyDecomposition(const SymmetricMatrix<T>& symmetric) {
+  const int rank = symmetric.getRows();
+  TriangularMatrix<T> factor(rank, Triangle::Lower);
+  for (int i = 0; i < rank; i++) {
+    const T* row = symmetric.packedRow(i);
+    T* factorRowI = factor.packedRow(i);
+    for (int j = 0; j <= i; j++) {
+      const T* factorRowJ = factor.packedRow(j);
+      T sum = row[j];
+      for (int k = 0; k < j; k++) {
+        sum -= factorRowI[k] * factorRowJ[k];
+      }
+      if (j < i) {
+        factorRowI[j] = sum / factorRowJ[j];
+      } else if (sum > T()) {
+        factorRowI[i] = std::sqrt(sum);
+      } else {
+        return {};
+      }
+    }
+  }
+  return factor;
+}
+
+/**
+ * It solves symmetric * X = matrix through the Cholesky factorization, 
+ * so symmetric must be positive definite.
+ */
+template <typename T, typename K>
+auto solve(const SymmetricMatrix<T>& symmetric, const Matrix<K>& matrix) 
+    -> Matrix<decltype(K() / T())> {
+  typedef decltype(K() / T()) R;
+  if (symmetric.getColumns() != matrix.getRows()) return {};
+  TriangularMatrix<T> factor = choleskyDecomposition(symmetric);
+  if (factor.getRows() != symmetric.getRows()) return {};
+  Matrix<R> solution = solve(factor, matrix);
+  const int columns = solution.getColumns();
+  if (columns == 0) return solution;
+  // L^T * X = Y, every solved row is subtracted from the rows above it
+  for (int i = factor.getRows() - 1; i >= 0; i--) {
+    const T* row = factor.packedRow(i);
+    R* solutionRow = &solution(i, 0);
+    for (int j = 0; j < columns; j++) {
+      solutionRow[j] /= row[i];
+    }
+    for (int k = 0; k < i; k++) {
+      const T value = row[k];
+      R* pendingRow = &solution(k, 0);
+      for (int j = 0; j < columns; j++) {
+        pendingRow[j] -= value * solutionRow[j];
+      }
+    }
+  }
+  return solution;
+}
+
+/**
+ * It solves banded * X = matrix by Gaussian elimination inside the band,
+ * O(n * lower * upper) plus the work on the columns of matrix; for a 
+ * tridiagonal matrix it is the Thomas algorithm. There is no pivoting, 
+ * which keeps the band from growing, so it is meant for diagonally 
+ * dominant or positive definite matrices; a zero pivot gives an empty 
+ * matrix.
+ */
+template <typename T, typename K>
+auto solve(const BandedMatrix<T>& banded, const Matrix<K>& matrix) 
+    -> Matrix<decltype(K() / T())> {
+  typedef decltype(K() / T()) R;
+  if (banded.getColumns() != matrix.getRows()) return {};
+  const int rank = banded.getRows();
+  const int columns = matrix.getColumns();
+  BandedMatrix<T> factor(banded);
+  Matrix<R> solution(matrix);
+  if (columns == 0) return solution;
+  for (int k = 0; k < rank; k++) {
+    const T* pivotRow = factor.packedRow(k);
+    const int pivotFirst = factor.rowBegin(k);
+    const int pivotLast = factor.rowEnd(k);
+    const T pivot = pivotRow[k - pivotFirst];
+    if (pivot == T()) return {};
+    const R* solvedRow = &solution(k, 0);
+    const int iEnd = std::min(rank, k + factor.getLowerBandwidth() + 1);
+    for (int i = k + 1; i < iEnd; i++) {
+      T* row = factor.packedRow(i);
+      const int first = factor.rowBegin(i);
+      const T multiplier = row[k - first] / pivot;
+      if (multiplier == T()) continue;
+      for (int j = k + 1; j < pivotLast; j++) {
+        row[j - first] -= multiplier * pivotRow[j - pivotFirst];
+      }
+      R* solutionRow = &solution(i, 0);
+      for (int j = 0; j < columns; j++) {
+        solutionRow[j] -= multiplier * solvedRow[j];
+      }
+    }
+  }
+  for (int i = rank - 1; i >= 0; i--) {
+    const T* row = factor.packedRow(i);
+    const int first = factor.rowBegin(i);
+    const int last = factor.rowEnd(i);
+    R* solutionRow = &solution(i, 0);
+    for (int k = i + 1; k < last; k++) {
+      const T value = row[k - first];
+      const R* solvedRow = &solution(k, 0);
+      for (int j = 0; j < columns; j++) {
+        solutionRow[j] -= value * solvedRow[j];
+      }
+    }
+    const T diagonal = row[i - first];
+    for (int j = 0; j < columns; j++) {
+      solutionRow[j] /= diagonal;
+    }
+  }
+  return solution;
+}
+
+#endif // STRUCTURED_MATRICES_H
@@ -0,0 +1,601 @@
+/*
+  @file task_graph.h Asynchronous graphs of matrix operations
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Asynchronous chains of operations. Every operation added to a 
+	TaskGraph returns at once a Task, a handle to its future result, and 
+	its operands are earlier tasks, so the graph is a DAG:
+	
+	  TaskGraph<double> graph;
+	  auto a = graph.input(A), b = graph.input(B), c = graph.input(C);
+	  auto d = graph.multiplyMatrices(a, b) * 2.0 + graph.transpose(c);
+	  graph.run();
+	  const dMatrix& result = d.get();
+	
+	run() hands every task added since the last call to the worker threads
+	of the TaskScheduler, which all the graphs share, and returns. A task 
+	starts as soon as its operands are done, so independent tasks run 
+	concurrently and a dependent one does not wait for anything else. 
+	get() waits for the task, calling run() if it was never called.
+	
+	Chains of elementwise tasks are fused: an elementwise task whose only
+	consumer is another elementwise task is not computed by itself, the 
+	consumer evaluates the whole chain row by row, so the intermediate 
+	results are a row long instead of whole matrices and the cells go 
+	through the memory once. The get() of a fused task computes it then.
+	
+	The arithmetic operators of matrix_operators.h take tasks and add 
+	elementwise tasks to their graph. The graph is built from one thread,
+	the results are kept until it is destroyed and, as in the rest of the
+	library, operands of the wrong dimensions give an empty matrix.
+*/
+
+#define TASK_GRAPH_OPERATOR(OP)                                             \
+    friend Task operator OP(const Task& task1, const Task& task2) {         \
+      return task1.graph->applyFunctorToMatrices(task1, task2,              \
+        [](const T& x, const T& y) {                                        \
+          return x OP y;                                                    \
+      });                                                                   \
+    }                                                                       \
+    template <typename K>                                                   \
+    friend Task operator OP(const Task& task, const K& value) {             \
+      return task.graph->applyFunctor(task, [value](const T& x) {           \
+        return x OP value;                                                  \
+      });                                                                   \
+    }                                                                       \
+    template <typename K>                                                   \
+    friend Task operator OP(const K& value, const Task& task) {             \
+      return task.graph->applyFunctor(task, [value](const T& x) {           \
+        return value OP x;                                                  \
+      });                                                                   \
+    }
+
+/**
+ * TaskScheduler class
+ * The worker threads shared by all the task graphs, started on first use.
+ * They run the jobs submitted to them in order, and the jobs of a graph
+ * not yet started are cancelled when it is destroyed.
+ */
+class TaskScheduler {
+ public:
+  static TaskScheduler& instance() {
+    static TaskScheduler scheduler(
+        std::max(2u, std::thread::hardware_concurrency()));
+    return scheduler;
+  }
+  ~TaskScheduler();
+  
+  int size() const { return workers.size(); }
+  
+  void submit(const void* owner, std::function<void()> job);
+  // It drops the jobs of owner still waiting and returns how many
+  int cancel(const void* owner);
+ private:
+  explicit TaskScheduler(int threads);
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+  
+  struct Job {
+    const void* owner;
+    std::function<void()> work;
+  };
+  
+  void workerLoop();
+  
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stopping;
+};
+
+inline TaskScheduler::TaskScheduler(int threads) : stopping (false) {
+  for (int i = 0; i < threads; i++) {
+    workers.push_back(std::thread(&TaskScheduler::workerLoop, this));
+  }
+}
+
+inline TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+inline void TaskScheduler::submit(const void* owner, 
+                                  std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(Job{owner, std::move(job)});
+  }
+  changed.notify_one();
+}
+
+inline int TaskScheduler::cancel(const void* owner) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto kept = std::remove_if(jobs.begin(), jobs.end(), 
+      [owner](const Job& job) { return job.owner == owner; });
+  const int count = jobs.end() - kept;
+  jobs.erase(kept, jobs.end());
+  return count;
+}
+
+inline void TaskScheduler::workerLoop() {
+  while (true) {
+    std::function<void()> work;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] { return stopping or not jobs.empty(); });
+      if (stopping) return;
+      work = std::move(jobs.front().work);
+      jobs.pop_front();
+    }
+    work();
+  }
+}
+
+template <typename T>
+class TaskGraph {
+ public:
+  /**
+   * Task class
+   * Handle to the result of an operation of a TaskGraph, which must 
+   * outlive it.
+   */
+  class Task {
+   public:
+    Task() : graph (nullptr), node (-1) {}
+    
+    const Matrix<T>& get() const { return graph->get(node); }
+    bool isReady() const { return graph->isReady(node); }
+    int getRows() const { return graph->nodes[node]->rows; }
+    int getColumns() const { return graph->nodes[node]->columns; }
+    
+    TASK_GRAPH_OPERATOR(*)
+    TASK_GRAPH_OPERATOR(/)
+    TASK_GRAPH_OPERATOR(+)
+    TASK_GRAPH_OPERATOR(-)
+   private:
+    Task(TaskGraph* graph, int node) : graph (graph), node (node) {}
+    
+    TaskGraph* graph;
+    int node;
+    
+    friend class TaskGraph;
+  };
+  
+  TaskGraph();
+  ~TaskGraph();
+  
+  Task input(const Matrix<T>& matrix) { return addInput(Matrix<T>(matrix)); }
+  Task input(Matrix<T>&& matrix) { return addInput(std::move(matrix)); }
+  Task multiplyMatrices(const Task& task1, const Task& task2);
+  Task transpose(const Task& task);
+  template <typename Functor>
+  Task applyFunctor(const Task& task, const Functor& functor);
+  template <typename Functor>
+  Task applyFunctorToMatrices(const Task& task1, const Task& task2, 
+                              const Functor& functor);
+  
+  void run();
+ private:
+  TaskGraph(const TaskGraph&) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
+  
+  enum class Kind { Input, Multiply, Transpose, Elementwise };
+  // It computes count cells of a row, second is null for unary ones
+  typedef std::function<void(const T*, const T*, T*, int)> RowKernel;
+  
+  struct Node {
+    Kind kind;
+    int first;
+    int second;
+    RowKernel kernel;
+    int rows;
+    int columns;
+    Matrix<T> result;
+    int consumers;
+    int root;
+    int pending;
+    bool scheduled;
+    bool fused;
+    bool done;
+    std::vector<int> dependents;
+  };
+  
+  /*
+  	The steps of a fused evaluation in order, an operand is the buffer of
+  	an earlier step when it is not negative and leaf -operand - 1 else.
+  */
+  struct Step {
+    const Node* node;
+    int first;
+    int second;
+  };
+  struct Program {
+    std::vector<Step> steps;
+    std::vector<const Node*> leaves;
+    std::vector<int> leafNodes;
+  };
+  
+  std::vector<std::unique_ptr<Node>> nodes;
+  TaskScheduler& scheduler;
+  // Jobs submitted to the scheduler and not finished yet
+  int queued;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stopping;
+  
+  Task addInput(Matrix<T>&& matrix);
+  Task addNode(Kind kind, int first, int second, int rows, int columns, 
+               RowKernel kernel = RowKernel());
+  bool available(int node) const {
+    return nodes[node]->done or 
+           (nodes[node]->fused and nodes[nodes[node]->root]->done);
+  }
+  bool isReady(int node);
+  const Matrix<T>& get(int node);
+  int compile(int node, int root, Program& program) const;
+  std::vector<int> missingLeaves(const Program& program) const {
+    std::vector<int> missing;
+    for (int leaf : program.leafNodes) {
+      if (not nodes[leaf]->done) missing.push_back(leaf);
+    }
+    return missing;
+  }
+  Matrix<T> evaluate(const Node& node, const Program& program) const;
+  void materialize(int node);
+  void schedule(int node);
+  void execute(int node);
+};
+
+#undef TASK_GRAPH_OPERATOR
+
+/**
+ * Taking the scheduler here makes it outlive every graph.
+ */
+template <typename T>
+TaskGraph<T>::TaskGraph() 
+    : scheduler (TaskScheduler::instance()), queued (0), stopping (false) {}
+
+/**
+ * The tasks still waiting are dropped, the ones running are finished.
+ */
+template <typename T>
+TaskGraph<T>::~TaskGraph() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  const int cancelled = scheduler.cancel(this);
+  std::unique_lock<std::mutex> lock(mutex);
+  queued -= cancelled;
+  changed.wait(lock, [&] { return queued == 0; });
+}
+
+template <typename T>
+typename TaskGraph<T>::Task TaskGraph<T>::addInput(Matrix<T>&& matrix) {
+  const int rows = matrix.getRows();
+  const int columns = matrix.getColumns();
+  Task task = addNode(Kind::Input, -1, -1, rows, columns);
+  std::lock_guard<std::mutex> lock(mutex);
+  Node& node = *nodes[task.node];
+  node.result = std::move(matrix);
+  node.scheduled = node.done = true;
+  return task;
+}
+
+template <typename T>
+typename TaskGraph<T>::Task TaskGraph<T>::addNode(Kind kind, int first, 
+    int second, int rows, int columns, RowKernel kernel) {
+  std::unique_ptr<Node> node(new Node{kind, first, second, std::move(kernel),
+      rows, columns, Matrix<T>(), 0, -1, 0, false, false, false, {}});
+  std::lock_guard<std::mutex> lock(mutex);
+  if (first >= 0) nodes[first]->consumers++;
+  if (second >= 0) nodes[second]->consumers++;
+  nodes.push_back(std::move(node));
+  return Task(this, nodes.size() - 1);
+}
+
+template <typename T>
+typename TaskGraph<T>::Task TaskGraph<T>::multiplyMatrices(
+    const Task& task1, const Task& task2) {
+  const bool valid = task1.getColumns() == task2.getRows() and 
+                     task1.getRows() > 0;
+  return addNode(Kind::Multiply, task1.node, task2.node, 
+                 valid ? task1.getRows() : 0, valid ? task2.getColumns() : 0);
+}
+
+template <typename T>
+typename TaskGraph<T>::Task TaskGraph<T>::transpose(const Task& task) {
+  const bool valid = task.getRows() > 0;
+  return addNode(Kind::Transpose, task.node, -1, 
+                 valid ? task.getColumns() : 0, valid ? task.getRows() : 0);
+}
+
+template <typename T>
+template <typename Functor>
+typename TaskGraph<T>::Task TaskGraph<T>::applyFunctor(const Task& task, 
+    const Functor& functor) {
+  return addNode(Kind::Elementwise, task.node, -1, task.getRows(), 
+                 task.getColumns(), 
+    [functor](const T* x, const T*, T* result, int count) {
+      for (int j = 0; j < count; j++) {
+        result[j] = functor(x[j]);
+      }
+    });
+}
+
+template <typename T>
+template <typename Functor>
+typename TaskGraph<T>::Task TaskGraph<T>::applyFunctorToMatrices(
+    const Task& task1, const Task& task2, const Functor& functor) {
+  const bool valid = task1.getRows() == task2.getRows() and 
+                     task1.getColumns() == task2.getColumns();
+  return addNode(Kind::Elementwise, task1.node, task2.node, 
+                 valid ? task1.getRows() : 0, valid ? task1.getColumns() : 0,
+    [functor](const T* x, const T* y, T* result, int count) {
+      for (int j = 0; j < count; j++) {
+        result[j] = functor(x[j], y[j]);
+      }
+    });
+}
+
+/**
+ * The operands of a task are always older tasks, so walking the new ones 
+ * backwards sees every consumer before its operands, and a fused task 
+ * joins the group of its consumer.
+ */
+template <typename T>
+void TaskGraph<T>::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  const int count = nodes.size();
+  int firstNew = count;
+  while (firstNew > 0 and not nodes[firstNew - 1]->scheduled) firstNew--;
+  for (int i = count - 1; i >= firstNew; i--) {
+    Node& node = *nodes[i];
+    if (node.root < 0) node.root = i;
+    if (node.kind != Kind::Elementwise or node.rows == 0) continue;
+    for (int operand : {node.first, node.second}) {
+      Node* candidate = operand >= 0 ? nodes[operand].get() : nullptr;
+      if (candidate and not candidate->scheduled and 
+          candidate->kind == Kind::Elementwise and 
+          candidate->consumers == 1 and candidate->rows > 0) {
+        candidate->fused = true;
+        candidate->root = node.root;
+      }
+    }
+  }
+  for (int i = firstNew; i < count; i++) {
+    Node& node = *nodes[i];
+    node.scheduled = true;
+    if (node.fused) continue;
+    Program program;
+    compile(i, i, program);
+    for (int leaf : program.leafNodes) {
+      if (not available(leaf)) {
+        node.pending++;
+        nodes[nodes[leaf]->fused ? nodes[leaf]->root : leaf]
+            ->dependents.push_back(i);
+      }
+    }
+    if (node.pending == 0) schedule(i);
+  }
+}
+
+template <typename T>
+bool TaskGraph<T>::isReady(int node) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return available(node);
+}
+
+template <typename T>
+const Matrix<T>& TaskGraph<T>::get(int node) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (not nodes[node]->scheduled) {
+    lock.unlock();
+    run();
+    lock.lock();
+  }
+  changed.wait(lock, [&] { return available(node); });
+  if (not nodes[node]->done) {
+    lock.unlock();
+    materialize(node);
+    lock.lock();
+  }
+  return nodes[node]->result;
+}
+
+/**
+ * It appends the steps of node, whose group is the one of root, and 
+ * returns the operand which refers to its result. Called with the lock.
+ */
+template <typename T>
+int TaskGraph<T>::compile(int node, int root, Program& program) const {
+  const Node& current = *nodes[node];
+  if (node != root and (not current.fused or current.root != root or 
+                        current.done)) {
+    const auto found = std::find(program.leafNodes.begin(), 
+                                 program.leafNodes.end(), node);
+    if (found != program.leafNodes.end()) {
+      return -(found - program.leafNodes.begin()) - 1;
+    }
+    program.leafNodes.push_back(node);
+    program.leaves.push_back(&current);
+    return -static_cast<int>(program.leaves.size());
+  }
+  const int first = current.first >= 0 
+                    ? compile(current.first, root, program) : 0;
+  const int second = current.second >= 0 
+                     ? compile(current.second, root, program) : 0;
+  program.steps.push_back(Step{&current, first, second});
+  return program.steps.size() - 1;
+}
+
+/**
+ * The last step writes the rows of the result, the others a buffer of 
+ * one row each per chunk.
+ */
+template <typename T>
+Matrix<T> TaskGraph<T>::evaluate(const Node& node, 
+                                 const Program& program) const {
+  const std::vector<const Node*>& leaves = program.leaves;
+  switch (node.kind) {
+    case Kind::Input:
+      return node.result;
+    case Kind::Multiply:
+      if (node.rows == 0) return {};
+      return ::multiplyMatrices(leaves[0]->result, leaves.back()->result);
+    case Kind::Transpose:
+      if (node.rows == 0) return {};
+      return leaves[0]->result.transpose();
+    case Kind::Elementwise:
+      break;
+  }
+  if (node.rows == 0 or node.columns == 0) return {};
+  const std::vector<Step>& steps = program.steps;
+  const int rows = node.rows;
+  const int columns = node.columns;
+  INSTRUMENT_OPERATION("fusedElementwise", 1LL * rows * columns, 
+      1LL * rows * columns * steps.size(), 
+      sizeof(T) * rows * columns * (leaves.size() + 1));
+  Matrix<T> result(rows, columns);
+  const int last = steps.size() - 1;
+  parallelFor(0, rows, rowsPerChunk(columns * steps.size()), 
+    [&](int firstRow, int lastRow) {
+      std::vector<std::vector<T>> buffers(last, std::vector<T>(columns));
+      const auto row = [&](int operand, int i) -> const T* {
+        if (operand >= 0) return buffers[operand].data();
+        return leaves[-operand - 1]->result[i].data();
+      };
+      for (int i = firstRow; i < lastRow; i++) {
+        for (int s = 0; s <= last; s++) {
+          const Step& step = steps[s];
+          T* output = s == last ? &result(i, 0) : buffers[s].data();
+          step.node->kernel(row(step.first, i), 
+                            step.node->second >= 0 
+                                ? row(step.second, i) : nullptr, 
+                            output, columns);
+        }
+      }
+  });
+  return result;
+}
+
+/**
+ * A fused task is computed from the leaves of its group, which are done
+ * once the root of the group is.
+ */
+template <typename T>
+void TaskGraph<T>::materialize(int node) {
+  Program program;
+  Node* current;
+  std::vector<int> missing;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = nodes[node].get();
+    if (current->done) return;
+    compile(node, current->root, program);
+    missing = missingLeaves(program);
+  }
+  for (int leaf : missing) {
+    materialize(leaf);
+  }
+  Matrix<T> result = evaluate(*current, program);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (not current->done) {
+      current->result = std::move(result);
+      current->done = true;
+    }
+  }
+  changed.notify_all();
+}
+
+/**
+ * It submits the job of a task whose operands are available. Called with
+ * the lock.
+ */
+template <typename T>
+void TaskGraph<T>::schedule(int node) {
+  if (stopping) return;
+  queued++;
+  scheduler.submit(this, [this, node] { execute(node); });
+}
+
+/**
+ * The job of a task. The notification is sent with the lock held, as the
+ * graph may be destroyed as soon as the job has finished.
+ */
+template <typename T>
+void TaskGraph<T>::execute(int node) {
+  Node* current;
+  Program program;
+  std::vector<int> missing;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+      queued--;
+      changed.notify_all();
+      return;
+    }
+    current = nodes[node].get();
+    compile(node, node, program);
+    missing = missingLeaves(program);
+  }
+  // Operands fused in an earlier run are computed on demand
+  for (int leaf : missing) {
+    materialize(leaf);
+  }
+  Matrix<T> result = evaluate(*current, program);
+  std::lock_guard<std::mutex> lock(mutex);
+  current->result = std::move(result);
+  current->done = true;
+  for (int dependent : current->dependents) {
+    if (--nodes[dependent]->pending == 0) schedule(dependent);
+  }
+  queued--;
+  changed.notify_all();
+}
+
+#endif // TASK_GRAPH_H
@@ -0,0 +1,603 @@
+/*
+  @file tiled_matrices.h Out-of-core matrices stored as tiles on disk
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef TILED_MATRICES_H
+#define TILED_MATRICES_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+	Out-of-core matrices, for operands larger than the memory. A 
+	TiledMatrix lives in a file split into square tiles of tileSize cells
+	per side (the ones of the last tile row and column are smaller), each
+	tile stored contiguously by rows, so it is read or written with a 
+	single seek. Only the tiles that an operation is working on are ever 
+	in memory.
+	
+	The operations stream their tiles: prefetching threads read the next 
+	tiles while the calling thread computes on the current ones with the 
+	in-memory kernels (accumulateProduct, applyFunctorToMatrices) and 
+	writes every result tile back. How many tiles are read ahead is bounded
+	by the memory budget of the OutOfCorePolicy, e.g.
+	
+	  multiplyMatrices(a, b, "c.tiles", outOfCore.withMemoryBudget(1 << 28))
+	
+	multiplyMatrices, transpose, applyFunctorToMatrices and the arithmetic 
+	operators have the semantics of the ones of Matrix. Their result is 
+	written to the path given, or else to a temporary file next to the 
+	first operand which is removed when the last TiledMatrix referring to 
+	it is destroyed, unless it is kept with saveAs. As in the rest of the 
+	library a failure (dimensions which do not match, different tile 
+	sizes, a file which cannot be read or written) gives an empty 
+	TiledMatrix.
+*/
+const int TILE_SIZE = 1024;
+
+/**
+ * The memory given to the tiles read ahead by an out-of-core operation
+ * and the number of threads reading them.
+ */
+struct OutOfCorePolicy {
+  long long memoryBudget;
+  int prefetchThreads;
+  OutOfCorePolicy withMemoryBudget(long long bytes) const {
+    return OutOfCorePolicy{bytes, prefetchThreads};
+  }
+  OutOfCorePolicy withPrefetchThreads(int threads) const {
+    return OutOfCorePolicy{memoryBudget, threads};
+  }
+};
+
+const OutOfCorePolicy outOfCore = OutOfCorePolicy{1LL << 30, 2};
+
+struct TiledFileHeader {
+  char magic[8];
+  std::int32_t cellSize;
+  std::int32_t rows;
+  std::int32_t columns;
+  std::int32_t tileSize;
+};
+
+const char TILED_FILE_MAGIC[8] = {'T', 'I', 'L', 'E', 'D', 'M', 'A', 'T'};
+
+/**
+ * The file of a TiledMatrix, shared by its copies. A temporary one is 
+ * removed with the last of them.
+ */
+struct TiledFile {
+  std::string path;
+  bool temporary;
+  ~TiledFile() {
+    if (temporary) std::remove(path.c_str());
+  }
+};
+
+/**
+ * TiledMatrix class
+ * Matrix stored by tiles in a file, the cells are T values as they are in
+ * memory, so T must be trivially copyable. Copies refer to the same file.
+ */
+template <typename T>
+class TiledMatrix {
+  static_assert(std::is_trivially_copyable<T>::value, 
+                "Tiled matrices need trivially copyable cells");
+ public:
+  TiledMatrix() : rows (0), columns (0), tileSize (0) {}
+  /*
+  	A new file of zeros, an empty path makes it temporary next to 
+  	nearPath, see temporaryTilePath.
+  */
+  TiledMatrix(const std::string& path, int rows, int columns, 
+              int tileSize = TILE_SIZE, const std::string& nearPath = "");
+  TiledMatrix(const std::string& path, const Matrix<T>& matrix, 
+              int tileSize = TILE_SIZE);
+  static TiledMatrix open(const std::string& path);
+  
+  int getRows() const { return rows; }
+  int getColumns() const { return columns; }
+  long long numberOfCells() const { return 1LL * rows * columns; }
+  bool isEmpty() const { return rows == 0; }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return rows == other.getRows() and columns == other.getColumns();
+  }
+  int getTileSize() const { return tileSize; }
+  std::string getPath() const { return file ? file->path : std::string(); }
+  
+  // An empty tiled matrix has no tiles, and no tile size either
+  int tileRows() const { 
+    return tileSize == 0 ? 0 : (rows + tileSize - 1) / tileSize; 
+  }
+  int tileColumns() const { 
+    return tileSize == 0 ? 0 : (columns + tileSize - 1) / tileSize; 
+  }
+  int tileHeight(int tileRow) const {
+    return std::min(tileSize, rows - tileRow * tileSize);
+  }
+  int tileWidth(int tileColumn) const {
+    return std::min(tileSize, columns - tileColumn * tileSize);
+  }
+  
+  Matrix<T> readTile(int tileRow, int tileColumn) const;
+  bool writeTile(int tileRow, int tileColumn, const Matrix<T>& tile);
+  Matrix<T> toMatrix() const;
+  // It moves the file to path and keeps it from then on
+  bool saveAs(const std::string& path);
+ private:
+  std::shared_ptr<TiledFile> file;
+  int rows, columns, tileSize;
+  
+  bool containsTile(int tileRow, int tileColumn) const {
+    return tileRow >= 0 and tileRow < tileRows() and 
+           tileColumn >= 0 and tileColumn < tileColumns();
+  }
+  std::streamoff tileOffset(int tileRow, int tileColumn) const {
+    return sizeof(TiledFileHeader) + static_cast<std::streamoff>(sizeof(T)) * 
+        (1LL * tileRow * tileSize * columns + 
+         1LL * tileHeight(tileRow) * tileColumn * tileSize);
+  }
+};
+
+/**
+ * A path next to nearPath which no other temporary of this process uses.
+ */
+inline std::string temporaryTilePath(const std::string& nearPath) {
+  static std::atomic<long long> counter(0);
+  const long long stamp = 
+      std::chrono::steady_clock::now().time_since_epoch().count();
+  return (nearPath.empty() ? std::string("matrix") : nearPath) + ".tmp" + 
+         std::to_string(stamp) + "_" + std::to_string(counter++);
+}
+
+/**
+ * The cells are zeros, the file is extended past them without writing 
+ * them, which most file systems store sparsely.
+ */
+template <typename T>
+TiledMatrix<T>::TiledMatrix(const std::string& path, int rows, int columns, 
+    int tileSize, const std::string& nearPath) 
+    : rows (0), columns (0), tileSize (0) {
+  if (rows <= 0 or columns <= 0 or tileSize <= 0) return;
+  const bool temporary = path.empty();
+  std::shared_ptr<TiledFile> newFile(new TiledFile{
+      temporary ? temporaryTilePath(nearPath) : path, temporary});
+  std::ofstream stream(newFile->path, std::ios::binary | std::ios::trunc);
+  TiledFileHeader header;
+  std::memcpy(header.magic, TILED_FILE_MAGIC, sizeof header.magic);
+  header.cellSize = sizeof(T);
+  header.rows = rows;
+  header.columns = columns;
+  header.tileSize = tileSize;
+  stream.write(reinterpret_cast<const char*>(&header), sizeof header);
+  stream.seekp(sizeof header + 
+               static_cast<std::streamoff>(sizeof(T)) * rows * columns - 1);
+  stream.put('\0');
+  stream.close();
+  if (not stream) return;
+  file = newFile;
+  this->rows = rows;
+  this->columns = columns;
+  this->tileSize = tileSize;
+}
+
+template <typename T>
+TiledMatrix<T>::TiledMatrix(const std::string& path, const Matrix<T>& matrix, 
+    int tileSize) 
+    : TiledMatrix(path, matrix.getRows(), matrix.getColumns(), tileSize) {
+  if (isEmpty()) return;
+  for (int i = 0; i < tileRows(); i++) {
+    for (int j = 0; j < tileColumns(); j++) {
+      Matrix<T> tile(tileHeight(i), tileWidth(j));
+      const int columnOffset = j * tileSize;
+      for (int r = 0; r < tile.getRows(); r++) {
+        const T* row = matrix[i * tileSize + r].data() + columnOffset;
+        std::copy(row, row + tile.getColumns(), &tile(r, 0));
+      }
+      if (not writeTile(i, j, tile)) {
+        *this = TiledMatrix();
+        return;
+      }
+    }
+  }
+}
+
+template <typename T>
+TiledMatrix<T> TiledMatrix<T>::open(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary);
+  TiledFileHeader header;
+  stream.read(reinterpret_cast<char*>(&header), sizeof header);
+  TiledMatrix matrix;
+  if (not stream or 
+      std::memcmp(header.magic, TILED_FILE_MAGIC, sizeof header.magic) != 0 or
+      header.cellSize != static_cast<std::int32_t>(sizeof(T)) or 
+      header.rows <= 0 or header.columns <= 0 or header.tileSize <= 0) {
+    return matrix;
+  }
+  matrix.file.reset(new TiledFile{path, false});
+  matrix.rows = header.rows;
+  matrix.columns = header.columns;
+  matrix.tileSize = header.tileSize;
+  return matrix;
+}
+
+template <typename T>
+Matrix<T> TiledMatrix<T>::readTile(int tileRow, int tileColumn) const {
+  if (not containsTile(tileRow, tileColumn)) return {};
+  std::ifstream stream(file->path, std::ios::binary);
+  stream.seekg(tileOffset(tileRow, tileColumn));
+  Matrix<T> tile(tileHeight(tileRow), tileWidth(tileColumn));
+  const std::streamsize rowBytes = sizeof(T) * tile.getColumns();
+  for (int r = 0; r < tile.getRows() and stream; r++) {
+    stream.read(reinterpret_cast<char*>(&tile(r, 0)), rowBytes);
+  }
+  if (not stream) return {};
+  return tile;
+}
+
+template <typename T>
+bool TiledMatrix<T>::writeTile(int tileRow, int tileColumn, 
+                               const Matrix<T>& tile) {
+  if (not containsTile(tileRow, tileColumn) or 
+      tile.getRows() != tileHeight(tileRow) or 
+      tile.getColumns() != tileWidth(tileColumn)) {
+    return false;
+  }
+  std::fstream stream(file->path, 
+                      std::ios::binary | std::ios::in | std::ios::out);
+  stream.seekp(tileOffset(tileRow, tileColumn));
+  const std::streamsize rowBytes = sizeof(T) * tile.getColumns();
+  for (int r = 0; r < tile.getRows() and stream; r++) {
+    stream.write(reinterpret_cast<const char*>(tile[r].data()), rowBytes);
+  }
+  stream.close();
+  return static_cast<bool>(stream);
+}
+
+/**
+ * The whole matrix in memory, it must fit.
+ */
+template <typename T>
+Matrix<T> TiledMatrix<T>::toMatrix() const {
+  Matrix<T> matrix(rows, columns);
+  for (int i = 0; i < tileRows(); i++) {
+    for (int j = 0; j < tileColumns(); j++) {
+      const Matrix<T> tile = readTile(i, j);
+      if (tile.isEmpty()) return {};
+      for (int r = 0; r < tile.getRows(); r++) {
+        std::copy(tile[r].begin(), tile[r].end(), 
+                  &matrix(i * tileSize + r, j * tileSize));
+      }
+    }
+  }
+  return matrix;
+}
+
+template <typename T>
+bool TiledMatrix<T>::saveAs(const std::string& path) {
+  if (not file or std::rename(file->path.c_str(), path.c_str()) != 0) {
+    return false;
+  }
+  file->path = path;
+  file->temporary = false;
+  return true;
+}
+
+/**
+ * It calls consume(s, slot) for s in [0, count) in order, with the slots
+ * that load(s, slot) fills in the prefetching threads, at most depth of 
+ * them ahead of the consumer. Both return false on a failure, which stops
+ * the stream and makes it return false.
+ */
+template <typename Slot, typename Load, typename Consume>
+bool streamTiles(int count, int depth, int threads, const Load& load, 
+                 const Consume& consume) {
+  depth = std::max(1, std::min(depth, count));
+  threads = std::max(1, std::min(threads, depth));
+  std::vector<Slot> slots(depth);
+  std::vector<int> loaded(depth, -1);
+  std::mutex mutex;
+  std::condition_variable changed;
+  int next = 0;
+  int consumed = 0;
+  bool failed = false;
+  const auto prefetch = [&] {
+    while (true) {
+      int s;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { 
+          return failed or next >= count or next < consumed + depth; 
+        });
+        if (failed or next >= count) return;
+        s = next++;
+      }
+      Slot slot;
+      const bool success = load(s, slot);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (success) {
+          slots[s % depth] = std::move(slot);
+          loaded[s % depth] = s;
+        } else {
+          failed = true;
+        }
+      }
+      changed.notify_all();
+    }
+  };
+  std::vector<std::thread> prefetchers;
+  for (int t = 0; t < threads and count > 0; t++) {
+    prefetchers.push_back(std::thread(prefetch));
+  }
+  for (int s = 0; s < count; s++) {
+    Slot slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] { return failed or loaded[s % depth] == s; });
+      if (failed) break;
+      slot = std::move(slots[s % depth]);
+      loaded[s % depth] = -1;
+      consumed = s + 1;
+    }
+    changed.notify_all();
+    if (not consume(s, slot)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+      }
+      changed.notify_all();
+      break;
+    }
+  }
+  for (std::thread& prefetcher : prefetchers) {
+    prefetcher.join();
+  }
+  return not failed;
+}
+
+/**
+ * How many slots of slotBytes fit in the budget besides residentBytes, 
+ * one of them is the one being consumed.
+ */
+inline int prefetchDepth(const OutOfCorePolicy& policy, long long slotBytes,
+                         long long residentBytes) {
+  const long long slots = 
+      (policy.memoryBudget - residentBytes) / std::max(1LL, slotBytes) - 1;
+  return static_cast<int>(std::max(1LL, std::min(slots, 1LL << 20)));
+}
+
+/**
+ * Every tile of the result is accumulated over the pairs of tiles 
+ * (i, k) and (k, j), which are streamed in that order. 
+ */
+template <typename T, typename K>
+auto multiplyMatrices(const TiledMatrix<T>& matrix1, 
+    const TiledMatrix<K>& matrix2, const std::string& path = "", 
+    const OutOfCorePolicy& policy = outOfCore) 
+    -> TiledMatrix<decltype(T() * K())> {
+  typedef decltype(T() * K()) R;
+  typedef std::pair<Matrix<T>, Matrix<K>> Tiles;
+  const int tileSize = matrix1.getTileSize();
+  if (matrix1.isEmpty() or matrix1.getColumns() != matrix2.getRows() or 
+      tileSize != matrix2.getTileSize()) {
+    return {};
+  }
+  INSTRUMENT_OPERATION("multiplyMatrices", 
+      1LL * matrix1.getRows() * matrix2.getColumns(), 
+      2LL * matrix1.numberOfCells() * matrix2.getColumns(), 
+      sizeof(T) * matrix1.numberOfCells() * matrix2.tileColumns() + 
+      sizeof(K) * matrix2.numberOfCells() * matrix1.tileRows() + 
+      sizeof(R) * matrix1.getRows() * matrix2.getColumns());
+  TiledMatrix<R> result(path, matrix1.getRows(), matrix2.getColumns(), 
+                        tileSize, matrix1.getPath());
+  if (result.isEmpty()) return {};
+  const int inner = matrix1.tileColumns();
+  const int columns = result.tileColumns();
+  const long long tileCells = 1LL * tileSize * tileSize;
+  Matrix<R> accumulator;
+  const bool success = streamTiles<Tiles>(
+    result.tileRows() * columns * inner, 
+    prefetchDepth(policy, tileCells * (sizeof(T) + sizeof(K)), 
+                  tileCells * sizeof(R)), 
+    policy.prefetchThreads, 
+    [&](int s, Tiles& tiles) {
+      const int k = s % inner;
+      const int j = s / inner % columns;
+      const int i = s / inner / columns;
+      tiles.first = matrix1.readTile(i, k);
+      tiles.second = matrix2.readTile(k, j);
+      return not tiles.first.isEmpty() and not tiles.second.isEmpty();
+    }, 
+    [&](int s, Tiles& tiles) {
+      const int k = s % inner;
+      const int j = s / inner % columns;
+      const int i = s / inner / columns;
+      if (k == 0) {
+        accumulator = Matrix<R>(result.tileHeight(i), result.tileWidth(j));
+      }
+      accumulateProduct(tiles.first, tiles.second, accumulator);
+      return k < inner - 1 or result.writeTile(i, j, accumulator);
+    });
+  return success ? result : TiledMatrix<R>();
+}
+
+template <typename T>
+TiledMatrix<T> transpose(const TiledMatrix<T>& matrix, 
+    const std::string& path = "", const OutOfCorePolicy& policy = outOfCore) {
+  if (matrix.isEmpty()) return {};
+  INSTRUMENT_OPERATION("transpose", matrix.numberOfCells(), 0, 
+                       2 * sizeof(T) * matrix.numberOfCells());
+  const int tileSize = matrix.getTileSize();
+  TiledMatrix<T> result(path, matrix.getColumns(), matrix.getRows(), 
+                        tileSize, matrix.getPath());
+  if (result.isEmpty()) return {};
+  const int columns = matrix.tileColumns();
+  const long long tileBytes = 1LL * tileSize * tileSize * sizeof(T);
+  const bool success = streamTiles<Matrix<T>>(
+    matrix.tileRows() * columns, prefetchDepth(policy, tileBytes, tileBytes), 
+    policy.prefetchThreads, 
+    [&](int s, Matrix<T>& tile) {
+      tile = matrix.readTile(s / columns, s % columns);
+      return not tile.isEmpty();
+    }, 
+    [&](int s, Matrix<T>& tile) {
+      return result.writeTile(s % columns, s / columns, 
+                              std::move(tile).transpose());
+    });
+  return success ? result : TiledMatrix<T>();
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrices(const TiledMatrix<T>& matrix1, 
+    const TiledMatrix<K>& matrix2, const Functor& functor, 
+    const std::string& path = "", const OutOfCorePolicy& policy = outOfCore) 
+    -> TiledMatrix<decltype(functor(T(), K()))> {
+  typedef decltype(functor(T(), K())) R;
+  typedef std::pair<Matrix<T>, Matrix<K>> Tiles;
+  const int tileSize = matrix1.getTileSize();
+  if (matrix1.isEmpty() or not matrix1.hasSameDimensionsAs(matrix2) or 
+      tileSize != matrix2.getTileSize()) {
+    return {};
+  }
+  TiledMatrix<R> result(path, matrix1.getRows(), matrix1.getColumns(), 
+                        tileSize, matrix1.getPath());
+  if (result.isEmpty()) return {};
+  const int columns = result.tileColumns();
+  const long long tileCells = 1LL * tileSize * tileSize;
+  const bool success = streamTiles<Tiles>(
+    result.tileRows() * columns, 
+    prefetchDepth(policy, tileCells * (sizeof(T) + sizeof(K)), 
+                  tileCells * sizeof(R)), 
+    policy.prefetchThreads, 
+    [&](int s, Tiles& tiles) {
+      tiles.first = matrix1.readTile(s / columns, s % columns);
+      tiles.second = matrix2.readTile(s / columns, s % columns);
+      return not tiles.first.isEmpty() and not tiles.second.isEmpty();
+    }, 
+    [&](int s, Tiles& tiles) {
+      return result.writeTile(s / columns, s % columns, 
+          applyFunctorToMatrices(matrix_execution::par, tiles.first, 
+                                 tiles.second, functor));
+    });
+  return success ? result : TiledMatrix<R>();
+}
+
+template <typename T, typename K, typename Functor>
+auto applyFunctorToMatrixAndScalar(const TiledMatrix<T>& matrix, 
+    const K& scalar, const Functor& functor, const std::string& path = "", 
+    const OutOfCorePolicy& policy = outOfCore) 
+    -> TiledMatrix<decltype(functor(T(), K()))> {
+  typedef decltype(functor(T(), K())) R;
+  const int tileSize = matrix.getTileSize();
+  if (matrix.isEmpty()) return {};
+  TiledMatrix<R> result(path, matrix.getRows(), matrix.getColumns(), 
+                        tileSize, matrix.getPath());
+  if (result.isEmpty()) return {};
+  const int columns = result.tileColumns();
+  const long long tileCells = 1LL * tileSize * tileSize;
+  const bool success = streamTiles<Matrix<T>>(
+    result.tileRows() * columns, 
+    prefetchDepth(policy, tileCells * sizeof(T), tileCells * sizeof(R)), 
+    policy.prefetchThreads, 
+    [&](int s, Matrix<T>& tile) {
+      tile = matrix.readTile(s / columns, s % columns);
+      return not tile.isEmpty();
+    }, 
+    [&](int s, Matrix<T>& tile) {
+      return result.writeTile(s / columns, s % columns, 
+          applyFunctorToMatrixAndScalar(matrix_execution::par, tile, scalar, 
+                                        functor));
+    });
+  return success ? result : TiledMatrix<R>();
+}
+
+/*
+	The arithmetic operators of matrix_operators.h, the results go to 
+	temporary files.
+*/
+
+#define TILED_MATRIX_OPERATOR(OP)                                           \
+template <typename T, typename K>                                           \
+inline auto operator OP(const TiledMatrix<T>& matrix1,                      \
+                        const TiledMatrix<K>& matrix2)                      \
+    -> TiledMatrix<decltype(T() OP K())> {                                  \
+  INSTRUMENT_OPERATION("operator" #OP, matrix1.numberOfCells(),             \
+      matrix1.numberOfCells(),                                              \
+      (sizeof(T) + sizeof(K) + sizeof(T() OP K())) *                        \
+      matrix1.numberOfCells());                                             \
+  return applyFunctorToMatrices(matrix1, matrix2,                           \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const TiledMatrix<T>& matrix, const K& value)       \
+    -> TiledMatrix<decltype(T() OP K())> {                                  \
+  INSTRUMENT_OPERATION("operator" #OP, matrix.numberOfCells(),              \
+      matrix.numberOfCells(),                                               \
+      (sizeof(T) + sizeof(T() OP K())) * matrix.numberOfCells());           \
+  return applyFunctorToMatrixAndScalar(matrix, value,                       \
+    [](const T& x, const K& y) {                                            \
+      return x OP y;                                                        \
+  });                                                                       \
+}                                                                           \
+                                                                            \
+template <typename T, typename K>                                           \
+inline auto operator OP(const K& value, const TiledMatrix<T>& matrix)       \
+    -> TiledMatrix<decltype(K() OP T())> {                                  \
+  INSTRUMENT_OPERATION("operator" #OP, matrix.numberOfCells(),              \
+      matrix.numberOfCells(),                                               \
+      (sizeof(T) + sizeof(K() OP T())) * matrix.numberOfCells());           \
+  return applyFunctorToMatrixAndScalar(matrix, value,                       \
+    [](const T& x, const K& y) {                                            \
+      return y OP x;                                                        \
+  });                                                                       \
+}
+
+TILED_MATRIX_OPERATOR(*)
+TILED_MATRIX_OPERATOR(/)
+TILED_MATRIX_OPERATOR(+)
+TILED_MATRIX_OPERATOR(-)
+
+#undef TILED_MATRIX_OPERATOR
+
+#endif // TILED_MATRICES_H
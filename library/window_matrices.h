@@ -0,0 +1,359 @@
+/*
+  @file window_matrices.h Sliding windows of rows over a ring buffer
+  ©2015 Christian González León
+  
+  The MIT License (MIT)
+
+  Copyright (c) 2015 Christian González León
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+ */
+
+#ifndef WINDOW_MATRICES_H
+#define WINDOW_MATRICES_H
+
+#include <algorithm>
+#include <vector>
+
+/*
+	The running statistics a WindowMatrix keeps up to date on every push
+	and pop of a row:
+	
+	  None        nothing, a tick only copies the row.
+	  Means       the sums and means of the columns, O(columns) per tick.
+	  Covariance  besides, the sample covariance of the columns by 
+	              Welford's updates, O(columns^2 / 2) per tick.
+	
+	The removals round a little on every tick, so a second set of 
+	statistics is kept by additions only from the rows pushed since it 
+	started, and it replaces the running one as soon as it covers the 
+	whole window, at most every capacity rows popped. That bounds the 
+	error at twice the cost of a push, and no tick costs more than that.
+*/
+enum class WindowStatistics { None, Means, Covariance };
+
+/**
+ * WindowMatrix class
+ * The last rows pushed, at most capacity of them, in a ring buffer: 
+ * pushing a row to a full window drops the oldest one, and both are O(1)
+ * besides copying the row and updating the statistics.
+ * Row 0 is the oldest one. The rows are contiguous in memory in at most 
+ * two segments, the ones from the oldest row to the end of the buffer 
+ * and the ones wrapped around to its beginning; the products below walk
+ * them directly.
+ */
+template <typename T>
+class WindowMatrix {
+ public:
+  /**
+   * Consecutive rows of the window stored contiguously.
+   */
+  struct Segment {
+    const T* cells;
+    int rows;
+  };
+  
+  WindowMatrix(int capacity, int columns, 
+               WindowStatistics statistics = WindowStatistics::Means);
+  
+  int getRows() const { return count; }
+  int getColumns() const { return columns; }
+  int getCapacity() const { return capacity; }
+  int numberOfCells() const { return count * columns; }
+  bool isEmpty() const { return count == 0; }
+  bool isFull() const { return count == capacity; }
+  template <typename Other>
+  bool hasSameDimensionsAs(const Other& other) const {
+    return count == other.getRows() and columns == other.getColumns();
+  }
+  
+  const T* operator[](int row) const { 
+    return cells.data() + static_cast<size_t>(physicalRow(row)) * columns; 
+  }
+  const T& operator()(int row, int column) const { 
+    return (*this)[row][column]; 
+  }
+  int getSegments(Segment (&segments)[2]) const;
+  
+  bool pushRow(const T* row);
+  bool pushRow(const std::vector<T>& row) {
+    return static_cast<int>(row.size()) == columns and pushRow(row.data());
+  }
+  bool popRow();
+  void clear();
+  
+  std::vector<T> getSums() const { return running.sums; }
+  std::vector<T> getMeans() const;
+  SymmetricMatrix<T> getCovariance() const;
+  Matrix<T> toMatrix() const;
+ private:
+  std::vector<T> cells;
+  int capacity, columns;
+  int first, count;
+  WindowStatistics statistics;
+  /**
+   * The statistics of the newest rows of the window, rows of them.
+   */
+  struct Statistics {
+    std::vector<T> sums;
+    std::vector<T> means;
+    SymmetricMatrix<T> scatter;
+    int rows;
+  };
+  Statistics running, fresh;
+  std::vector<T> delta;
+  
+  int physicalRow(int row) const {
+    const int physical = first + row;
+    return physical < capacity ? physical : physical - capacity;
+  }
+  void addStatistics(Statistics& accumulated, const T* row);
+  void removeStatistics(Statistics& accumulated, const T* row);
+  void resetStatistics(Statistics& accumulated);
+};
+
+template <typename T>
+WindowMatrix<T>::WindowMatrix(int capacity, int columns, 
+    WindowStatistics statistics) 
+    : cells (static_cast<size_t>(std::max(0, capacity)) * 
+             std::max(0, columns)), 
+      capacity (std::max(0, capacity)), columns (std::max(0, columns)), 
+      first (0), count (0), statistics (statistics) {
+  if (statistics == WindowStatistics::Covariance) {
+    delta.resize(this->columns);
+  }
+  resetStatistics(running);
+  resetStatistics(fresh);
+}
+
+template <typename T>
+int WindowMatrix<T>::getSegments(Segment (&segments)[2]) const {
+  if (count == 0) return 0;
+  const int head = std::min(count, capacity - first);
+  segments[0] = Segment{(*this)[0], head};
+  if (head == count) return 1;
+  segments[1] = Segment{cells.data(), count - head};
+  return 2;
+}
+
+/**
+ * A full window drops its oldest row first.
+ */
+template <typename T>
+bool WindowMatrix<T>::pushRow(const T* row) {
+  if (capacity == 0) return false;
+  if (count == capacity) popRow();
+  const size_t offset = static_cast<size_t>(physicalRow(count)) * columns;
+  std::copy(row, row + columns, cells.data() + offset);
+  count++;
+  addStatistics(running, row);
+  addStatistics(fresh, row);
+  return true;
+}
+
+template <typename T>
+bool WindowMatrix<T>::popRow() {
+  if (count == 0) return false;
+  const T* row = (*this)[0];
+  // A fresh holding the oldest row holds them all, it starts over
+  if (fresh.rows == count) resetStatistics(fresh);
+  first = first + 1 == capacity ? 0 : first + 1;
+  count--;
+  removeStatistics(running, row);
+  // The rows of fresh are the newest ones, all of the window now
+  if (statistics != WindowStatistics::None and fresh.rows == count) {
+    std::swap(running, fresh);
+    resetStatistics(fresh);
+  }
+  return true;
+}
+
+template <typename T>
+void WindowMatrix<T>::clear() {
+  first = count = 0;
+  resetStatistics(running);
+  resetStatistics(fresh);
+}
+
+/**
+ * Welford's update of the means and of the scatter matrix, the sum of 
+ * the outer products of the deviations: S += (x - m_old)(x - m_new)^T.
+ */
+template <typename T>
+void WindowMatrix<T>::addStatistics(Statistics& accumulated, const T* row) {
+  if (statistics == WindowStatistics::None) return;
+  accumulated.rows++;
+  for (int j = 0; j < columns; j++) {
+    accumulated.sums[j] += row[j];
+  }
+  if (statistics != WindowStatistics::Covariance) return;
+  std::vector<T>& means = accumulated.means;
+  for (int j = 0; j < columns; j++) {
+    delta[j] = row[j] - means[j];
+    means[j] += delta[j] / accumulated.rows;
+  }
+  for (int i = 0; i < columns; i++) {
+    T* scatterRow = accumulated.scatter.packedRow(i);
+    const T factor = delta[i];
+    for (int j = 0; j <= i; j++) {
+      scatterRow[j] += factor * (row[j] - means[j]);
+    }
+  }
+}
+
+/**
+ * The inverse update of the oldest row:
+ * m_new = m_old - (x - m_old) / rows and S -= (x - m_old)(x - m_new)^T,
+ * with rows the ones left.
+ */
+template <typename T>
+void WindowMatrix<T>::removeStatistics(Statistics& accumulated, 
+                                       const T* row) {
+  if (statistics == WindowStatistics::None) return;
+  if (--accumulated.rows == 0) {
+    resetStatistics(accumulated);
+    return;
+  }
+  for (int j = 0; j < columns; j++) {
+    accumulated.sums[j] -= row[j];
+  }
+  if (statistics != WindowStatistics::Covariance) return;
+  std::vector<T>& means = accumulated.means;
+  for (int j = 0; j < columns; j++) {
+    delta[j] = row[j] - means[j];
+    means[j] -= delta[j] / accumulated.rows;
+  }
+  for (int i = 0; i < columns; i++) {
+    T* scatterRow = accumulated.scatter.packedRow(i);
+    const T factor = delta[i];
+    for (int j = 0; j <= i; j++) {
+      scatterRow[j] -= factor * (row[j] - means[j]);
+    }
+  }
+}
+
+template <typename T>
+void WindowMatrix<T>::resetStatistics(Statistics& accumulated) {
+  accumulated.rows = 0;
+  if (statistics == WindowStatistics::None) return;
+  accumulated.sums.assign(columns, T());
+  if (statistics != WindowStatistics::Covariance) return;
+  accumulated.means.assign(columns, T());
+  accumulated.scatter = SymmetricMatrix<T>(columns);
+}
+
+/**
+ * Empty without statistics or rows.
+ */
+template <typename T>
+std::vector<T> WindowMatrix<T>::getMeans() const {
+  if (statistics == WindowStatistics::Covariance) return running.means;
+  std::vector<T> result;
+  if (statistics == WindowStatistics::None or count == 0) return result;
+  for (const T& sum : running.sums) {
+    result.push_back(sum / count);
+  }
+  return result;
+}
+
+/**
+ * The sample covariance of the columns over the rows of the window, as 
+ * covarianceMatrix gives. It is empty unless the window keeps it and 
+ * holds at least two rows.
+ */
+template <typename T>
+SymmetricMatrix<T> WindowMatrix<T>::getCovariance() const {
+  if (statistics != WindowStatistics::Covariance or count < 2) return {};
+  SymmetricMatrix<T> covariance = running.scatter;
+  for (int i = 0; i < columns; i++) {
+    T* row = covariance.packedRow(i);
+    for (int j = 0; j <= i; j++) {
+      row[j] /= count - 1;
+    }
+  }
+  return covariance;
+}
+
+template <typename T>
+Matrix<T> WindowMatrix<T>::toMatrix() const {
+  Matrix<T> resultingMatrix(count, columns);
+  for (int i = 0; i < count; i++) {
+    std::copy((*this)[i], (*this)[i] + columns, &resultingMatrix(i, 0));
+  }
+  return resultingMatrix;
+}
+
+/**
+ * window * matrix, each row of the window scales the rows of matrix into
+ * a row of the result.
+ */
+template <typename T, typename K>
+auto multiplyMatrices(const WindowMatrix<T>& window, const Matrix<K>& matrix)
+    -> Matrix<decltype(T() * K())> {
+  typedef decltype(T() * K()) R;
+  if (window.getColumns() != matrix.getRows() or window.isEmpty()) return {};
+  const int depth = window.getColumns();
+  const int columns = matrix.getColumns();
+  Matrix<R> resultingMatrix(window.getRows(), columns);
+  parallelFor(0, window.getRows(), 
+              rowsPerChunk(columns, PARALLEL_THRESHOLD / std::max(1, depth)),
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        accumulateRowProduct(window[i], matrix, 0, depth, 0, columns, 
+                             &resultingMatrix(i, 0));
+      }
+  });
+  return resultingMatrix;
+}
+
+/**
+ * matrix * window, every cell of matrix scales a row of the window, 
+ * which are read segment by segment.
+ */
+template <typename T, typename K>
+auto multiplyMatrices(const Matrix<T>& matrix, const WindowMatrix<K>& window)
+    -> Matrix<decltype(T() * K())> {
+  typedef decltype(T() * K()) R;
+  if (matrix.getColumns() != window.getRows() or window.isEmpty()) return {};
+  const int columns = window.getColumns();
+  typename WindowMatrix<K>::Segment segments[2];
+  const int segmentCount = window.getSegments(segments);
+  Matrix<R> resultingMatrix(matrix.getRows(), columns);
+  parallelFor(0, matrix.getRows(), 
+    rowsPerChunk(columns, PARALLEL_THRESHOLD / std::max(1, window.getRows())),
+    [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        const T* row1 = matrix[i].data();
+        R* resultingRow = &resultingMatrix(i, 0);
+        int k = 0;
+        for (int s = 0; s < segmentCount; s++) {
+          const K* row2 = segments[s].cells;
+          for (int r = 0; r < segments[s].rows; r++, k++, row2 += columns) {
+            const T value = row1[k];
+            for (int j = 0; j < columns; j++) {
+              resultingRow[j] += value * row2[j];
+            }
+          }
+        }
+      }
+  });
+  return resultingMatrix;
+}
+
+#endif // WINDOW_MATRICES_H
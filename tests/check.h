@@ -0,0 +1,34 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+#include <cmath>
+#include "matrices.h"
+
+/*
+	Helpers of the behavior tests: every check prints its description and
+	the main function of a test returns the number of failed checks.
+*/
+
+int failures = 0;
+
+void check(bool condition, const char* description) {
+  std::cout << (condition ? "ok      " : "FAILED  ") << description
+            << std::endl;
+  if (not condition) failures++;
+}
+
+template <typename A, typename B>
+double largestDifference(const A& matrix1, const B& matrix2) {
+  if (not matrix1.hasSameDimensionsAs(matrix2)) return INFINITY;
+  double difference = 0;
+  for (int i = 0; i < matrix1.getRows(); i++) {
+    for (int j = 0; j < matrix1.getColumns(); j++) {
+      difference = std::max(difference,
+                            std::abs(double(matrix1(i, j) - matrix2(i, j))));
+    }
+  }
+  return difference;
+}
+
+#endif // CHECK_H
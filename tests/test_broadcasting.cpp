@@ -0,0 +1,82 @@
+#include <iostream>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Elementwise operations between a matrix and a row or a column, also
+	when they are transposed views, and in place.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+int main() {
+
+  const Doubles a = {{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}};
+  const Doubles row = {{10, 20, 30, 40}};
+  const Doubles columnAsRow = {{100, 200, 300}};
+  const Doubles column = columnAsRow.transpose();
+  const Doubles rowAsColumn = row.transpose();
+  const Doubles other(2, 3), transposable(4, 3);
+
+  Doubles sums(3, 4), products(3, 4), outer(3, 4);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      sums(i, j) = a(i, j) + row(0, j);
+      products(i, j) = a(i, j) * column(i, 0);
+      outer(i, j) = column(i, 0) - row(0, j);
+    }
+  }
+
+  check(largestDifference(a + row, sums) == 0, "matrix + row");
+  check(largestDifference(row + a, sums) == 0, "row + matrix");
+  check(largestDifference(a * column, products) == 0, "matrix * column");
+  check(largestDifference(column - row, outer) == 0, "column - row");
+  check(largestDifference(a + rowAsColumn.transpose(), sums) == 0,
+        "matrix + transposed column");
+  check(largestDifference(a + rowAsColumn.transposedView(), sums) == 0 and
+        largestDifference(rowAsColumn.transposedView() + a, sums) == 0,
+        "matrix + transposed view of a column");
+  check(largestDifference(a * columnAsRow.transposedView(), products) == 0,
+        "matrix * transposed view of a row");
+  check(largestDifference(columnAsRow.transposedView() -
+                          rowAsColumn.transposedView(), outer) == 0,
+        "two transposed views");
+  check(largestDifference(a.transposedView() + rowAsColumn,
+                          a.transpose() + rowAsColumn) == 0,
+        "transposed view of a matrix + column");
+  check(largestDifference(a + transposable.transposedView(), a) == 0,
+        "transposed view of the same dimensions");
+  check((a + Doubles(2, 4)).isEmpty() and
+        (a + other.transposedView()).isEmpty(),
+        "operands that do not broadcast give an empty result");
+
+  Doubles b = a;
+  b += row;
+  check(largestDifference(b, sums) == 0, "+= row");
+  b = a;
+  b *= column;
+  check(largestDifference(b, products) == 0, "*= column");
+  b = a;
+  b += rowAsColumn.transposedView();
+  check(largestDifference(b, sums) == 0, "+= transposed view of a column");
+  b = a;
+  b *= columnAsRow.transposedView();
+  check(largestDifference(b, products) == 0, "*= transposed view of a row");
+  b = a;
+  b -= other.transposedView();
+  check(largestDifference(b, a) == 0,
+        "a compound operator that does not broadcast changes nothing");
+  b = row;
+  b += a;
+  check(largestDifference(b, row) == 0,
+        "nor does broadcasting the matrix being assigned");
+
+  Doubles square = {{1, 2}, {3, 4}};
+  square += square.transposedView();
+  check(largestDifference(square, Doubles{{2, 5}, {5, 8}}) == 0,
+        "+= its own transpose");
+
+  return failures;
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Column major matrices against the same cells in a Matrix: the column
+	order of raw data, the products of the three layouts, the transpose
+	as a relabelling of the storage and the elementwise operators with
+	both layouts.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+typedef ColumnMajorMatrix<double> Columns;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = sin(i * seed + j + 1);
+    }
+  }
+  return matrix;
+}
+
+int main() {
+
+  static_assert(is_same<LayoutMatrix<double, Layout::RowMajor>,
+                        Doubles>::value and
+                is_same<LayoutMatrix<double, Layout::ColumnMajor>,
+                        Columns>::value, "LayoutMatrix");
+
+  // (i, j) at i + j rows
+  vector<double> data(12);
+  for (int k = 0; k < 12; k++) {
+    data[k] = k;
+  }
+  const Columns fromData(3, 4, data.data());
+  bool columnOrder = fromData.getRows() == 3 and fromData.getColumns() == 4;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      columnOrder = columnOrder and fromData(i, j) == i + 3 * j;
+    }
+  }
+  check(columnOrder and fromData.column(2) == vector<double>({6, 7, 8}),
+        "the data constructor reads the cells in column order");
+  vector<double> copied(12, -1);
+  fromData.copyTo(copied.data());
+  check(copied == data, "copyTo gives back the data");
+  const Doubles cells = sample(5, 7, 3);
+  const Columns converted(cells);
+  vector<double> raw(35);
+  converted.copyTo(raw.data());
+  check(largestDifference(Columns(5, 7, raw.data()).toMatrix(), cells) == 0
+        and largestDifference(converted.toMatrix(), cells) == 0 and
+        converted.getLayout() == Layout::ColumnMajor,
+        "a Matrix through copyTo and back");
+  check(largestDifference(Columns{{1, 2, 3}, {4, 5, 6}}.toMatrix(),
+                          Doubles{{1, 2, 3}, {4, 5, 6}}) == 0 and
+        Columns(2, 3, 1.5)(1, 2) == 1.5 and Columns().isEmpty(),
+        "the other constructors");
+
+  // Products of every pair of layouts, small and past the blocks of 64
+  bool products = true;
+  for (int n : {3, 37, 130}) {
+    const Doubles a = sample(n, n + 5, 2), b = sample(n + 5, n - 1, 5);
+    const Doubles expected = multiplyMatrices(a, b);
+    const Columns columnsA(a), columnsB(b);
+    const Columns both = multiplyMatrices(columnsA, columnsB);
+    const Doubles right = multiplyMatrices(a, columnsB);
+    const Doubles left = multiplyMatrices(columnsA, b);
+    products = products and
+        largestDifference(both.toMatrix(), expected) < 1e-12 * n and
+        largestDifference(right, expected) < 1e-12 * n and
+        largestDifference(left, expected) < 1e-12 * n;
+  }
+  check(products, "column major products against Matrix products");
+  check(multiplyMatrices(Columns(converted), Columns(converted)).isEmpty(),
+        "a product of other dimensions is empty");
+
+  Columns relabelled(cells);
+  const Doubles* storage = &relabelled.transpose();
+  check(largestDifference(relabelled.transpose(), cells.transpose()) == 0 and
+        &relabelled.transpose() == storage,
+        "transpose is the storage itself");
+  const Doubles moved = move(relabelled).transpose();
+  check(largestDifference(moved, cells.transpose()) == 0,
+        "transpose of an rvalue moves the storage");
+  const Doubles rows = sample(4, 6, 7);
+  const Columns fromColumns = Columns::fromColumns(Doubles(rows));
+  check(fromColumns.getRows() == 6 and fromColumns.getColumns() == 4 and
+        largestDifference(fromColumns.toMatrix(), rows.transpose()) == 0,
+        "fromColumns relabels a Matrix as its transpose");
+
+  const Doubles other = sample(5, 7, 4);
+  const Columns otherColumns(other);
+  const auto sum = converted + otherColumns;
+  const auto mixed = converted * other;
+  const auto reversed = other - converted;
+  static_assert(is_same<decltype(sum), const Columns>::value and
+                is_same<decltype(mixed), const Doubles>::value and
+                is_same<decltype(reversed), const Doubles>::value,
+                "result layouts");
+  check(largestDifference(sum.toMatrix(), cells + other) == 0 and
+        largestDifference(mixed, cells * other) == 0 and
+        largestDifference(reversed, other - cells) == 0 and
+        largestDifference((converted / otherColumns).toMatrix(),
+                          cells / other) == 0,
+        "elementwise operators of both layouts");
+  check(largestDifference((2.0 - converted).toMatrix(), 2.0 - cells) == 0 and
+        largestDifference((converted * 3.0).toMatrix(), cells * 3.0) == 0 and
+        largestDifference((-converted).toMatrix(), -cells) == 0 and
+        (converted + Columns(2, 2)).isEmpty() and
+        (converted + Doubles(7, 5)).isEmpty(),
+        "scalars and other dimensions");
+  Columns compound(cells);
+  compound += other;
+  compound *= otherColumns;
+  compound -= 1.0;
+  check(largestDifference(compound.toMatrix(), (cells + other) * other - 1.0)
+        == 0, "compound operators with both layouts");
+  Columns resized(cells);
+  check(resized.insertRow(5, 1.0) and resized.deleteColumn(0) and
+        resized.getRows() == 6 and resized.getColumns() == 6 and
+        resized(5, 0) == 1 and resized(0, 0) == cells(0, 1),
+        "rows and columns of the matrix, not of the storage");
+
+  return failures;
+}
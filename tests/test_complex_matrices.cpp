@@ -0,0 +1,95 @@
+#include <iostream>
+#include <complex>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Complex products by the Standard and 3M methods over split planes,
+	and with the plain kernel below COMPLEX_SPLIT_THRESHOLD result cells,
+	against naive products in long double.
+*/
+
+using namespace std;
+
+typedef complex<double> Complex;
+typedef Matrix<Complex> Complexes;
+
+Complexes sample(int rows, int columns, int seed) {
+  Complexes matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = Complex(sin(i * seed + j + 1), cos(i + j * seed));
+    }
+  }
+  return matrix;
+}
+
+// The largest error of product against the naive product of a and b,
+// relative to the sum of the magnitudes of the terms of the cell
+template <typename A, typename B>
+double productError(const Complexes& product, const Matrix<A>& a,
+                    const Matrix<B>& b) {
+  if (product.getRows() != a.getRows() or
+      product.getColumns() != b.getColumns()) {
+    return HUGE_VAL;
+  }
+  double worst = 0;
+  for (int i = 0; i < a.getRows(); i++) {
+    for (int j = 0; j < b.getColumns(); j++) {
+      complex<long double> sum = 0;
+      long double magnitudes = 0;
+      for (int k = 0; k < a.getColumns(); k++) {
+        const complex<long double> x(a(i, k)), y(b(k, j));
+        sum += x * y;
+        magnitudes += abs(x) * abs(y);
+      }
+      const long double error = abs(complex<long double>(product(i, j)) -
+                                    sum);
+      worst = max(worst, double(error / max(magnitudes, 1e-300L)));
+    }
+  }
+  return worst;
+}
+
+int main() {
+
+  // Result cells on both sides of COMPLEX_SPLIT_THRESHOLD
+  bool standard = true, threeM = true;
+  const int shapes[][3] = {{15, 17, 9}, {16, 16, 9}, {1, 255, 40},
+                           {1, 256, 40}, {70, 90, 130}};
+  for (const auto& shape : shapes) {
+    const Complexes a = sample(shape[0], shape[2], 2);
+    const Complexes b = sample(shape[2], shape[1], 3);
+    standard = standard and productError(multiplyComplexMatrices(a, b,
+        ComplexMultiplication::Standard), a, b) < 1e-15 * shape[2] and
+        productError(multiplyMatrices(a, b), a, b) < 1e-15 * shape[2];
+    threeM = threeM and productError(multiplyComplexMatrices(a, b,
+        ComplexMultiplication::ThreeM), a, b) < 4e-15 * shape[2];
+  }
+  check(standard, "Standard complex products");
+  check(threeM, "3M complex products");
+
+  Matrix<double> real(90, 70);
+  for (int i = 0; i < 90; i++) {
+    for (int j = 0; j < 70; j++) {
+      real(i, j) = 2 * sin(i * 5 + j);
+    }
+  }
+  const Complexes a = sample(60, 90, 7), b = sample(70, 50, 11);
+  check(productError(multiplyMatrices(a, real), a, real) < 1e-13 and
+        productError(multiplyMatrices(real, b), real, b) < 1e-13,
+        "complex times real and real times complex");
+
+  const Complexes empty = multiplyComplexMatrices(sample(20, 0, 1),
+      sample(0, 30, 1), ComplexMultiplication::ThreeM);
+  check(empty.getRows() == 20 and empty.getColumns() == 30 and
+        productError(empty, sample(20, 0, 1), sample(0, 30, 1)) == 0,
+        "a product over no terms is zero");
+  check(multiplyComplexMatrices(a, a).isEmpty() and
+        multiplyMatrices(a, Matrix<double>(80, 3)).isEmpty() and
+        multiplyMatrices(real, real).isEmpty(),
+        "products of other dimensions are empty");
+
+  return failures;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <complex>
+#include <string>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Conversions between matrices of different cell types: the copying
+	ones leave the source as it was, the ones from an rvalue move every
+	cell and leave the source empty.
+*/
+
+using namespace std;
+
+// It tells whether it was built from a moved string
+struct Label {
+  string text;
+  bool moved = false;
+  Label() {}
+  Label(const string& value) : text (value) {}
+  Label(string&& value) : text (move(value)), moved (true) {}
+};
+
+Matrix<string> words(int rows, int columns) {
+  Matrix<string> matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = "a long enough word to be on the heap " +
+                     to_string(i * columns + j);
+    }
+  }
+  return matrix;
+}
+
+// Every cell of labels has the text of the same cell of expected
+bool sameText(const Matrix<Label>& labels, const Matrix<string>& expected,
+              bool moved) {
+  if (not labels.hasSameDimensionsAs(expected)) return false;
+  for (int i = 0; i < labels.getRows(); i++) {
+    for (int j = 0; j < labels.getColumns(); j++) {
+      if (labels(i, j).text != expected(i, j) or
+          labels(i, j).moved != moved) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+
+  const Matrix<int> integers = {{1, -2, 3}, {40000, 5, -6}};
+  const Matrix<double> doubles(integers);
+  const Matrix<float> floats(doubles);
+  const Matrix<complex<double>> complexes(doubles);
+  check(largestDifference(doubles, Matrix<double>{{1, -2, 3},
+                                                  {40000, 5, -6}}) == 0 and
+        largestDifference(Matrix<double>(floats), doubles) == 0 and
+        complexes(1, 0) == complex<double>(40000, 0) and
+        integers(0, 1) == -2, "converting constructors");
+  check(Matrix<double>(Matrix<int>()).isEmpty() and
+        Matrix<double>(Matrix<int>(0, 0)).isEmpty(),
+        "an empty matrix converts to an empty one");
+
+  const Matrix<string> expected = words(3, 4);
+  Matrix<string> source = expected;
+  const Matrix<Label> copied(source);
+  check(sameText(copied, expected, false) and
+        source.hasSameDimensionsAs(expected) and
+        source(0, 0) == expected(0, 0) and source(2, 3) == expected(2, 3),
+        "a copy leaves the source cells");
+  const unsigned long version = source.getVersion();
+  const Matrix<Label> moved(move(source));
+  check(sameText(moved, expected, true) and source.isEmpty() and
+        source.getRows() == 0 and source.getColumns() == 0 and
+        source.getVersion() != version,
+        "an rvalue moves the cells and empties the source");
+
+  Matrix<double> target(4, 5, 1.0);
+  const Matrix<double>& reading = target;
+  const double* firstRow = reading[0].data();
+  unsigned long before = target.getVersion();
+  target = integers;
+  check(largestDifference(target, doubles) == 0 and target.getRows() == 2 and
+        target.getColumns() == 3 and reading[0].data() == firstRow and
+        target.getVersion() != before,
+        "assignment reuses the rows of the target");
+  target = Matrix<int>(3, 6, 7);
+  check(largestDifference(target, Matrix<double>(3, 6, 7.0)) == 0,
+        "assignment of a larger matrix");
+  Matrix<Label> labels(1, 1);
+  source = expected;
+  labels = source;
+  const bool copyAssigned = sameText(labels, expected, false) and
+                            source(0, 0) == expected(0, 0);
+  before = source.getVersion();
+  labels = move(source);
+  check(copyAssigned and sameText(labels, expected, true) and
+        source.isEmpty() and source.getVersion() != before,
+        "assignments from an lvalue and from an rvalue");
+  target = Matrix<int>();
+  check(target.isEmpty(), "assignment of an empty matrix");
+
+  return failures;
+}
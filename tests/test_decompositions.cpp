@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Eigenvalue and singular value decompositions, including structured
+	matrices whose eigenvalues cluster around zero, where the convergence
+	tests have to tell the rounding errors apart from the actual values.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+// The largest |A v - lambda v| over the columns of the eigensystem
+double eigenResidual(const Doubles& matrix, const Eigensystem<double>& system) {
+  const Doubles product = multiplyMatrices(matrix, system.vectors);
+  double residual = 0;
+  for (int i = 0; i < product.getRows(); i++) {
+    for (int j = 0; j < product.getColumns(); j++) {
+      residual = max(residual, abs(product(i, j) -
+                                   system.vectors(i, j) * system.values[j]));
+    }
+  }
+  return residual;
+}
+
+// The largest |Q^T Q - I|
+double orthogonalityError(const Doubles& q) {
+  const Doubles product = multiplyMatrices(q.transposedView(), q);
+  return largestDifference(product,
+                           Doubles::identity(q.getColumns(), 1.0));
+}
+
+int main() {
+
+  Doubles small = {{2, 1}, {1, 2}};
+  vector<double> values = symmetricEigenvalues(small);
+  check(values.size() == 2 and abs(values[0] - 3) < 1e-14 and
+        abs(values[1] - 1) < 1e-14, "eigenvalues of a 2 x 2 matrix");
+  check(symmetricEigenvalues(Doubles(2, 3, 1.0)).empty(),
+        "no eigenvalues for a non square matrix");
+
+  // cos(0.01 i j) has most of its eigenvalues at the rounding level
+  for (int rank : {100, 200}) {
+    Doubles cosines(rank, rank);
+    for (int i = 0; i < rank; i++) {
+      for (int j = 0; j < rank; j++) {
+        cosines(i, j) = cos(0.01 * i * j);
+      }
+    }
+    cout << "cos(0.01 i j), rank " << rank << endl;
+    check(symmetricEigenvalues(cosines).size() == size_t(rank),
+          "all the eigenvalues");
+    const Eigensystem<double> all = symmetricEigendecomposition(cosines);
+    check(all.values.size() == size_t(rank) and
+          eigenResidual(cosines, all) < 1e-12 and
+          orthogonalityError(all.vectors) < 1e-12,
+          "the whole eigendecomposition");
+    const Eigensystem<double> largest =
+        symmetricEigendecomposition(cosines, 4);
+    check(largest.values.size() == 4 and
+          abs(largest.values[0] - all.values[0]) < 1e-12 and
+          eigenResidual(cosines, largest) < 1e-12 and
+          orthogonalityError(largest.vectors) < 1e-12,
+          "the largest eigenvalues by inverse iteration");
+  }
+
+  // The symmetric part of sin(7 i + 3 j) has rank 4, the rest of its
+  // singular values are rounding errors
+  const int rank = 250;
+  Doubles sines(rank, rank);
+  for (int i = 0; i < rank; i++) {
+    for (int j = 0; j < rank; j++) {
+      sines(i, j) = (sin(7.0 * i + 3.0 * j) + sin(7.0 * j + 3.0 * i)) / 2;
+    }
+  }
+  cout << "symmetric part of sin(7 i + 3 j), rank " << rank << endl;
+  const vector<double> singular = singularValues(sines);
+  check(singular.size() == size_t(rank) and singular[3] > 1 and
+        singular[4] < 1e-12, "the singular values");
+  const SingularSystem<double> svd = singularValueDecomposition(sines);
+  bool reconstructed = svd.values.size() == size_t(rank);
+  if (reconstructed) {
+    Doubles scaled = svd.u;
+    for (int i = 0; i < rank; i++) {
+      for (int j = 0; j < rank; j++) {
+        scaled(i, j) *= svd.values[j];
+      }
+    }
+    reconstructed = largestDifference(
+        multiplyMatrices(scaled, svd.v.transposedView()), sines) < 1e-12;
+  }
+  check(reconstructed, "U S V^T gives back the matrix");
+  check(svd.values.size() == size_t(rank) and
+        orthogonalityError(svd.v) < 1e-12, "V is orthogonal");
+
+  Doubles wide = {{3, 0, 0}, {0, -2, 0}};
+  const vector<double> wideValues = singularValues(wide);
+  check(wideValues.size() == 2 and abs(wideValues[0] - 3) < 1e-14 and
+        abs(wideValues[1] - 2) < 1e-14, "singular values of a wide matrix");
+
+  return failures;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <random>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	The elementwise functions of float and double matrices, whose errors
+	over sampled inputs must stay within the bounds documented in
+	elementwise_functions.h, measured against long double functions.
+*/
+
+using namespace std;
+
+const int SAMPLES = 200000;
+
+// The error of value in units in the last place of F around expected
+template <typename F>
+double ulps(F value, long double expected) {
+  int exponent;
+  frexpl(expected, &exponent);
+  const long double unit = ldexpl(1, max(exponent,
+      numeric_limits<F>::min_exponent) - numeric_limits<F>::digits);
+  return double(fabsl(value - expected) / unit);
+}
+
+// Inputs spread over [low, high], or by their logarithm
+template <typename F>
+Matrix<F> samples(double low, double high, bool logarithmic = false) {
+  mt19937_64 generator(low * 1000 + high);
+  uniform_real_distribution<double> uniform(0, 1);
+  Matrix<F> matrix(SAMPLES / 500, 500);
+  for (int i = 0; i < matrix.getRows(); i++) {
+    for (int j = 0; j < matrix.getColumns(); j++) {
+      const double t = uniform(generator);
+      matrix(i, j) = F(logarithmic ? low * pow(high / low, t)
+                                   : low + t * (high - low));
+    }
+  }
+  return matrix;
+}
+
+// The largest error of results against reference over the inputs
+template <typename F, typename Reference>
+double worstError(const Matrix<F>& inputs, const Matrix<F>& results,
+                  const Reference& reference) {
+  double worst = 0;
+  for (int i = 0; i < inputs.getRows(); i++) {
+    for (int j = 0; j < inputs.getColumns(); j++) {
+      worst = max(worst, ulps(results(i, j), reference(inputs(i, j))));
+    }
+  }
+  return worst;
+}
+
+template <typename F>
+void checkBounds(const char* type) {
+  const Matrix<F> wide = samples<F>(-1e6, 1e6), narrow = samples<F>(-4, 4);
+  const Matrix<F> positive = samples<F>(1e-30, 1e30, true);
+  const Matrix<F> exponents =
+      samples<F>(numeric_limits<F>::max_exponent10 * -2.3,
+                 numeric_limits<F>::max_exponent10 * 2.3);
+  const auto sigmoidl = [](long double x) { return 1 / (1 + expl(-x)); };
+  const double errors[] = {
+    worstError(exponents, exp(exponents), expl),
+    worstError(positive, log(positive), logl),
+    max(worstError(wide, sin(wide), sinl),
+        worstError(narrow, sin(narrow), sinl)),
+    max(worstError(wide, cos(wide), cosl),
+        worstError(narrow, cos(narrow), cosl)),
+    max(worstError(wide, tan(wide), tanl),
+        worstError(narrow, tan(narrow), tanl)),
+    worstError(narrow, tanh(narrow), tanhl),
+    max(worstError(narrow, sigmoid(narrow), sigmoidl),
+        worstError(exponents, sigmoid(exponents), sigmoidl))
+  };
+  const double bounds[] = {1, 1, 1.5, 1.5, 3.5, 3, 3};
+  const char* names[] = {"exp", "log", "sin", "cos", "tan", "tanh",
+                         "sigmoid"};
+  for (int f = 0; f < 7; f++) {
+    const string name = string(type) + ' ' + names[f] + " within " +
+                        to_string(bounds[f]).substr(0, 3) + " ULP";
+    check(errors[f] <= bounds[f], name.c_str());
+  }
+}
+
+int main() {
+
+  checkBounds<double>("double");
+  checkBounds<float>("float");
+
+  // 1 ULP for float, 2 |y * log(x)| + 1 ULP for double, in float range
+  const Matrix<double> bases = samples<double>(1e-3, 1e3, true);
+  bool withinBound = true;
+  double worstFloat = 0;
+  for (double exponent : {-7.5, -1.0, 0.5, 2.5, 9.25}) {
+    const Matrix<double> powers = elementwisePow(bases, exponent);
+    const Matrix<float> floatBases = Matrix<float>(bases);
+    const Matrix<float> floatPowers = elementwisePow(floatBases,
+                                                     float(exponent));
+    for (int i = 0; i < bases.getRows(); i++) {
+      for (int j = 0; j < bases.getColumns(); j++) {
+        const double x = bases(i, j);
+        withinBound = withinBound and
+            ulps(powers(i, j), powl(x, exponent)) <=
+            2 * abs(exponent * log(x)) + 1;
+        worstFloat = max(worstFloat,
+            ulps(floatPowers(i, j), powl(floatBases(i, j), exponent)));
+      }
+    }
+  }
+  check(withinBound, "double elementwisePow within its bound");
+  check(worstFloat <= 1, "float elementwisePow within 1 ULP");
+
+  return failures;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	The applyFunctor family with the seq, par and par_unseq policies,
+	which must give the same cells, for matrices of one chunk, of a few
+	and, with a small grain size, of many.
+*/
+
+using namespace std;
+using namespace matrix_execution;
+
+typedef Matrix<double> Doubles;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = sin(i * seed + j + 1);
+    }
+  }
+  return matrix;
+}
+
+double cube(double x) { return x * x * x - x; }
+
+double combine(double x, double y) { return x * y + 2 * x - y; }
+
+void addRowIndex(int i, double* first, double* last) {
+  for (double* cell = first; cell != last; cell++) {
+    *cell += i;
+  }
+}
+
+const int OPERATIONS = 9;
+const char* names[OPERATIONS] = {
+  "applyFunctor", "applyFunctor with a matrix", "applyFunctorToMatrices",
+  "applyFunctor with a row and a column", "a row and a column combined",
+  "a column and a matrix combined", "applyFunctorToMatrixAndScalar",
+  "applyFunctorByRows", "applyFunctor of a column major matrix"
+};
+
+// The result of the operation number op of the applyFunctor family
+template <typename Policy>
+Doubles apply(const Policy& policy, int op, const Doubles& a,
+              const Doubles& b, const Doubles& row, const Doubles& column) {
+  Doubles result = a;
+  ColumnMajorMatrix<double> columnMajor(a);
+  switch (op) {
+    case 0: result.applyFunctor(policy, cube); break;
+    case 1: result.applyFunctor(policy, b, combine); break;
+    case 2: return applyFunctorToMatrices(policy, a, b, combine);
+    case 3:
+      result.applyFunctor(policy, row, combine);
+      result.applyFunctor(policy, column, combine);
+      break;
+    case 4: return applyFunctorToMatrices(policy, row, column, combine);
+    case 5: return applyFunctorToMatrices(policy, column, a, combine);
+    case 6: return applyFunctorToMatrixAndScalar(policy, a, 0.5, combine);
+    case 7: result.applyFunctorByRows(policy, addRowIndex); break;
+    case 8:
+      columnMajor.applyFunctor(policy, cube);
+      return columnMajor.toMatrix();
+  }
+  return result;
+}
+
+// The cells given by every policy, with two grain sizes for the
+// parallel ones, are the ones given by seq
+bool samePolicies(int op, const Doubles& a, const Doubles& b,
+                  const Doubles& row, const Doubles& column) {
+  const Doubles expected = apply(seq, op, a, b, row, column);
+  return largestDifference(apply(par, op, a, b, row, column),
+                           expected) == 0 and
+         largestDifference(apply(par_unseq, op, a, b, row, column),
+                           expected) == 0 and
+         largestDifference(apply(par.withGrainSize(100), op, a, b, row,
+                                 column), expected) == 0 and
+         largestDifference(apply(par_unseq.withGrainSize(100), op, a, b,
+                                 row, column), expected) == 0;
+}
+
+int main() {
+
+  bool same[OPERATIONS];
+  fill(same, same + OPERATIONS, true);
+  // Cells below, around and above PARALLEL_THRESHOLD
+  const int shapes[][2] = {{1, 1}, {7, 13}, {181, 181}, {1, 40000},
+                           {40000, 1}, {300, 257}};
+  for (const auto& shape : shapes) {
+    const int rows = shape[0], columns = shape[1];
+    const Doubles a = sample(rows, columns, 3), b = sample(rows, columns, 5);
+    const Doubles row = sample(1, columns, 7), column = sample(rows, 1, 9);
+    for (int op = 0; op < OPERATIONS; op++) {
+      same[op] = same[op] and samePolicies(op, a, b, row, column);
+    }
+  }
+  for (int op = 0; op < OPERATIONS; op++) {
+    check(same[op], names[op]);
+  }
+
+  const Doubles a = sample(300, 257, 3), rows = sample(3, 257, 1);
+  check(samePolicies(1, a, rows, rows, rows) and
+        largestDifference(apply(par, 1, a, rows, rows, rows), a) == 0 and
+        applyFunctorToMatrices(par, a, rows, combine).isEmpty(),
+        "operands which do not broadcast change nothing");
+  bool rethrown = false;
+  try {
+    Doubles result = a;
+    result.applyFunctor(par.withGrainSize(100), [](double x) {
+      if (x > 0.999) throw runtime_error("functor");
+      return x;
+    });
+  } catch (const runtime_error&) {
+    rethrown = true;
+  }
+  check(rethrown, "an exception of the functor reaches the caller");
+
+  return failures;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Low rank updates and downdates of Cholesky and QR factorizations and
+	of inverses, checked against the factorization of the changed matrix.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+Doubles sample(int rows, int columns, double seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = sin(seed * (i + 1) * (j + 1));
+    }
+  }
+  return matrix;
+}
+
+SymmetricMatrix<double> symmetric(const Doubles& matrix) {
+  SymmetricMatrix<double> result(matrix.getRows());
+  for (int i = 0; i < matrix.getRows(); i++) {
+    for (int j = 0; j <= i; j++) {
+      result(i, j) = matrix(i, j);
+    }
+  }
+  return result;
+}
+
+// R^T R of an upper triangular factor
+Doubles gram(const TriangularMatrix<double>& factor) {
+  const Doubles r = factor.toMatrix();
+  return multiplyMatrices(r.transposedView(), r);
+}
+
+int main() {
+
+  const int rank = 8;
+  const Doubles x = sample(20, rank, 1.3);
+  const Doubles a = multiplyMatrices(x.transposedView(), x);
+  CholeskyFactorization<double> cholesky(symmetric(a));
+  check(not cholesky.isEmpty() and
+        largestDifference(gram(cholesky.getFactor()), a) < 1e-12,
+        "Cholesky factorization");
+
+  vector<double> v(rank);
+  for (int i = 0; i < rank; i++) {
+    v[i] = cos(2.0 * i);
+  }
+  Doubles updated = a;
+  for (int i = 0; i < rank; i++) {
+    for (int j = 0; j < rank; j++) {
+      updated(i, j) += v[i] * v[j];
+    }
+  }
+  check(cholesky.update(v) and
+        largestDifference(gram(cholesky.getFactor()), updated) < 1e-12,
+        "update by v v^T");
+  check(cholesky.downdate(v) and
+        largestDifference(gram(cholesky.getFactor()), a) < 1e-12,
+        "downdate by v v^T");
+  check(not cholesky.downdate(vector<double>(rank, 100.0)) and
+        largestDifference(gram(cholesky.getFactor()), a) < 1e-12,
+        "a downdate that is not positive definite changes nothing");
+
+  const Doubles vectors = sample(3, rank, 0.4);
+  check(cholesky.update(vectors) and cholesky.downdate(vectors) and
+        largestDifference(gram(cholesky.getFactor()), a) < 1e-11,
+        "update and downdate by a rank 3 matrix");
+
+  const int removed = 3;
+  Doubles smaller(rank - 1, rank - 1);
+  for (int i = 0, k = 0; i < rank; i++) {
+    if (i == removed) continue;
+    for (int j = 0, l = 0; j < rank; j++) {
+      if (j != removed) smaller(k, l++) = a(i, j);
+    }
+    k++;
+  }
+  check(cholesky.deleteRowAndColumn(removed) and
+        largestDifference(gram(cholesky.getFactor()), smaller) < 1e-12,
+        "delete a row and a column");
+  vector<double> values(rank);
+  for (int j = 0; j < rank; j++) {
+    values[j] = a(removed, j);
+  }
+  check(cholesky.insertRowAndColumn(removed, values) and
+        largestDifference(gram(cholesky.getFactor()), a) < 1e-11,
+        "insert them back");
+
+  const Doubles b = sample(rank, 2, 2.1);
+  check(largestDifference(multiplyMatrices(a, cholesky.solve(b)), b) < 1e-10,
+        "solve A X = B");
+
+  QRFactorization<double> qr(x);
+  check(largestDifference(gram(qr.getR()), a) < 1e-12, "QR factorization");
+  vector<double> row(rank);
+  for (int j = 0; j < rank; j++) {
+    row[j] = sin(3.0 * j);
+  }
+  check(qr.insertRow(5, row) and qr.deleteRow(0), "insert and delete rows");
+  const Doubles& edited = qr.getMatrix();
+  check(edited.getRows() == 20 and
+        largestDifference(gram(qr.getR()),
+            multiplyMatrices(edited.transposedView(), edited)) < 1e-12,
+        "R^T R follows the edited matrix");
+  const Doubles y = sample(edited.getRows(), 1, 0.9);
+  Doubles residual = y;
+  residual -= multiplyMatrices(edited, qr.leastSquares(y));
+  check(largestDifference(multiplyMatrices(edited.transposedView(), residual),
+                          Doubles(rank, 1)) < 1e-12,
+        "least squares residual orthogonal to the columns");
+
+  QRFactorization<double> noColumns(Doubles(5, 0));
+  check(noColumns.insertRow(2, vector<double>()) and noColumns.deleteRow(0) and
+        noColumns.getMatrix().getRows() == 5 and
+        noColumns.leastSquares(Doubles(5, 1)).isEmpty(),
+        "QR factorization of no columns");
+
+  Doubles m = sample(rank, rank, 0.5);
+  for (int i = 0; i < rank; i++) {
+    m(i, i) += 4;
+  }
+  Doubles mInverse = inverse(m);
+  const Doubles identity = Doubles::identity(rank, 1.0);
+  check(largestDifference(multiplyMatrices(m, mInverse), identity) < 1e-12,
+        "inverse");
+  check(inverse(Doubles(3, 3)).isEmpty(), "no inverse of a singular matrix");
+  vector<double> u(rank), w(rank);
+  for (int i = 0; i < rank; i++) {
+    u[i] = cos(1.0 + i);
+    w[i] = sin(2.0 * i) / 2;
+  }
+  for (int i = 0; i < rank; i++) {
+    for (int j = 0; j < rank; j++) {
+      m(i, j) += u[i] * w[j];
+    }
+  }
+  check(shermanMorrisonUpdate(mInverse, u, w) and
+        largestDifference(multiplyMatrices(m, mInverse), identity) < 1e-12,
+        "Sherman-Morrison update of the inverse");
+  const Doubles us = sample(rank, 3, 0.3);
+  const Doubles ws = sample(rank, 3, 0.8);
+  m += multiplyMatrices(us, ws.transposedView());
+  check(woodburyUpdate(mInverse, us, ws) and
+        largestDifference(multiplyMatrices(m, mInverse), identity) < 1e-11,
+        "Woodbury update of the inverse");
+
+  return failures;
+}
@@ -0,0 +1,208 @@
+#define MATRICES_INSTRUMENTATION
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cctype>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	The instrumentation build: the statistics of every operation in a
+	snapshot, and the events of the trace as Chrome trace JSON.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+/**
+ * JsonReader class
+ * It tells whether a text is a single JSON value, and counts the
+ * objects read and the values of some keys on the way.
+ */
+class JsonReader {
+ public:
+  explicit JsonReader(const string& text) : text (text), position (0) {}
+
+  bool isValid() {
+    skipSpaces();
+    if (not readValue()) return false;
+    skipSpaces();
+    return position == text.size();
+  }
+
+  int objects = 0;
+  vector<string> names, phases;
+  vector<double> starts, durations;
+ private:
+  const string& text;
+  size_t position;
+
+  void skipSpaces() {
+    while (position < text.size() and isspace(text[position])) position++;
+  }
+  bool accept(char c) {
+    skipSpaces();
+    if (position < text.size() and text[position] == c) {
+      position++;
+      return true;
+    }
+    return false;
+  }
+  bool readString(string& value) {
+    if (not accept('"')) return false;
+    value.clear();
+    while (position < text.size() and text[position] != '"') {
+      if (text[position] == '\\') position++;
+      value += text[position++];
+    }
+    return accept('"');
+  }
+  bool readNumber(double& value) {
+    skipSpaces();
+    const char* first = text.c_str() + position;
+    char* last;
+    value = strtod(first, &last);
+    if (last == first or not (isdigit(*first) or *first == '-')) {
+      return false;
+    }
+    position += last - first;
+    return true;
+  }
+  bool readValue() {
+    skipSpaces();
+    if (position >= text.size()) return false;
+    string key, value;
+    double number;
+    if (accept('{')) {
+      objects++;
+      if (accept('}')) return true;
+      do {
+        if (not readString(key) or not accept(':')) return false;
+        skipSpaces();
+        if (text[position] == '"') {
+          if (not readString(value)) return false;
+          if (key == "name") names.push_back(value);
+          if (key == "ph") phases.push_back(value);
+        } else if (text[position] == '{' or text[position] == '[') {
+          if (not readValue()) return false;
+        } else {
+          if (not readNumber(number)) return false;
+          if (key == "ts") starts.push_back(number);
+          if (key == "dur") durations.push_back(number);
+        }
+      } while (accept(','));
+      return accept('}');
+    }
+    if (accept('[')) {
+      if (accept(']')) return true;
+      do {
+        if (not readValue()) return false;
+      } while (accept(','));
+      return accept(']');
+    }
+    if (text[position] == '"') return readString(value);
+    return readNumber(number);
+  }
+};
+
+// The statistics of name in the snapshot, calls 0 when it is not there
+instrumentation::OperationStatistics statisticsOf(const string& name) {
+  for (const auto& statistics : instrumentation::snapshot()) {
+    if (statistics.name == name) return statistics;
+  }
+  return instrumentation::OperationStatistics();
+}
+
+int main() {
+
+  const Doubles a(30, 40, 1.0), b(40, 20, 2.0);
+  Doubles product = multiplyMatrices(a, b);
+  instrumentation::reset();
+  check(instrumentation::snapshot().empty(), "reset clears the statistics");
+
+  product = multiplyMatrices(a, b);
+  const auto statistics = statisticsOf("multiplyMatrices");
+  check(statistics.calls == 1 and statistics.cells == 30 * 20 and
+        statistics.flops == 2 * 30 * 40 * 20 and
+        statistics.bytes == 8 * (30 * 40 + 40 * 20 + 30 * 20) and
+        statistics.temporaries >= 1 and statistics.seconds >= 0,
+        "the statistics of a product");
+  for (int i = 0; i < 3; i++) {
+    product = a + a;
+  }
+  product = a.transpose();
+  check(statisticsOf("operator+").calls == 3 and
+        statisticsOf("operator+").cells == 3 * 30 * 40 and
+        statisticsOf("transpose").calls == 1 and
+        statisticsOf("inverse").calls == 0, "calls by name");
+  const auto all = instrumentation::snapshot();
+  bool sorted = all.size() == 3;
+  for (size_t i = 1; i < all.size(); i++) {
+    sorted = sorted and all[i - 1].seconds >= all[i].seconds;
+  }
+  check(sorted, "the snapshot is sorted by decreasing time");
+
+  // Calls from several threads at once
+  instrumentation::reset();
+  vector<thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&a]() {
+      for (int i = 0; i < 50; i++) {
+        Doubles copy = a;
+        copy.applyFunctor([](double x) { return x + 1; });
+      }
+    });
+  }
+  for (thread& worker : threads) {
+    worker.join();
+  }
+  check(statisticsOf("applyFunctor").calls == 200 and
+        statisticsOf("applyFunctor").cells == 200 * 30 * 40,
+        "calls from several threads");
+
+  ostringstream untraced;
+  check(instrumentation::writeChromeTrace(untraced) and
+        JsonReader(untraced.str()).isValid() and
+        untraced.str().find("\"ph\"") == string::npos,
+        "no events while tracing is off");
+
+  instrumentation::reset();
+  instrumentation::setTracing(true);
+  product = multiplyMatrices(a, b);
+  product = a - a;
+  product.applyFunctor([](double x) { return x * 2; });
+  instrumentation::setTracing(false);
+  product = a * 2.0;
+  ostringstream traced;
+  traced << 1.5 << ' ';
+  const size_t start = traced.str().size();
+  check(instrumentation::writeChromeTrace(traced), "the trace is written");
+  traced << 2.25;
+  const string text = traced.str();
+  const string trace = text.substr(start, text.size() - start - 4);
+  JsonReader reader(trace);
+  const bool valid = reader.isValid();
+  check(valid and trace.compare(0, 16, "{\"traceEvents\":[") == 0 and
+        trace.find("\"otherData\":{\"droppedEvents\":0}") != string::npos,
+        "the trace is one JSON object");
+  bool complete = reader.names == vector<string>({"multiplyMatrices",
+                                                  "operator-",
+                                                  "applyFunctor"}) and
+                  reader.phases == vector<string>(3, "X") and
+                  reader.starts.size() == 3 and reader.durations.size() == 3;
+  for (size_t i = 0; complete and i < reader.starts.size(); i++) {
+    complete = reader.durations[i] >= 0 and
+               (i == 0 or reader.starts[i] >= reader.starts[i - 1]);
+  }
+  // The root object, one per event and the args of each, and otherData
+  check(complete and reader.objects == 1 + 2 * 3 + 1,
+        "an X event per traced call, in order");
+  check(text.compare(0, 4, "1.5 ") == 0 and
+        text.compare(text.size() - 4, 4, "2.25") == 0,
+        "the format of the stream is left as it was");
+
+  return failures;
+}
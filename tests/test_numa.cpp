@@ -0,0 +1,132 @@
+#include <iostream>
+#include <vector>
+#include "matrices.h"
+#include "check.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstddef>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+	NUMA placement on whatever machine runs the test, often a single node:
+	the cells and the versions of the matrices never change, and the
+	functions return false or -1 when the system calls are refused, which
+	is forced for the second half of the test with a seccomp filter.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+#ifdef __linux__
+// Every thread of the process gets EPERM from the NUMA system calls
+bool refuseNumaCalls() {
+  const unsigned refused[] = {SYS_mbind, SYS_get_mempolicy,
+                              SYS_set_mempolicy, SYS_sched_setaffinity};
+  vector<sock_filter> filter;
+  filter.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                            offsetof(seccomp_data, nr)));
+  for (unsigned call : refused) {
+    filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, call, 0, 1));
+    filter.push_back(BPF_STMT(BPF_RET | BPF_K,
+                              SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA)));
+  }
+  filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+  sock_fprog program = {static_cast<unsigned short>(filter.size()),
+                        filter.data()};
+  return prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 and
+         syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER,
+                 SECCOMP_FILTER_FLAG_TSYNC, &program) == 0;
+}
+#else
+bool refuseNumaCalls() { return false; }
+#endif
+
+// The cells of matrix are all value
+bool holds(const Doubles& matrix, double value) {
+  for (int i = 0; i < matrix.getRows(); i++) {
+    for (int j = 0; j < matrix.getColumns(); j++) {
+      if (matrix(i, j) != value) return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+
+  const numa::Topology& topology = numa::topology();
+  bool consistent = not topology.nodes.empty() and
+                    topology.cpus.size() == topology.nodes.size() and
+                    not topology.computeNodes.empty();
+  for (int node : topology.computeNodes) {
+    const int index = find(topology.nodes.begin(), topology.nodes.end(),
+                           node) - topology.nodes.begin();
+    consistent = consistent and index < int(topology.nodes.size()) and
+                 not topology.cpus[index].empty() and
+                 topology.nodeOfCpu(topology.cpus[index][0]) == node;
+  }
+  check(consistent and numa::nodeCount() == int(topology.nodes.size()),
+        "topology");
+  check(numa::parseList("0-3,8,10-11") == vector<int>({0, 1, 2, 3, 8, 10, 11})
+        and numa::parseList("").empty(), "lists of the kernel");
+
+  ThreadPool& pool = ThreadPool::instance();
+  const bool pinned = numa::pinThreadPool();
+  check(pool.domainCount() >= 1 and
+        pool.domainCount() <= int(topology.computeNodes.size()),
+        "a pinned pool has a domain per node at most");
+  Doubles matrix(300, 700, 1.5);
+  const unsigned long version = matrix.getVersion();
+  const bool placed = numa::place(matrix, numa::Placement::RowBlocks);
+  const bool interleaved = numa::place(matrix, numa::Placement::Interleaved);
+  const bool onNode = numa::placeOnNode(matrix, topology.computeNodes[0]);
+  check(holds(matrix, 1.5) and matrix.getVersion() == version,
+        "placing keeps the cells and the version");
+  check(not numa::placeOnNode(matrix, -1), "no placement on a bad node");
+  cout << "pinned " << pinned << ", placed " << placed << ' '
+       << interleaved << ' ' << onNode << endl;
+  bool known = true;
+  for (int node : numa::nodesOfRows(matrix)) {
+    known = known and (node == -1 or find(topology.nodes.begin(),
+        topology.nodes.end(), node) != topology.nodes.end());
+  }
+  check(known, "rows on known nodes");
+  check(numa::nodesOfRows(Doubles(3, 0)) == vector<int>(3, -1),
+        "no node for empty rows");
+  check(holds(numa::makeMatrix(200, 300, 2.5, numa::Placement::Interleaved),
+              2.5) and
+        holds(numa::makeMatrix(200, 300, 3.5, numa::Placement::RowBlocks),
+              3.5), "matrices made with a placement");
+  numa::unpinThreadPool();
+  check(pool.domainCount() == 1, "an unpinned pool has no domains");
+
+  if (not refuseNumaCalls()) {
+    cout << "skipped: the system calls cannot be refused here" << endl;
+    return failures;
+  }
+  cout << "with the system calls refused" << endl;
+  // A pool without workers pins no thread, so it cannot fail
+  check(pool.size() == 1 or not numa::pinThreadPool(), "pinning fails");
+  check(pool.size() == 1 or not numa::unpinThreadPool(), "unpinning fails");
+  check(pool.domainCount() == 1, "no domains");
+  check(not numa::place(matrix, numa::Placement::RowBlocks) and
+        not numa::place(matrix, numa::Placement::Interleaved) and
+        not numa::placeOnNode(matrix, topology.computeNodes[0]),
+        "placing fails");
+  check(holds(matrix, 1.5) and matrix.getVersion() == version,
+        "and keeps the cells and the version");
+  check(numa::nodesOfRows(matrix) == vector<int>(matrix.getRows(), -1),
+        "the nodes of the rows are unknown");
+  const Doubles made =
+      numa::makeMatrix(200, 300, 4.5, numa::Placement::Interleaved);
+  check(holds(made, 4.5) and made.getRows() == 200,
+        "a matrix is still made");
+
+  return failures;
+}
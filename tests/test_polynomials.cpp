@@ -0,0 +1,556 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <complex>
+#include <cmath>
+#include "matrix_polynomials.h"
+#include "check.h"
+
+/*
+	Polynomials of the experimental directory checked against schoolbook
+	results, with sizes just below and just above the thresholds where
+	they change of method.
+*/
+
+using namespace std;
+
+typedef Polynomial<double, int> IPolynomial;
+typedef Monomial<double, int> IMon;
+
+vector<double> sampleCoefficients(int count, int seed) {
+  vector<double> coefficients(count);
+  for (int i = 0; i < count; i++) {
+    coefficients[i] = sin(i * seed + 1.0);
+  }
+  return coefficients;
+}
+
+// Sum of the coefficients times the powers of x, in long double
+long double naiveValue(const vector<double>& coefficients, long double x) {
+  long double value = 0;
+  for (int i = 0; i < int(coefficients.size()); i++) {
+    value += coefficients[i] * powl(x, i);
+  }
+  return value;
+}
+
+// The largest error relative to the sum of the magnitudes of the terms
+double evaluationError(const DensePolynomial<double>& polynomial,
+                       const vector<double>& coefficients, bool estrin) {
+  double error = 0;
+  for (double x : {-1.1, -0.7, 0.3, 0.9, 1.05}) {
+    vector<double> magnitudes(coefficients.size());
+    for (int i = 0; i < int(coefficients.size()); i++) {
+      magnitudes[i] = abs(coefficients[i]);
+    }
+    const double value = estrin ? polynomial.evaluateEstrin(x)
+                                : polynomial.evaluate(x);
+    error = max(error, double(abs(value - naiveValue(coefficients, x)) /
+                              naiveValue(magnitudes, abs(x))));
+  }
+  return error;
+}
+
+template <typename T>
+vector<T> schoolbookProduct(const vector<T>& a, const vector<T>& b) {
+  vector<T> product(a.size() + b.size() - 1);
+  for (int i = 0; i < int(a.size()); i++) {
+    for (int j = 0; j < int(b.size()); j++) {
+      product[i + j] += a[i] * b[j];
+    }
+  }
+  return product;
+}
+
+vector<long long> integerCoefficients(int count, long long range) {
+  vector<long long> coefficients(count);
+  for (int i = 0; i < count; i++) {
+    coefficients[i] = (i * 7919LL % 2003 - 1001) * (range / 1001);
+  }
+  return coefficients;
+}
+
+// Every product of two terms, added up by exponent
+template <typename T, typename U>
+map<U, T> naiveProduct(const Polynomial<T, U>& pol1,
+                       const Polynomial<T, U>& pol2) {
+  map<U, T> terms;
+  for (const Monomial<T, U>& mon1 : pol1) {
+    for (const Monomial<T, U>& mon2 : pol2) {
+      terms[mon1.exp + mon2.exp] += mon1.coef * mon2.coef;
+    }
+  }
+  return terms;
+}
+
+// The terms of polynomial are the ones of terms which are not zero
+template <typename T, typename U>
+bool hasTerms(const Polynomial<T, U>& polynomial, map<U, T> terms) {
+  for (auto it = terms.begin(); it != terms.end();) {
+    it = it->second == T() ? terms.erase(it) : next(it);
+  }
+  if (polynomial.size() != int(terms.size())) return false;
+  auto it = terms.rbegin();
+  for (const Monomial<T, U>& monomial : polynomial) {
+    if (monomial.exp != it->first or monomial.coef != it->second) {
+      return false;
+    }
+    ++it;
+  }
+  return true;
+}
+
+// Integers modulo a prime, an exact type which never overflows
+struct Modular {
+  static const long long PRIME = 1000003;
+  long long value;
+  Modular(long long value = 0)
+      : value ((value % PRIME + PRIME) % PRIME) {}
+  Modular operator-() const { return Modular(-value); }
+  Modular& operator+=(const Modular& other) {
+    return *this = Modular(value + other.value);
+  }
+  Modular& operator-=(const Modular& other) {
+    return *this = Modular(value - other.value);
+  }
+  Modular& operator*=(const Modular& other) {
+    return *this = Modular(value * other.value);
+  }
+  // By Fermat's little theorem
+  Modular& operator/=(const Modular& other) {
+    Modular inverse = 1, base = other;
+    for (long long exponent = PRIME - 2; exponent > 0; exponent /= 2) {
+      if (exponent % 2 != 0) inverse *= base;
+      base *= base;
+    }
+    return *this *= inverse;
+  }
+  bool operator==(const Modular& other) const {
+    return value == other.value;
+  }
+  bool operator!=(const Modular& other) const {
+    return value != other.value;
+  }
+};
+
+#define MODULAR_OPERATOR(OP)                                                \
+Modular operator OP(Modular modular1, const Modular& modular2) {            \
+  return modular1 OP##= modular2;                                           \
+}
+
+MODULAR_OPERATOR(+)
+MODULAR_OPERATOR(-)
+MODULAR_OPERATOR(*)
+MODULAR_OPERATOR(/)
+
+#undef MODULAR_OPERATOR
+
+// Real coefficients of the product of (x - root), the roots closed
+// under conjugation
+vector<double> coefficientsFromRoots(const vector<complex<double>>& roots) {
+  vector<complex<double>> product(1, 1.0);
+  for (const complex<double>& root : roots) {
+    product = schoolbookProduct(product, vector<complex<double>>{-root, 1.0});
+  }
+  vector<double> coefficients(product.size());
+  for (size_t i = 0; i < product.size(); i++) {
+    coefficients[i] = product[i].real();
+  }
+  return coefficients;
+}
+
+// The largest distance from an expected root to the nearest computed one
+// not matched yet, relative to the magnitude of the root when above 1
+template <typename T>
+double rootError(vector<complex<T>> computed,
+                 const vector<complex<double>>& expected) {
+  if (computed.size() != expected.size()) return HUGE_VAL;
+  double worst = 0;
+  for (const complex<double>& root : expected) {
+    size_t nearest = 0;
+    for (size_t i = 1; i < computed.size(); i++) {
+      if (abs(complex<double>(computed[i]) - root) <
+          abs(complex<double>(computed[nearest]) - root)) {
+        nearest = i;
+      }
+    }
+    worst = max(worst, abs(complex<double>(computed[nearest]) - root) /
+                       max(1.0, abs(root)));
+    computed.erase(computed.begin() + nearest);
+  }
+  return worst;
+}
+
+int main() {
+
+  // user-032: dense evaluation by Horner's and Estrin's schemes
+  bool accurate = true;
+  for (int count : {1, 2, 3, 5, ESTRIN_BLOCK - 1, ESTRIN_BLOCK,
+                    ESTRIN_BLOCK + 1, 2 * ESTRIN_BLOCK + 3}) {
+    const vector<double> coefficients = sampleCoefficients(count, 3);
+    const DensePolynomial<double> dense(coefficients);
+    accurate = accurate and dense.size() == count and
+               evaluationError(dense, coefficients, false) < 1e-14 and
+               evaluationError(dense, coefficients, true) < 1e-14;
+  }
+  check(accurate, "Horner and Estrin around ESTRIN_BLOCK coefficients");
+  for (int degree : {ESTRIN_DEGREE - 1, ESTRIN_DEGREE, 3 * ESTRIN_DEGREE}) {
+    const vector<double> coefficients = sampleCoefficients(degree + 1, 5);
+    vector<IMon> monomials;
+    for (int i = 0; i <= degree; i++) {
+      monomials.push_back(IMon(coefficients[i], i));
+    }
+    const IPolynomial polynomial(monomials);
+    accurate = accurate and polynomial.isDense() and
+               abs(polynomial.evaluate(0.8) - naiveValue(coefficients, 0.8))
+               < 1e-14;
+  }
+  check(accurate, "Polynomial around ESTRIN_DEGREE");
+  const IPolynomial sparse = {IMon(2, 40), IMon(-1, 3), IMon(0.5, -2)};
+  check(not sparse.isDense() and
+        abs(sparse.evaluate(1.01) - (2 * powl(1.01, 40) - powl(1.01, 3) +
+                                     0.5 / (1.01 * 1.01))) < 1e-13,
+        "a sparse polynomial with a negative exponent");
+  const IPolynomial filled = {IMon(1, 8), IMon(3, 4)};
+  const IPolynomial fuller = {IMon(1, 8), IMon(3, 4), IMon(1, 0)};
+  check(not filled.isDense() and fuller.isDense(),
+        "dense from DENSE_FILL_RATIO of the exponents on");
+  const Polynomial<long long, int> integral = {
+    Monomial<long long, int>(3, 5), Monomial<long long, int>(-2, 1),
+    Monomial<long long, int>(7, 0)};
+  check(integral.isDense() and
+        integral.evaluate(1000) == 3000000000000000LL - 2000 + 7,
+        "integer arguments evaluated in the type of the result");
+
+  // user-033: schoolbook, Karatsuba, FFT and NTT products
+  double productError = 0;
+  for (int n : {KARATSUBA_THRESHOLD - 1, KARATSUBA_THRESHOLD,
+                FFT_THRESHOLD - 1, FFT_THRESHOLD, 3 * FFT_THRESHOLD + 5}) {
+    const vector<double> a = sampleCoefficients(n, 3);
+    const vector<double> b = sampleCoefficients(n + 37, 7);
+    const vector<double> product = multiplyCoefficients(a, b);
+    const vector<double> expected = schoolbookProduct(a, b);
+    for (int i = 0; i < int(expected.size()); i++) {
+      productError = max(productError, abs(product[i] - expected[i]) / n);
+    }
+    productError += product.size() == expected.size() ? 0 : 1;
+  }
+  check(productError < 1e-14,
+        "floating point products around KARATSUBA_ and FFT_THRESHOLD");
+  bool exact = true;
+  for (int n : {KARATSUBA_THRESHOLD - 1, KARATSUBA_THRESHOLD,
+                NTT_THRESHOLD - 1, NTT_THRESHOLD}) {
+    // Coefficients of the product past 1e17, beyond two of the primes
+    const vector<long long> a = integerCoefficients(n, 10000000);
+    const vector<long long> b = integerCoefficients(n + 3, 9999999);
+    exact = exact and multiplyCoefficients(a, b) == schoolbookProduct(a, b);
+  }
+  check(exact, "exact integer products around NTT_THRESHOLD, with Garner");
+  vector<Monomial<long long, int>> terms1, terms2;
+  for (int i = 0; i < 300; i++) {
+    terms1.push_back(Monomial<long long, int>(i % 7 - 3, i + 2));
+    terms2.push_back(Monomial<long long, int>(i % 5 + 1, i));
+  }
+  const Polynomial<long long, int> product =
+      Polynomial<long long, int>(terms1) * Polynomial<long long, int>(terms2);
+  vector<long long> dense1(302), dense2(300);
+  for (int i = 0; i < 300; i++) {
+    dense1[i + 2] = i % 7 - 3;
+    dense2[i] = i % 5 + 1;
+  }
+  check(denseCoefficients(product) == schoolbookProduct(dense1, dense2),
+        "Polynomial::operator*= over the dense coefficients");
+
+  // user-034: sparse products by Johnson's heap and sums by merging
+  vector<Monomial<double, double>> fractional1, fractional2;
+  for (int i = 0; i < 30; i++) {
+    fractional1.push_back(Monomial<double, double>(i % 4 - 1.5, i * 0.5));
+    fractional2.push_back(Monomial<double, double>(i % 3 + 1, i * 0.75));
+  }
+  const Polynomial<double, double> f1(fractional1), f2(fractional2);
+  check(hasTerms(f1 * f2, naiveProduct(f1, f2)),
+        "fractional exponents, with coinciding products");
+  const Polynomial<double, double> binomial = {
+    Monomial<double, double>(1, 1.5), Monomial<double, double>(1, 0)};
+  const Polynomial<double, double> conjugate = {
+    Monomial<double, double>(1, 1.5), Monomial<double, double>(-1, 0)};
+  check((binomial * conjugate).size() == 2, "cancelled terms are dropped");
+  // 20 terms each, the dense product from 400 exponents spanned down
+  bool sparseProducts = true;
+  for (int gap : {1000, 22, 21, 10}) {
+    vector<Monomial<long long, int>> spread1, spread2;
+    for (int i = 0; i < 20; i++) {
+      spread1.push_back(Monomial<long long, int>(i + 1, i * gap / 2));
+      spread2.push_back(Monomial<long long, int>(3 - i, i * gap / 2 + 1));
+    }
+    const Polynomial<long long, int> s1(spread1), s2(spread2);
+    sparseProducts = sparseProducts and
+                     hasTerms(s1 * s2, naiveProduct(s1, s2));
+  }
+  check(sparseProducts, "integer exponents on both sides of the dense "
+                        "product");
+  Polynomial<double, double> sum = f1;
+  sum += -f2;
+  sum += f2;
+  map<double, double> terms;
+  for (const Monomial<double, double>& monomial : f1) {
+    terms[monomial.exp] = monomial.coef;
+  }
+  check(hasTerms(sum, terms) and (f1 + -f1).size() == 0,
+        "sums merged in order");
+
+  // user-035: batched and multipoint evaluation
+  const vector<double> coefficients = sampleCoefficients(20, 11);
+  vector<IMon> monomials;
+  for (int i = 0; i < 20; i++) {
+    monomials.push_back(IMon(coefficients[i], i));
+  }
+  const IPolynomial dense(monomials);
+  const IPolynomial spread = {IMon(2, 31), IMon(-1, 9), IMon(0.5, -3)};
+  bool batched = true;
+  for (int count : {EVALUATION_LANES - 1, EVALUATION_LANES,
+                    EVALUATION_LANES + 1, 3 * EVALUATION_LANES + 5,
+                    EVALUATION_BLOCK - 1, EVALUATION_BLOCK,
+                    EVALUATION_BLOCK + 1}) {
+    vector<double> points(count), values(count), spreadValues(count);
+    for (int p = 0; p < count; p++) {
+      points[p] = 0.5 + cos(p);
+    }
+    dense.evaluate(points.data(), points.data() + count, values.data());
+    spread.evaluate(points.data(), points.data() + count,
+                    spreadValues.data());
+    for (int p = 0; p < count; p++) {
+      const double x = points[p];
+      batched = batched and
+          abs(values[p] - naiveValue(coefficients, x)) <=
+              1e-14 * (1 + abs(values[p])) and
+          abs(spreadValues[p] - spread.evaluate(x)) <=
+              1e-14 * abs(spreadValues[p]);
+    }
+  }
+  check(batched, "batched around EVALUATION_LANES and EVALUATION_BLOCK");
+  vector<double> many(20000);
+  for (int p = 0; p < int(many.size()); p++) {
+    many[p] = sin(p * 0.01);
+  }
+  const vector<double> manyValues = dense.evaluate(many);
+  vector<double> oneByOne(many.size());
+  dense.evaluate(many.data(), many.data() + many.size(), oneByOne.data());
+  check(manyValues == oneByOne and dense.evaluateMultipoint(many) == oneByOne,
+        "a vector in parallel and floating point multipoint");
+  bool multipoint = true;
+  for (int count : {MULTIPOINT_LEAF, MULTIPOINT_LEAF + 1,
+                    4 * MULTIPOINT_LEAF + 3, 300}) {
+    vector<Modular> modularCoefficients(count + 100), points(count);
+    for (int i = 0; i < count + 100; i++) {
+      modularCoefficients[i] = i * 7919LL + 13;
+    }
+    for (int p = 0; p < count; p++) {
+      points[p] = p * 104729LL - 5;
+    }
+    const DensePolynomial<Modular> modular(modularCoefficients);
+    const vector<Modular> values = modular.evaluateMultipoint(points);
+    for (int p = 0; p < count; p++) {
+      multipoint = multipoint and values[p] == modular.evaluate(points[p]);
+    }
+  }
+  check(multipoint, "exact multipoint around MULTIPOINT_LEAF points");
+  const Matrix<double> cells = {{0.1, -0.4, 1.2}, {2.0, -1.5, 0.7}};
+  const Matrix<double> evaluated = evaluateElementwise(spread, cells);
+  bool elementwise = evaluated.hasSameDimensionsAs(cells);
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 3; j++) {
+      elementwise = elementwise and
+          abs(evaluated(i, j) - spread.evaluate(cells(i, j))) <=
+              1e-14 * abs(evaluated(i, j));
+    }
+  }
+  check(elementwise, "every cell of a matrix");
+
+  // user-036: p(A) by Paterson-Stockmeyer against Horner's scheme
+  Matrix<double> a(6, 6);
+  for (int i = 0; i < 6; i++) {
+    for (int j = 0; j < 6; j++) {
+      a(i, j) = 0.3 * sin(i * 5 + j * 3 + 1.0);
+    }
+  }
+  bool matrixPolynomials = true;
+  // A single block up to degree 1, perfect squares change the block size
+  for (int degree : {0, 1, 2, 3, 4, 8, 9, 15, 16, 30}) {
+    const vector<double> matrixCoefficients =
+        sampleCoefficients(degree + 1, 13);
+    vector<IMon> terms;
+    for (int i = 0; i <= degree; i++) {
+      terms.push_back(IMon(matrixCoefficients[i], i));
+    }
+    Matrix<double> horner(6, 6);
+    for (int i = degree; i >= 0; i--) {
+      horner = multiplyMatrices(horner, a) +
+               Matrix<double>::identity(6, matrixCoefficients[i]);
+    }
+    matrixPolynomials = matrixPolynomials and
+        largestDifference(IPolynomial(terms).evaluate(a), horner) < 1e-13;
+  }
+  check(matrixPolynomials, "p(A) of degrees around the perfect squares");
+  const IPolynomial powerPlusOne = {IMon(1, 20), IMon(1, 0)};
+  Matrix<double> twentieth = Matrix<double>::identity(6, 1.0);
+  for (int i = 0; i < 20; i++) {
+    twentieth = multiplyMatrices(twentieth, a);
+  }
+  check(largestDifference(powerPlusOne.evaluate(a),
+                          twentieth + Matrix<double>::identity(6, 1.0))
+        < 1e-15, "a sparse polynomial of a matrix");
+  check(largestDifference(IPolynomial().evaluate(a), Matrix<double>(6, 6))
+        == 0 and IPolynomial(IMon(1, 2)).evaluate(Matrix<double>(2, 3))
+        .isEmpty() and IPolynomial(IMon(1, -2)).evaluate(a).isEmpty(),
+        "zero polynomial, non square matrix and negative exponent");
+
+  // user-037: division by long division and by Newton's reciprocal
+  typedef Polynomial<long long, int> LPolynomial;
+  bool integerDivisions = true, realDivisions = true;
+  for (int n : {NEWTON_DIVISION_THRESHOLD - 1, NEWTON_DIVISION_THRESHOLD,
+                2 * NEWTON_DIVISION_THRESHOLD + 7}) {
+    for (long long leading : {1LL, -1LL, 3LL}) {
+      vector<long long> quotient = integerCoefficients(n, 5000);
+      vector<long long> divisor = integerCoefficients(n + 1, 3000);
+      const vector<long long> remainder = integerCoefficients(n, 1001);
+      quotient.back() = 7;
+      divisor.back() = leading;
+      vector<long long> dividend = schoolbookProduct(quotient, divisor);
+      for (int i = 0; i < n; i++) {
+        dividend[i] += remainder[i];
+      }
+      LPolynomial q, r;
+      integerDivisions = integerDivisions and
+          divmod(polynomialFromCoefficients<long long, int>(dividend),
+                 polynomialFromCoefficients<long long, int>(divisor), q, r)
+          and denseCoefficients(q) == quotient and
+          denseCoefficients(r) == remainder;
+      const vector<double> realQuotient(quotient.begin(), quotient.end());
+      const vector<double> realDivisor(divisor.begin(), divisor.end());
+      const vector<double> realDividend(dividend.begin(), dividend.end());
+      IPolynomial realQ, realR;
+      realDivisions = realDivisions and
+          divmod(polynomialFromCoefficients<double, int>(realDividend),
+                 polynomialFromCoefficients<double, int>(realDivisor),
+                 realQ, realR);
+      const vector<double> computed = denseCoefficients(realQ);
+      const vector<double> computedRemainder = denseCoefficients(realR);
+      for (int i = 0; i < n; i++) {
+        realDivisions = realDivisions and
+            abs(computed[i] - realQuotient[i]) < 1e-6 and
+            abs(computedRemainder[i] - remainder[i]) < 1e-3;
+      }
+    }
+  }
+  check(integerDivisions,
+        "exact integer divmod around NEWTON_DIVISION_THRESHOLD");
+  check(realDivisions,
+        "floating point divmod around NEWTON_DIVISION_THRESHOLD");
+  // Roots inside the unit circle keep the reciprocal series bounded
+  bool newtonDivisions = true;
+  for (int n : {NEWTON_DIVISION_THRESHOLD - 1, NEWTON_DIVISION_THRESHOLD,
+                2 * NEWTON_DIVISION_THRESHOLD + 7}) {
+    const vector<double> quotient = sampleCoefficients(n, 7);
+    vector<double> divisor = sampleCoefficients(n + 1, 13);
+    const vector<double> remainder = sampleCoefficients(n, 21);
+    divisor.back() = 2 * n;
+    vector<double> dividend = schoolbookProduct(quotient, divisor);
+    for (int i = 0; i < n; i++) {
+      dividend[i] += remainder[i];
+    }
+    vector<double> q, r;
+    divideCoefficients(dividend, divisor, q, r);
+    for (int i = 0; i < n; i++) {
+      newtonDivisions = newtonDivisions and
+          abs(q[i] - quotient[i]) < 1e-12 and abs(r[i] - remainder[i]) < 1e-9;
+    }
+  }
+  check(newtonDivisions, "divideCoefficients by a dominant leading term");
+  const LPolynomial square = {Monomial<long long, int>(1, 2),
+                              Monomial<long long, int>(1, 0)};
+  const LPolynomial linear = {Monomial<long long, int>(2, 1),
+                              Monomial<long long, int>(1, 0)};
+  LPolynomial q, r;
+  check(not divmod(square, linear, q, r) and
+        not divmod(square, LPolynomial(), q, r) and
+        not divmod(square, LPolynomial(Monomial<long long, int>(1, -1)),
+                   q, r) and mod(square, LPolynomial()).size() == 0,
+        "divisions out of Z[x] and by zero fail");
+  const LPolynomial cubic = linear * linear * linear;
+  check(denseCoefficients(mod(square, cubic)) == vector<long long>({1, 0, 1}),
+        "mod by a divisor of a higher degree");
+
+  // (x + 2) times other factors, over the integers, the reals and a field
+  const vector<long long> common = {2, 1};
+  const LPolynomial integral1 = polynomialFromCoefficients<long long, int>(
+      schoolbookProduct(common, vector<long long>({-3, 0, 3})));
+  const LPolynomial integral2 = polynomialFromCoefficients<long long, int>(
+      schoolbookProduct(common, vector<long long>({-30, 6})));
+  check(denseCoefficients(gcd(integral1, integral2)) ==
+        vector<long long>({6, 3}), "integer gcd with the gcd of the contents");
+  const IPolynomial real1 = {IMon(2, 2), IMon(2, 1), IMon(-4, 0)};
+  const IPolynomial real2 = {IMon(1, 2), IMon(-1, 1), IMon(-6, 0)};
+  const vector<double> realGcd = denseCoefficients(gcd(real1, real2));
+  check(realGcd.size() == 2 and abs(realGcd[0] - 2) < 1e-12 and
+        realGcd[1] == 1, "floating point gcd is monic");
+  vector<Modular> factor(21), cofactor1(131), cofactor2(61);
+  for (int i = 0; i < 131; i++) {
+    if (i < 21) factor[i] = i * i + 3;
+    if (i < 61) cofactor2[i] = i * 17 + 1;
+    cofactor1[i] = i * 29 + 5;
+  }
+  factor.back() = cofactor1.back() = cofactor2.back() = 1;
+  check(gcdCoefficients(multiplyCoefficients(factor, cofactor1),
+                        multiplyCoefficients(factor, cofactor2)) == factor,
+        "gcd over a field through Newton's divisions");
+
+  // user-038: roots by the Aberth-Ehrlich iteration
+  const complex<double> i1(0, 1);
+  const vector<complex<double>> mixed = {-3.0, 0.5, 2.0 + i1, 2.0 - i1,
+                                         -0.25 + 0.75 * i1, -0.25 - 0.75 * i1,
+                                         7.0, 1e-3};
+  check(rootError(aberthRoots(coefficientsFromRoots(mixed)), mixed) < 1e-10,
+        "real and conjugate roots on both sides of the unit circle");
+  check(rootError(aberthRoots(vector<double>{6, -2}), {3.0}) < 1e-14 and
+        rootError(aberthRoots(vector<double>{1, 0, 1}), {i1, -i1}) < 1e-14 and
+        rootError(aberthRoots(vector<double>{-1, 0, 1}), {1.0, -1.0}) < 1e-14
+        and rootError(aberthRoots(vector<double>{0, -2, 1}), {0.0, 2.0}) <
+        1e-14, "degrees 1 and 2");
+  const vector<complex<double>> distant = {1e30, 1.0, -1e-30};
+  check(rootError(aberthRoots(coefficientsFromRoots(distant)), distant) < 1e-12,
+        "roots far from 1 without overflow");
+  const vector<complex<double>> triple = {1.0, 1.0, 1.0, -2.0};
+  check(rootError(aberthRoots(coefficientsFromRoots(triple)), triple) < 1e-4,
+        "a triple root to the cube root of the rounding error");
+  // x^n - c, with roots just inside and just outside the unit circle,
+  // for n on both sides of the split across the thread pool, whose grain
+  // is PARALLEL_THRESHOLD / n roots
+  bool unitRoots = true;
+  const double pi = acos(-1.0);
+  const int split = sqrt(double(PARALLEL_THRESHOLD));
+  for (int n : {16, split, split + 1}) {
+    for (double c : {0.5, 2.0}) {
+      vector<double> coefficients(n + 1);
+      coefficients[0] = -c;
+      coefficients[n] = 1;
+      vector<complex<double>> expected(n);
+      for (int k = 0; k < n; k++) {
+        expected[k] = pow(c, 1.0 / n) * polar(1.0, 2 * pi * k / n);
+      }
+      unitRoots = unitRoots and
+          rootError(aberthRoots(coefficients), expected) < 1e-12 and
+          rootError(aberthRoots(vector<float>(coefficients.begin(),
+                                              coefficients.end()), 1e-6),
+                    expected) < 1e-5;
+    }
+  }
+  check(unitRoots, "x^n - c in double and float");
+  const IPolynomial shifted = {IMon(1, 5), IMon(-3, 4), IMon(2, 3)};
+  check(rootError(shifted.roots(), {0.0, 0.0, 0.0, 1.0, 2.0}) < 1e-14 and
+        IPolynomial(IMon(4, 0)).roots().empty() and
+        IPolynomial().roots().empty(),
+        "Polynomial::roots with exact zeros from the lowest exponent");
+
+  return failures;
+}
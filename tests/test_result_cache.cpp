@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Matrix versions and the result cache: a result is reused while its
+	operands are unchanged and computed again after any write to them.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = cos(i * seed + j) + (i == j ? rows : 0);
+    }
+  }
+  return matrix;
+}
+
+int main() {
+
+  Doubles a = sample(40, 40, 3);
+  const Doubles b = sample(40, 40, 5);
+  const unsigned long version = a.getVersion();
+  const Doubles& constant = a;
+  check(constant(1, 1) != 0 and a.getVersion() == version,
+        "reading through a const reference keeps the version");
+  a(0, 0) += 1;
+  const unsigned long written = a.getVersion();
+  check(written != version and a.getVersion() == written,
+        "a write changes the version once");
+  a *= 2.0;
+  check(a.getVersion() != written, "so does a mutating member");
+  const unsigned long long serial = a.getSerial();
+  const unsigned long moved = a.getVersion();
+  Doubles c(std::move(a));
+  check(c.getSerial() == serial and c.getVersion() == moved and
+        a.getSerial() != serial, "a moved matrix keeps serial and version");
+
+  ResultCache cache;
+  auto product = cache.multiplyMatrices(c, b);
+  check(largestDifference(*product, multiplyMatrices(c, b)) == 0 and
+        cache.getMisses() == 1, "a miss computes the result");
+  check(cache.multiplyMatrices(c, b) == product and cache.getHits() == 1,
+        "a hit returns the same result");
+  check(cache.multiplyMatrices(b, c) != product, "operands in another order");
+
+  c(3, 4) = 10;
+  auto changed = cache.multiplyMatrices(c, b);
+  check(changed != product and
+        largestDifference(*changed, multiplyMatrices(c, b)) == 0,
+        "a write to an operand invalidates its results");
+  check(largestDifference(*product, multiplyMatrices(c, b)) > 0,
+        "old results stay valid for their holders");
+
+  // A reference is a write when it is taken, so it is taken again
+  double& cell = c(0, 0);
+  cell = 7;
+  auto before = cache.multiplyMatrices(c, b);
+  c(0, 0) = 8;
+  check(cache.multiplyMatrices(c, b) != before,
+        "a write through a new reference after a cached call");
+
+  auto inverse = cache.inverse(b);
+  check(largestDifference(multiplyMatrices(b, *inverse),
+                          Doubles::identity(40, 1.0)) < 1e-12 and
+        cache.inverse(b) == inverse, "a cached inverse");
+  auto eigen = cache.symmetricEigendecomposition(b + b.transpose(), 3);
+  check(eigen->values.size() == 3, "a cached decomposition");
+
+  ResultCache small(resultBytes(*product) + resultBytes(*inverse) / 2);
+  auto first = small.multiplyMatrices(c, b);
+  small.inverse(b);
+  check(small.size() == 1 and small.getMemoryUsage() <= small.getMemoryBudget()
+        and small.multiplyMatrices(c, b) != first,
+        "the least recently used result is evicted");
+
+  cache.clear();
+  check(cache.size() == 0 and cache.getMemoryUsage() == 0, "clear");
+
+  return failures;
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Copy-on-write matrices: copies share the cells until the first write
+	through one of them, which leaves the others as they were.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+typedef SharedMatrix<double> Shared;
+
+int main() {
+
+  const Doubles cells = {{1, 2, 3}, {4, 5, 6}};
+  Shared original(cells);
+  check(not original.isShared(), "a new matrix is not shared");
+  {
+    Shared copy = original;
+    check(original.isShared() and copy.isShared() and
+          &copy.read() == &original.read(), "a copy shares the cells");
+  }
+  check(not original.isShared(), "destroying the copy unshares it");
+
+  Shared copy = original;
+  copy(0, 0) = 9;
+  check(not original.isShared() and not copy.isShared() and
+        copy(0, 0) == 9 and largestDifference(original.read(), cells) == 0,
+        "operator() detaches");
+  const Doubles* storage = &copy.read();
+  copy(1, 1) = 8;
+  check(&copy.read() == storage and copy(1, 1) == 8,
+        "a matrix which is not shared is written in place");
+
+  copy = original;
+  check(copy.insertRow(2, 7.0) and copy.getRows() == 3 and
+        original.getRows() == 2 and not original.isShared(),
+        "insertRow detaches");
+  copy = original;
+  check(copy.deleteColumn(0) and copy.getColumns() == 2 and
+        original.getColumns() == 3, "deleteColumn detaches");
+  copy = original;
+  copy.applyFunctor([](double cell) { return -cell; });
+  check(largestDifference(copy.read(), -1.0 * cells) == 0 and
+        largestDifference(original.read(), cells) == 0,
+        "applyFunctor detaches");
+
+  bool compound = true;
+  Doubles column(2, 1, 1.0);
+  column(1, 0) = 2;
+  for (int op = 0; op < 8; op++) {
+    Shared other = original;
+    const Shared operand = original;
+    Doubles expected = cells;
+    switch (op) {
+      case 0: other *= 2.0; expected *= 2.0; break;
+      case 1: other /= 2.0; expected /= 2.0; break;
+      case 2: other += 2.0; expected += 2.0; break;
+      case 3: other -= 2.0; expected -= 2.0; break;
+      case 4: other *= Shared(column); expected *= column; break;
+      case 5: other /= operand; expected /= cells; break;
+      case 6: other += operand; expected += cells; break;
+      case 7: other -= operand; expected -= cells; break;
+    }
+    compound = compound and not other.isShared() and
+               largestDifference(other.read(), expected) == 0 and
+               largestDifference(original.read(), cells) == 0 and
+               &operand.read() == &original.read();
+  }
+  check(compound, "compound operators detach");
+  Shared doubled = original;
+  doubled += doubled;
+  check(largestDifference(doubled.read(), 2.0 * cells) == 0 and
+        largestDifference(original.read(), cells) == 0,
+        "a matrix added to itself");
+
+  const Shared constCopy = original;
+  check(constCopy(1, 2) == 6 and constCopy[0][1] == 2 and
+        original.isShared() and constCopy.toMatrix()(0, 0) == 1,
+        "reads do not detach");
+  copy = original;
+  copy.write();
+  check(not copy.isShared() and &copy.read() != &original.read(),
+        "write() detaches");
+  copy = original;
+  copy.clear();
+  check(copy.isEmpty() and not copy.isShared() and
+        original.getRows() == 2, "clear drops the shared cells");
+
+  const Shared sum = original + original, product = 2.0 * original;
+  check(largestDifference(sum.read(), product.read()) == 0 and
+        not sum.isShared() and
+        largestDifference(original - cells, Doubles(2, 3)) == 0 and
+        largestDifference((-original).read(), -1.0 * cells) == 0 and
+        (+original).isShared(), "arithmetic operators");
+
+  // Copies written from several threads at once
+  Shared source(100, 100, 1.0);
+  vector<double> sums(4);
+  vector<thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&source, &sums, t]() {
+      Shared own = source;
+      for (int i = 0; i < 100; i++) {
+        own(i, i) = t;
+      }
+      double total = 0;
+      for (int i = 0; i < 100; i++) {
+        for (int j = 0; j < 100; j++) {
+          total += own(i, j);
+        }
+      }
+      sums[t] = total;
+    });
+  }
+  for (thread& worker : threads) {
+    worker.join();
+  }
+  bool independent = not source.isShared();
+  for (int t = 0; t < 4; t++) {
+    independent = independent and sums[t] == 9900 + 100 * t;
+  }
+  check(independent and source(5, 5) == 1, "copies written by threads");
+
+  return failures;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Small matrices in both storages, the cells inside the object and a
+	heap block once they do not fit, checked against Matrix as they grow,
+	shrink, are copied and moved.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+typedef SmallMatrix<double, 4> Small;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = cos(i * seed + j) * 10;
+    }
+  }
+  return matrix;
+}
+
+int main() {
+
+  Small a(2, 2, 1.0);
+  a(0, 1) = 2;
+  check(a.isInline() and
+        largestDifference(a.toMatrix(), Doubles{{1, 2}, {1, 1}}) == 0,
+        "four cells fit inside");
+  check(a.insertRow(2, 5.0) and not a.isInline() and
+        largestDifference(a.toMatrix(), Doubles{{1, 2}, {1, 1}, {5, 5}}) == 0,
+        "insertRow spills to the heap");
+  check(a.insertColumn(0, 7.0) and a.insertColumn(3, 8.0) and
+        largestDifference(a.toMatrix(), Doubles{{7, 1, 2, 8}, {7, 1, 1, 8},
+                                                {7, 5, 5, 8}}) == 0,
+        "insertColumn grows the heap block");
+  check(not a.insertRow(5) and not a.insertColumn(-1) and
+        not a.deleteRow(3) and not a.deleteColumn(4) and
+        a.getRows() == 3 and a.getColumns() == 4,
+        "invalid positions change nothing");
+  check(a.deleteRow(1) and a.deleteColumn(0) and
+        largestDifference(a.toMatrix(), Doubles{{1, 2, 8}, {5, 5, 8}}) == 0,
+        "delete a row and a column");
+
+  Small b = {{1, 2}};
+  check(b.isInline() and b.appendVertically(b, 1) and
+        b.appendVertically(b, 0) and not b.isInline() and
+        largestDifference(b.toMatrix(), Doubles{{1, 2}, {1, 2}, {1, 2},
+                                                {1, 2}}) == 0,
+        "appendVertically of itself");
+  Small c = Small{{1, 2}}.transpose();
+  check(c.appendHorizontally(c, 1) and c.appendHorizontally(c, 1) and
+        not c.isInline() and
+        largestDifference(c.toMatrix(), Doubles{{1, 1, 1, 1},
+                                                {2, 2, 2, 2}}) == 0,
+        "appendHorizontally of itself");
+  SmallMatrix<double, 16> wide = {{3, 4}, {5, 6}};
+  check(c.appendHorizontally(wide, 2) and not c.appendHorizontally(b, 0) and
+        largestDifference(c.toMatrix(), Doubles{{1, 1, 3, 4, 1, 1},
+                                                {2, 2, 5, 6, 2, 2}}) == 0,
+        "appendHorizontally of another size");
+
+  const Small inlined = {{1, 2}, {3, 4}};
+  const Small spilled = Small(Doubles{{1, 2, 3}, {4, 5, 6}});
+  Small copy = inlined;
+  copy(0, 0) = 9;
+  Small heapCopy = spilled;
+  heapCopy(0, 0) = 9;
+  check(copy.isInline() and inlined(0, 0) == 1 and not heapCopy.isInline()
+        and spilled(0, 0) == 1 and heapCopy(1, 2) == 6,
+        "copies in both storages are independent");
+  copy = spilled;
+  heapCopy = inlined;
+  check(largestDifference(copy.toMatrix(), spilled.toMatrix()) == 0 and
+        largestDifference(heapCopy.toMatrix(), inlined.toMatrix()) == 0,
+        "copy assignment between the storages");
+  Small moved(move(copy));
+  Small movedInline(Small{{1, 2}, {3, 4}});
+  check(not moved.isInline() and copy.isEmpty() and copy.isInline() and
+        largestDifference(moved.toMatrix(), spilled.toMatrix()) == 0 and
+        movedInline.isInline() and
+        largestDifference(movedInline.toMatrix(), inlined.toMatrix()) == 0,
+        "move constructor in both storages");
+  movedInline = move(moved);
+  moved = Small(inlined);
+  check(not movedInline.isInline() and
+        largestDifference(movedInline.toMatrix(), spilled.toMatrix()) == 0 and
+        largestDifference(moved.toMatrix(), inlined.toMatrix()) == 0,
+        "move assignment in both storages");
+
+  const Doubles x = sample(3, 5, 2), y = sample(5, 4, 3);
+  check(largestDifference(multiplyMatrices(Small(x), Small(y)).toMatrix(),
+                          multiplyMatrices(x, y)) < 1e-12 and
+        largestDifference(multiplyMatrices(SmallMatrix<double>(x),
+                                           SmallMatrix<double>(y)).toMatrix(),
+                          multiplyMatrices(x, y)) < 1e-12,
+        "multiplyMatrices against Matrix");
+  check(multiplyMatrices(Small(x), Small(x)).isEmpty(),
+        "a product of other dimensions is empty");
+  check(largestDifference((Small(x) * 2.0 - Small(x)).toMatrix(), x) == 0 and
+        (Small(x) + Small(y)).isEmpty(), "elementwise operators");
+  check(largestDifference((1.0 - 2.0 / Small(y)).toMatrix(), 1.0 - 2.0 / y)
+        == 0 and largestDifference((3.0 * Small(y) + 1.0).toMatrix(),
+                                   3.0 * y + 1.0) == 0,
+        "a scalar on the left");
+  Small z(x);
+  z *= 2.0;
+  z -= Small(x);
+  z += Small(y);
+  check(largestDifference(z.toMatrix(), x) == 0 and
+        largestDifference(Small(y).transpose().toMatrix(), y.transpose()) == 0,
+        "compound operators and transpose");
+
+  return failures;
+}
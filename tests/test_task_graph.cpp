@@ -0,0 +1,102 @@
+#include <iostream>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Asynchronous task graphs, with fused chains of elementwise tasks,
+	checked against the same operations computed eagerly.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = sin(i * seed + j * (seed + 1));
+    }
+  }
+  return matrix;
+}
+
+int main() {
+
+  const Doubles a = sample(90, 60, 1), b = sample(60, 70, 2);
+  const Doubles c = sample(70, 90, 3), d = sample(90, 70, 4);
+  const Doubles ab = multiplyMatrices(a, b);
+  const Doubles e = ab * 2.0 + c.transpose() - d / 3.0;
+
+  TaskGraph<double> graph;
+  auto ta = graph.input(a), tb = graph.input(b);
+  auto tc = graph.input(c), td = graph.input(d);
+  auto tab = graph.multiplyMatrices(ta, tb);
+  // te only feeds tf, so it is fused into it
+  auto te = tab * 2.0 + graph.transpose(tc) - td / 3.0;
+  auto tf = graph.applyFunctor(te, [](double x) { return x * x; });
+  auto mismatch = tab + tc;
+  graph.run();
+  check(largestDifference(tf.get(), e * e) < 1e-12, "a chain of tasks");
+  check(tf.isReady(), "a task is ready once get returns");
+  check(largestDifference(te.get(), e) < 1e-12, "the result of a fused task");
+  check(mismatch.get().isEmpty(),
+        "operands of other dimensions give an empty result");
+
+  // Tasks added after run, some of them on fused tasks
+  auto th = te + tf;
+  check(largestDifference(th.get(), e + e * e) < 1e-12,
+        "get runs the tasks added since the last run");
+  auto scaled = tab * 2.0;
+  auto sum = scaled + td;
+  check(largestDifference(sum.get(), ab * 2.0 + d) < 1e-12 and
+        largestDifference(scaled.get(), ab * 2.0) < 1e-12,
+        "a fused task computed after its consumer");
+  auto gram = graph.multiplyMatrices(ta, graph.transpose(ta));
+  check(largestDifference(gram.get(),
+                          multiplyMatrices(a, a.transposedView())) < 1e-12,
+        "a product with a transposed task");
+
+  auto left = 1.0 - 2.0 * (3.0 + ta) / (1.5 + ta * ta);
+  check(largestDifference(left.get(), 1.0 - 2.0 * (3.0 + a) / (1.5 + a * a))
+        < 1e-15, "a scalar on the left, fused too");
+
+  TaskGraph<double> unrun;
+  auto x = unrun.input(a), y = unrun.input(c.transpose());
+  check(largestDifference((x * y - x).get(), a * c.transpose() - a) < 1e-15,
+        "get without run");
+
+  // Many graphs at once share the workers of the scheduler
+  vector<unique_ptr<TaskGraph<double>>> graphs;
+  vector<TaskGraph<double>::Task> products;
+  for (int g = 0; g < 50; g++) {
+    graphs.emplace_back(new TaskGraph<double>());
+    TaskGraph<double>& graph = *graphs.back();
+    products.push_back(graph.multiplyMatrices(graph.input(a),
+                                              graph.input(b)) + double(g));
+    graphs.back()->run();
+  }
+  bool shared = true;
+  for (int g = 0; g < 50; g++) {
+    shared = shared and
+             largestDifference(products[g].get(), ab + double(g)) < 1e-12;
+  }
+  check(shared and TaskScheduler::instance().size() ==
+        int(max(2u, thread::hardware_concurrency())),
+        "graphs share the worker threads");
+  {
+    TaskGraph<double> dropped;
+    auto input = dropped.input(a);
+    for (int t = 0; t < 20; t++) {
+      input = dropped.multiplyMatrices(input, dropped.input(a.transpose()))
+              / 100.0;
+    }
+    dropped.run();
+  }
+  TaskGraph<double> after;
+  check(largestDifference((after.input(a) + 1.0).get(), a + 1.0) == 0,
+        "a graph destroyed with its tasks waiting");
+
+  return failures;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Out-of-core tiled matrices, with tiles that do not divide the
+	dimensions and a memory budget of a few tiles, checked against the
+	same operations in memory. The files go to the working directory.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+Doubles sample(int rows, int columns, int seed) {
+  Doubles matrix(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      matrix(i, j) = sin(i * seed + j * (seed + 2));
+    }
+  }
+  return matrix;
+}
+
+int main() {
+
+  const Doubles a = sample(150, 130, 7), b = sample(130, 95, 3);
+  const Doubles c = sample(150, 130, 5);
+  {
+    TiledMatrix<double> ta("test_a.tiles", a, 32);
+    TiledMatrix<double> tb("test_b.tiles", b, 32);
+    TiledMatrix<double> tc("test_c.tiles", c, 32);
+    check(ta.tileRows() == 5 and ta.tileColumns() == 5 and
+          largestDifference(ta.toMatrix(), a) == 0, "round trip");
+    check(largestDifference(multiplyMatrices(ta, tb, "",
+              outOfCore.withMemoryBudget(32 * 32 * 8 * 4)).toMatrix(),
+              multiplyMatrices(a, b)) < 1e-12,
+          "product within a budget of four tiles");
+    check(largestDifference(transpose(ta).toMatrix(), a.transpose()) == 0,
+          "transpose");
+    check(largestDifference((ta + tc).toMatrix(), a + c) == 0 and
+          largestDifference((ta * tc).toMatrix(), a * c) == 0 and
+          largestDifference((ta * 2.0 - 1.0).toMatrix(), a * 2.0 - 1.0) == 0,
+          "elementwise operators");
+    check(largestDifference((2.0 * ta).toMatrix(), 2.0 * a) == 0 and
+          largestDifference((1.0 / ta).toMatrix(), 1.0 / a) == 0 and
+          largestDifference((1.0 - ta).toMatrix(), 1.0 - a) == 0 and
+          largestDifference((3.0 + ta).toMatrix(), 3.0 + a) == 0,
+          "a scalar on the left");
+    check((ta + tb).isEmpty() and multiplyMatrices(ta, tc).isEmpty(),
+          "operands of other dimensions give an empty result");
+
+    TiledMatrix<double> quotient = ta / tc;
+    const string temporary = quotient.getPath();
+    check(quotient.saveAs("test_quotient.tiles"), "save a temporary result");
+    check(not ifstream(temporary).good(),
+          "the temporary file is moved");
+  }
+  const TiledMatrix<double> opened =
+      TiledMatrix<double>::open("test_quotient.tiles");
+  check(largestDifference(opened.toMatrix(), a / c) == 0,
+        "open a saved matrix");
+  check(TiledMatrix<float>::open("test_quotient.tiles").isEmpty(),
+        "no matrix from a file of other cells");
+
+  const TiledMatrix<double> empty("test_empty.tiles", Doubles(), 32);
+  check(empty.isEmpty() and empty.tileRows() == 0 and
+        empty.tileColumns() == 0, "an empty matrix has no tiles");
+  check(TiledMatrix<double>().tileRows() == 0, "nor does a default one");
+
+  for (const char* path : {"test_a.tiles", "test_b.tiles", "test_c.tiles",
+                           "test_quotient.tiles", "test_empty.tiles"}) {
+    remove(path);
+  }
+  return failures;
+}
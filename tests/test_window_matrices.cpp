@@ -0,0 +1,112 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "matrices.h"
+#include "check.h"
+
+/*
+	Sliding windows of rows: the statistics kept on every push and pop,
+	checked against the ones computed from the rows of the window as it
+	wraps around its buffer many times.
+*/
+
+using namespace std;
+
+typedef Matrix<double> Doubles;
+
+// The largest difference of the statistics from the ones of the rows
+double statisticsError(const WindowMatrix<double>& window,
+                       bool withCovariance = true) {
+  const Doubles rows = window.toMatrix();
+  const int count = rows.getRows(), columns = rows.getColumns();
+  const vector<double> sums = window.getSums();
+  const vector<double> means = window.getMeans();
+  double error = 0;
+  for (int j = 0; j < columns; j++) {
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+      sum += rows(i, j);
+    }
+    error = max(error, abs(sums[j] - sum));
+    if (count > 0) error = max(error, abs(means[j] - sum / count));
+  }
+  if (not withCovariance or count < 2) return error;
+  const SymmetricMatrix<double> covariance = window.getCovariance();
+  const SymmetricMatrix<double> expected = covarianceMatrix(rows);
+  for (int i = 0; i < columns; i++) {
+    for (int j = 0; j <= i; j++) {
+      error = max(error, abs(covariance(i, j) - expected(i, j)));
+    }
+  }
+  return error;
+}
+
+int main() {
+
+  WindowMatrix<double> small(3, 1, WindowStatistics::Covariance);
+  for (double value : {1.0, 2.0, 3.0, 4.0}) {
+    small.pushRow(vector<double>{value});
+  }
+  check(small.getRows() == 3 and small(0, 0) == 2 and
+        small.getSums()[0] == 9 and small.getMeans()[0] == 3 and
+        small.getCovariance()(0, 0) == 1, "the oldest row is dropped");
+  small.popRow();
+  check(small.getSums()[0] == 7 and small.getMeans()[0] == 3.5,
+        "pop the oldest row");
+
+  const int capacity = 7, columns = 4;
+  WindowMatrix<double> window(capacity, columns,
+                              WindowStatistics::Covariance);
+  WindowMatrix<double> means(capacity, columns, WindowStatistics::Means);
+  vector<double> row(columns);
+  double error = 0, meansError = 0;
+  for (int tick = 0; tick < 200; tick++) {
+    for (int j = 0; j < columns; j++) {
+      row[j] = 100 * sin(0.37 * tick * (j + 1)) + 1000 * j;
+    }
+    window.pushRow(row);
+    means.pushRow(row);
+    // Pops now and then, so the window fills and drains
+    if (tick % 5 == 0) {
+      window.popRow();
+      means.popRow();
+    }
+    if (tick % 41 == 40) {
+      while (window.getRows() > 1) {
+        window.popRow();
+        means.popRow();
+        error = max(error, statisticsError(window));
+      }
+    }
+    error = max(error, statisticsError(window));
+    meansError = max(meansError, statisticsError(means, false));
+  }
+  check(error < 1e-9, "covariance statistics across the wraparound");
+  check(meansError < 1e-9, "means statistics across the wraparound");
+
+  Doubles values(capacity, columns);
+  for (int i = 0; i < capacity; i++) {
+    for (int j = 0; j < columns; j++) {
+      values(i, j) = window(i, j) + 1;
+    }
+  }
+  for (int i = 0; i < capacity; i++) {
+    window.pushRow(&values(i, 0));
+  }
+  check(largestDifference(window.toMatrix(), values) == 0 and
+        window.isFull(), "a full window holds the last rows");
+  const Doubles weights = Doubles::identity(columns, 2.0);
+  check(largestDifference(multiplyMatrices(window, weights),
+                          multiplyMatrices(values, weights)) == 0,
+        "window * matrix");
+  const Doubles left(3, capacity, 1.0);
+  check(largestDifference(multiplyMatrices(left, window),
+                          multiplyMatrices(left, values)) < 1e-9,
+        "matrix * window");
+
+  window.clear();
+  check(window.isEmpty() and statisticsError(window) == 0 and
+        window.getCovariance().isEmpty(), "clear");
+
+  return failures;
+}